@@ -0,0 +1,606 @@
+/// Micro-benchmarks of the math kernels (linmath, the SIMD kernels and the normals), written as JSON and
+/// compared against a stored baseline, failing when a kernel got slower by more than a threshold.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "fpsdbg.h"
+#include "normals.h"
+#include "prof.h"
+#include "simd.h"
+#include <getopt.h>
+#include <string.h>
+
+
+// inputs each kernel cycles through (small enough to stay in the caches)
+#define BENCH_INPUTS 1024
+
+// sizes of the meshes the normals are timed on, in triangles
+#define BENCH_MESHES 5
+static const uint BENCH_TRIANGLES[BENCH_MESHES] = {1000, 10000, 100000, 1000000, 10000000};
+
+// longest name of a kernel
+#define BENCH_NAME_LEN 48
+
+
+/// @brief Timed kernel
+/// @param name name in the results
+/// @param run runs the kernel over its inputs `reps` times
+/// @param ops operations per repetition (matrices, vectors or triangles)
+typedef struct Bench {
+    char name[BENCH_NAME_LEN];
+    void (*run)(const struct Bench *b, const uint reps);
+    uint ops;
+} bench;
+
+
+/// @brief Timings of a kernel
+/// @param ns_median median time per operation, in nanoseconds
+/// @param ns_mean mean time per operation
+/// @param ns_stddev standard deviation of the time per operation between runs
+/// @param ns_min fastest run's time per operation
+/// @param reps repetitions per run
+typedef struct BenchResult {
+    double ns_median, ns_mean, ns_stddev, ns_min;
+    uint reps;
+} bench_result;
+
+
+/// @brief Settings, from the command line
+/// @param runs timed runs per kernel
+/// @param warmups untimed runs per kernel
+/// @param min_ms shortest run (repetitions are doubled until a run takes this long)
+/// @param max_triangles largest mesh the normals are timed on
+/// @param out file the results are written to (`NULL` for stdout)
+/// @param baseline file the results are compared against (`NULL` for none)
+/// @param threshold largest slowdown allowed against the baseline, in percent
+typedef struct BenchOptions {
+    uint runs, warmups;
+    double min_ms;
+    uint max_triangles;
+    const char *out, *baseline;
+    double threshold;
+} bench_options;
+
+
+// inputs and outputs of the kernels (written to globals, so no call can be optimized away)
+static mat4x4 in_m[BENCH_INPUTS], out_m[BENCH_INPUTS];
+static vec4 in_v[BENCH_INPUTS], out_v[BENCH_INPUTS];
+static quat in_q[BENCH_INPUTS], out_q[BENCH_INPUTS];
+static float in_f[BENCH_INPUTS];
+static vec3 in_t[3 * BENCH_INPUTS], out_t[BENCH_INPUTS];
+
+// triangle soup `calc_norm` is timed on, and indexed grid `normals_smooth` is timed on
+static vec3 *soup_vertices, *soup_normals;
+static vec3 *grid_vertices, *grid_normals;
+static uint *grid_indices, grid_len;
+
+
+/// @brief Make the compiler assume memory was read and written (so repetitions that compute the same
+/// results again can't be folded into one)
+static inline void clobber() {
+    __asm__ __volatile__("" : : : "memory");
+}
+
+/// @brief Random float in [lo, hi) (xorshift, so every run times the same inputs)
+static float random_float(const float lo, const float hi) {
+    static uint64_t state = 0x9E3779B97F4A7C15ull;
+    state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+    return lo + (hi - lo) * (state >> 40) / (float)(1u << 24);
+}
+
+/// @brief Fill the inputs with matrices like the ones drawn, vectors, unit quaternions and angles
+static void bench_inputs() {
+    for (uint i = 0; i < BENCH_INPUTS; i++) {
+        mat4x4 id;
+        mat4x4_identity(id);
+        mat4x4_rotate(in_m[i], id, random_float(-1, 1), random_float(-1, 1), random_float(0.1f, 1), random_float(0, M_TAU));
+        mat4x4_scale_aniso(in_m[i], in_m[i], random_float(0.5f, 2), random_float(0.5f, 2), random_float(0.5f, 2));
+        for (uint l = 0; l < 3; l++)
+            in_m[i][3][l] = random_float(-100, 100);
+
+        for (uint l = 0; l < 4; l++) {
+            in_v[i][l] = random_float(-10, 10);
+            in_q[i][l] = random_float(-1, 1);
+        }
+        quat_norm(in_q[i], in_q[i]);
+        in_f[i] = random_float(-M_TAU, M_TAU);
+        for (uint k = 0; k < 3; k++)
+            for (uint l = 0; l < 3; l++)
+                in_t[3 * i + k][l] = random_float(-1, 1);
+    }
+}
+
+
+// linmath kernels (each repetition goes over every input once)
+
+static void run_mat4x4_mul(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            mat4x4_mul(out_m[i], in_m[i], in_m[(i + 1) % BENCH_INPUTS]);
+        clobber();
+    }
+}
+
+static void run_mat4x4_mul_vec4(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            mat4x4_mul_vec4(out_v[i], in_m[i], in_v[i]);
+        clobber();
+    }
+}
+
+static void run_mat4x4_invert(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            mat4x4_invert(out_m[i], in_m[i]);
+        clobber();
+    }
+}
+
+static void run_mat4x4_rotate_Y(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            mat4x4_rotate_Y(out_m[i], in_m[i], in_f[i]);
+        clobber();
+    }
+}
+
+static void run_mat4x4_look_at(const bench *b, const uint reps) {
+    const vec3 up = {0.0f, 1.0f, 0.0f};
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            mat4x4_look_at(out_m[i], in_v[i], in_m[i][3], up);
+        clobber();
+    }
+}
+
+static void run_mat4x4_perspective(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            mat4x4_perspective(out_m[i], 0.5f + in_f[i] * 0.05f, 1.777f, 0.001f, 1000.0f);
+        clobber();
+    }
+}
+
+static void run_mat4x4_from_quat(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            mat4x4_from_quat(out_m[i], in_q[i]);
+        clobber();
+    }
+}
+
+static void run_quat_mul(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            quat_mul(out_q[i], in_q[i], in_q[(i + 1) % BENCH_INPUTS]);
+        clobber();
+    }
+}
+
+static void run_quat_rotate(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            quat_rotate(out_q[i], in_f[i], in_v[i]);
+        clobber();
+    }
+}
+
+static void run_quat_mul_vec3(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            quat_mul_vec3(out_v[i], in_q[i], in_v[i]);
+        clobber();
+    }
+}
+
+static void run_vec3_norm(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            vec3_norm(out_v[i], in_v[i]);
+        clobber();
+    }
+}
+
+static void run_vec4_norm(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            vec4_norm(out_v[i], in_v[i]);
+        clobber();
+    }
+}
+
+static void run_vec3_mul_cross(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            vec3_mul_cross(out_v[i], in_v[i], in_v[(i + 1) % BENCH_INPUTS]);
+        clobber();
+    }
+}
+
+
+// SIMD kernels, at the level picked for this CPU
+
+static void run_simd_mat4x4_mul(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            simd.mat4x4_mul(out_m[i], in_m[i], in_m[(i + 1) % BENCH_INPUTS]);
+        clobber();
+    }
+}
+
+static void run_simd_mat4x4_mul_vec4(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            simd.mat4x4_mul_vec4(out_v[i], in_m[i], in_v[i]);
+        clobber();
+    }
+}
+
+static void run_simd_mat4x4_invert(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            simd.mat4x4_invert(out_m[i], in_m[i]);
+        clobber();
+    }
+}
+
+static void run_simd_quat_mul(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        for (uint i = 0; i < BENCH_INPUTS; i++)
+            simd.quat_mul(out_q[i], in_q[i], in_q[(i + 1) % BENCH_INPUTS]);
+        clobber();
+    }
+}
+
+static void run_simd_mat4x4_mul_batch(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        simd.mat4x4_mul_batch(out_m, in_m[r % BENCH_INPUTS], in_m, NULL, BENCH_INPUTS);
+        clobber();
+    }
+}
+
+static void run_simd_mat4x4_rotate_Y_batch(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        simd.mat4x4_rotate_Y_batch(out_m, in_m, in_f, BENCH_INPUTS);
+        clobber();
+    }
+}
+
+static void run_simd_tri_normals(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        simd.tri_normals(out_t, in_t, NULL, BENCH_INPUTS, 1);
+        clobber();
+    }
+}
+
+
+// normals of a triangle soup
+
+static void run_calc_norm(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        calc_norm(3 * b->ops, soup_vertices, soup_normals);
+        clobber();
+    }
+}
+
+static void run_normals_smooth(const bench *b, const uint reps) {
+    for (uint r = 0; r < reps; r++) {
+        normals_smooth(NULL, NORMALS_ANGLE, grid_len, grid_vertices, 3 * b->ops, grid_indices, grid_normals);
+        clobber();
+    }
+}
+
+/// @brief Make a random triangle soup for `calc_norm`, and a bumpy square grid of as many triangles
+/// for `normals_smooth` (replacing the last ones)
+static void bench_mesh(const uint triangles) {
+    free(soup_vertices);
+    free(soup_normals);
+    free(grid_vertices);
+    free(grid_normals);
+    free(grid_indices);
+
+    uint side = 1;
+    while (2 * side * side < triangles)
+        side++;
+    grid_len = (side + 1) * (side + 1);
+
+    soup_vertices = malloc(3 * (size_t)triangles * sizeof(vec3));
+    soup_normals = malloc(3 * (size_t)triangles * sizeof(vec3));
+    grid_vertices = malloc(grid_len * sizeof(vec3));
+    grid_normals = malloc(grid_len * sizeof(vec3));
+    grid_indices = malloc(3 * (size_t)triangles * sizeof(uint));
+    if (!soup_vertices || !soup_normals || !grid_vertices || !grid_normals || !grid_indices) {
+        error("Failed to allocate the benchmark's mesh.");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < 3 * (size_t)triangles; i++)
+        for (uint l = 0; l < 3; l++)
+            soup_vertices[i][l] = random_float(-1, 1);
+
+    for (uint i = 0; i <= side; i++)
+        for (uint j = 0; j <= side; j++) {
+            float *v = grid_vertices[i * (side + 1) + j];
+            v[0] = (float)j / side, v[1] = random_float(0, 0.01f), v[2] = (float)i / side;
+        }
+
+    // two triangles per cell, until there are enough (the last cell may get only one)
+    for (uint t = 0; t < triangles; t++) {
+        const uint cell = t / 2, a = cell / side * (side + 1) + cell % side, b = a + side + 1;
+        uint *e = &grid_indices[3 * t];
+        if (t % 2)
+            e[0] = b, e[1] = a + 1, e[2] = b + 1;
+        else
+            e[0] = a, e[1] = a + 1, e[2] = b;
+    }
+}
+
+
+/// @brief Time a kernel: double the repetitions until a run is long enough, then time the runs
+static bench_result bench_time(const bench *b, const bench_options *o) {
+    bench_result res = {0};
+    res.reps = 1;
+
+    // the warm-up runs also find how many repetitions a run needs
+    for (uint w = 0; w < o->warmups; w++)
+        for (;;) {
+            const uint64_t t = prof_now();
+            b->run(b, res.reps);
+            if (prof_now() - t >= o->min_ms * 1e6 || res.reps >= 1u << 30)
+                break;
+            res.reps *= 2;
+        }
+
+    double *ns = malloc(o->runs * sizeof(double));
+    if (!ns) {
+        error("Failed to allocate the benchmark's timings.");
+        exit(EXIT_FAILURE);
+    }
+    for (uint r = 0; r < o->runs; r++) {
+        const uint64_t t = prof_now();
+        b->run(b, res.reps);
+        ns[r] = (double)(prof_now() - t) / ((double)res.reps * b->ops);
+    }
+
+    // insertion sort, for the median (there are only a handful of runs)
+    for (uint i = 1; i < o->runs; i++)
+        for (uint j = i; j > 0 && ns[j - 1] > ns[j]; j--) {
+            const double x = ns[j];
+            ns[j] = ns[j - 1];
+            ns[j - 1] = x;
+        }
+
+    double sum = 0.0, sq = 0.0;
+    for (uint r = 0; r < o->runs; r++)
+        sum += ns[r];
+    res.ns_mean = sum / o->runs;
+    for (uint r = 0; r < o->runs; r++)
+        sq += (ns[r] - res.ns_mean) * (ns[r] - res.ns_mean);
+    res.ns_stddev = o->runs > 1 ? sqrt(sq / (o->runs - 1)) : 0.0;
+    res.ns_min = ns[0];
+    res.ns_median = o->runs % 2 ? ns[o->runs / 2] : (ns[o->runs / 2 - 1] + ns[o->runs / 2]) / 2.0;
+
+    free(ns);
+    return res;
+}
+
+/// @brief Fastest run's time per operation of a kernel in a results file
+/// @return the time, or a negative value if the kernel isn't in the file
+static double baseline_ns(const char *json, const char *name) {
+    char key[BENCH_NAME_LEN + 8];
+    snprintf(key, sizeof(key), "\"%s\": {", name);
+    const char *k = strstr(json, key);
+    if (!k)
+        return -1.0;
+
+    const char *m = strstr(k, "\"ns_min\": ");
+    const char *end = strchr(k, '}');
+    return m && (!end || m < end) ? strtod(m + strlen("\"ns_min\": "), NULL) : -1.0;
+}
+
+/// @brief Read a whole file
+/// @return its contents (to be freed), or `NULL` if it can't be read
+static char *read_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    const long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char *s = len >= 0 ? malloc(len + 1) : NULL;
+    if (s)
+        s[fread(s, 1, len, f)] = '\0';
+    fclose(f);
+    return s;
+}
+
+/// @brief Print usage information
+static void usage(FILE *out, const char *name) {
+    fprintf(out,
+            "Usage: %s [options]\n"
+            "\n"
+            "Options:\n"
+            "  -r, --runs N           timed runs per kernel (default 9)\n"
+            "  -w, --warmups N        untimed runs per kernel (default 2)\n"
+            "  -t, --min-ms MS        shortest run, in milliseconds (default 10)\n"
+            "  -m, --max-triangles N  largest mesh the normals are timed on (default 10000000)\n"
+            "  -o, --out FILE         write the results to FILE (default stdout)\n"
+            "  -b, --baseline FILE    compare the results against FILE\n"
+            "  -p, --threshold PCT    largest slowdown against the baseline, in percent (default 10)\n"
+            "  -h, --help             show this message\n",
+            name);
+}
+
+/// @brief Parse a non-negative number argument, exiting on failure
+static double parse_number(const char *opt, const char *arg) {
+    char *end;
+    const double v = strtod(arg, &end);
+    if (end == arg || *end || v < 0.0) {
+        fprintf(stderr, "Error: invalid value for %s: '%s'\n", opt, arg);
+        exit(EXIT_FAILURE);
+    }
+    return v;
+}
+
+int main(int argc, char **argv) {
+    bench_options o = {
+        .runs = 9,
+        .warmups = 2,
+        .min_ms = 10.0,
+        .max_triangles = BENCH_TRIANGLES[BENCH_MESHES - 1],
+        .threshold = 10.0
+    };
+
+    const struct option long_opts[] = {
+        {"runs", required_argument, NULL, 'r'},
+        {"warmups", required_argument, NULL, 'w'},
+        {"min-ms", required_argument, NULL, 't'},
+        {"max-triangles", required_argument, NULL, 'm'},
+        {"out", required_argument, NULL, 'o'},
+        {"baseline", required_argument, NULL, 'b'},
+        {"threshold", required_argument, NULL, 'p'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "r:w:t:m:o:b:p:h", long_opts, NULL)) != -1) {
+        switch (c) {
+            case 'r':
+                o.runs = parse_number("--runs", optarg);
+                break;
+            case 'w':
+                o.warmups = parse_number("--warmups", optarg);
+                break;
+            case 't':
+                o.min_ms = parse_number("--min-ms", optarg);
+                break;
+            case 'm':
+                o.max_triangles = parse_number("--max-triangles", optarg);
+                break;
+            case 'o':
+                o.out = optarg;
+                break;
+            case 'b':
+                o.baseline = optarg;
+                break;
+            case 'p':
+                o.threshold = parse_number("--threshold", optarg);
+                break;
+            case 'h':
+                usage(stdout, argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(stderr, argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (!o.runs || !o.warmups) {
+        fprintf(stderr, "Error: --runs and --warmups must be at least 1\n");
+        return EXIT_FAILURE;
+    }
+
+    const simd_level level = simd_init();
+    bench_inputs();
+
+    bench benches[] = {
+        {"mat4x4_mul", run_mat4x4_mul, BENCH_INPUTS},
+        {"mat4x4_mul_vec4", run_mat4x4_mul_vec4, BENCH_INPUTS},
+        {"mat4x4_invert", run_mat4x4_invert, BENCH_INPUTS},
+        {"mat4x4_rotate_Y", run_mat4x4_rotate_Y, BENCH_INPUTS},
+        {"mat4x4_look_at", run_mat4x4_look_at, BENCH_INPUTS},
+        {"mat4x4_perspective", run_mat4x4_perspective, BENCH_INPUTS},
+        {"mat4x4_from_quat", run_mat4x4_from_quat, BENCH_INPUTS},
+        {"quat_mul", run_quat_mul, BENCH_INPUTS},
+        {"quat_rotate", run_quat_rotate, BENCH_INPUTS},
+        {"quat_mul_vec3", run_quat_mul_vec3, BENCH_INPUTS},
+        {"vec3_norm", run_vec3_norm, BENCH_INPUTS},
+        {"vec4_norm", run_vec4_norm, BENCH_INPUTS},
+        {"vec3_mul_cross", run_vec3_mul_cross, BENCH_INPUTS},
+        {"simd.mat4x4_mul", run_simd_mat4x4_mul, BENCH_INPUTS},
+        {"simd.mat4x4_mul_vec4", run_simd_mat4x4_mul_vec4, BENCH_INPUTS},
+        {"simd.mat4x4_invert", run_simd_mat4x4_invert, BENCH_INPUTS},
+        {"simd.quat_mul", run_simd_quat_mul, BENCH_INPUTS},
+        {"simd.mat4x4_mul_batch", run_simd_mat4x4_mul_batch, BENCH_INPUTS},
+        {"simd.mat4x4_rotate_Y_batch", run_simd_mat4x4_rotate_Y_batch, BENCH_INPUTS},
+        {"simd.tri_normals", run_simd_tri_normals, BENCH_INPUTS}
+    };
+    const uint benches_len = sizeof(benches) / sizeof(benches[0]);
+
+    FILE *out = o.out ? fopen(o.out, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Error: can't write '%s'\n", o.out);
+        return EXIT_FAILURE;
+    }
+    char *baseline = o.baseline ? read_file(o.baseline) : NULL;
+    if (o.baseline && !baseline)
+        fprintf(stderr, "Warning: no baseline at '%s', nothing to compare against\n", o.baseline);
+
+    // the `simd.` kernels only compare with a baseline of the same level
+    char base_key[64];
+    snprintf(base_key, sizeof(base_key), "\"level\": \"%s\"", SIMD_LEVEL_NAMES[level]);
+    const int other_level = baseline && strstr(baseline, "\"level\": \"") && !strstr(baseline, base_key);
+    if (other_level)
+        fprintf(stderr, "Warning: the baseline was taken with other SIMD kernels than %s, the simd. kernels are not compared\n",
+                SIMD_LEVEL_NAMES[level]);
+
+    fprintf(out, "{\"level\": \"%s\", \"runs\": %u, \"warmups\": %u, \"min_ms\": %.1f, \"kernels\": {\n",
+            SIMD_LEVEL_NAMES[level], o.runs, o.warmups, o.min_ms);
+
+    // the mesh sizes come after the fixed kernels, and each has meshes of its own for both kinds of normals
+    uint regressions = 0, n = 0;
+    for (uint k = 0; k < benches_len + 2 * BENCH_MESHES; k++) {
+        bench b;
+        if (k < benches_len)
+            b = benches[k];
+        else {
+            const uint triangles = BENCH_TRIANGLES[(k - benches_len) / 2];
+            const int smooth = (k - benches_len) % 2;
+            if (triangles > o.max_triangles)
+                continue;
+            b = (bench) {
+                "", smooth ? run_normals_smooth : run_calc_norm, triangles
+            };
+            snprintf(b.name, BENCH_NAME_LEN, "%s.%u", smooth ? "normals_smooth" : "calc_norm", triangles);
+            if (!smooth)
+                bench_mesh(triangles);
+        }
+
+        const bench_result res = bench_time(&b, &o);
+        fprintf(out, "%s  \"%s\": {\"ns_median\": %.3f, \"ns_mean\": %.3f, \"ns_stddev\": %.3f, \"ns_min\": %.3f, "
+                "\"mops\": %.2f, \"reps\": %u}", n++ ? ",\n" : "", b.name, res.ns_median, res.ns_mean,
+                res.ns_stddev, res.ns_min, 1e3 / res.ns_median, res.reps);
+
+        // the slowdown against the baseline, on stderr (as the results may go to stdout); the fastest runs are
+        // compared, as other work on the machine only ever makes a run slower
+        const int same_level = !other_level || strncmp(b.name, "simd.", strlen("simd."));
+        const double base = baseline && same_level ? baseline_ns(baseline, b.name) : -1.0;
+        if (base > 0.0) {
+            const double change = 100.0 * (res.ns_min - base) / base;
+            const int regressed = change > o.threshold;
+            regressions += regressed;
+            fprintf(stderr, "%-28s %10.3f ns  (baseline %10.3f ns, %+6.1f%%)%s\n", b.name, res.ns_min, base, change,
+                    regressed ? "  REGRESSION" : "");
+        } else
+            fprintf(stderr, "%-28s %10.3f ns%s\n", b.name, res.ns_min,
+                    !baseline ? "" : same_level ? "  (not in the baseline)" : "  (baseline at another level)");
+    }
+    fprintf(out, "\n}}\n");
+
+    if (regressions)
+        fprintf(stderr, "%u kernel%s slower than the baseline by more than %.1f%%\n",
+                regressions, regressions > 1 ? "s are" : " is", o.threshold);
+
+    free(baseline);
+    free(soup_vertices);
+    free(soup_normals);
+    free(grid_vertices);
+    free(grid_normals);
+    free(grid_indices);
+    if (o.out)
+        fclose(out);
+    return regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/// Sub-allocator handing out ranges of one large GL buffer, so many meshes share a single buffer.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "util.h"
+#include <stdio.h>
+
+
+/// @brief Free range of an arena, in elements
+/// @param offset first element
+/// @param size number of elements
+typedef struct ArenaBlock {
+    uint offset, size;
+} arena_block;
+
+
+/// @brief A GL buffer split into ranges with a first-fit free-list (sorted by offset, neighbours coalesced)
+/// @param buffer buffer object (replaced by a bigger one when the arena grows)
+/// @param stride size of an element, in bytes
+/// @param cap number of elements the buffer has room for
+/// @param used number of allocated elements
+/// @param allocs number of live allocations
+/// @param grows number of times the buffer was reallocated
+/// @param blocks free ranges, sorted by offset
+/// @param blocks_len number of free ranges
+/// @param blocks_cap number of free ranges there is room for
+typedef struct Arena {
+    uint buffer;
+    uint stride, cap, used, allocs, grows;
+    arena_block *blocks;
+    uint blocks_len, blocks_cap;
+} arena;
+
+
+/// @brief Create the buffer
+/// @param a arena pointer
+/// @param stride size of an element, in bytes
+/// @param cap initial number of elements
+void arena_init(arena *a, const uint stride, const uint cap);
+
+/// @brief Allocate a range and upload data into it (the buffer grows if no free range is big enough)
+/// @param a arena pointer
+/// @param n number of elements
+/// @param data elements to upload (`NULL` to leave the range undefined)
+/// @return offset of the range, in elements
+uint arena_alloc(arena *a, const uint n, const void *data);
+
+/// @brief Make sure `n` elements fit at the end of the arena, growing it at most once (rather than
+/// doubling it again and again as the ranges come)
+/// @param a arena pointer
+/// @param n number of elements
+void arena_reserve(arena *a, const uint n);
+
+/// @brief Return a range to the arena
+/// @param a arena pointer
+/// @param offset offset of the range, as returned by `arena_alloc`
+/// @param n number of elements
+void arena_release(arena *a, const uint offset, const uint n);
+
+/// @brief Largest free range
+/// @param a arena pointer
+/// @return number of elements
+uint arena_largest(const arena *a);
+
+/// @brief Fragmentation of the free space (0 when it is a single range, close to 1 when it is scattered)
+/// @param a arena pointer
+/// @return `1 - largest free range / free space`
+double arena_fragmentation(const arena *a);
+
+/// @brief Write the utilization and fragmentation statistics as a JSON object
+/// @param a arena pointer
+/// @param out output stream
+void arena_json(const arena *a, FILE *out);
+
+/// @brief Delete the buffer
+/// @param a arena pointer
+void arena_free(arena *a);
+
+#endif
@@ -0,0 +1,109 @@
+/// Bounding-volume hierarchy over the world's objects, for frustum culling and ray queries on the CPU.
+/// Nodes are 4 wide and store their children's boxes in structure-of-arrays form, so a node (or a leaf's objects)
+/// is tested with a single SIMD pass.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "world.h"
+#include <stdint.h>
+
+
+// children per node (the width of the box tests)
+#define BVH_WIDTH 4
+
+// most objects in a leaf (one box test)
+#define BVH_LEAF 4
+
+// returned by `bvh_raycast` when nothing is hit, and the parent of the root
+#define BVH_NONE (~0u)
+
+// views (a full turn from the middle of the scene, looking out), rays and builds timed by `bvh_bench`
+#define BVH_BENCH_VIEWS 64
+#define BVH_BENCH_RAYS 4096
+#define BVH_BENCH_BUILDS 5
+
+// vertical field of view of the benchmark's views, in radians (narrow, so each sees part of the scene)
+#define BVH_BENCH_FOV 0.6f
+
+
+/// @brief Node with up to `BVH_WIDTH` children, each either a node or a leaf (a range of `items`)
+/// @param lo smallest corner of each child's box (`lo[axis][child]`)
+/// @param hi largest corner of each child's box (`hi[axis][child]`)
+/// @param child index of each child node, or first item of each leaf
+/// @param count number of objects of each leaf (0 for a node or an empty child)
+typedef struct BvhNode {
+    float lo[3][BVH_WIDTH], hi[3][BVH_WIDTH];
+    uint child[BVH_WIDTH];
+    uint count[BVH_WIDTH];
+} bvh_node;
+
+
+/// @brief Hierarchy over the dense indices of a world's objects
+/// @param nodes nodes (the root is node 0)
+/// @param nodes_len number of nodes
+/// @param nodes_cap number of nodes there is room for
+/// @param parent parent of each node, times `BVH_WIDTH`, plus the child it is (`BVH_NONE` for the root)
+/// @param items object of each leaf entry
+/// @param leaf node and child (node times `BVH_WIDTH`, plus child) of the leaf holding each object
+/// @param len number of objects
+/// @param cap number of objects there is room for
+/// @param version world version the hierarchy was built for
+typedef struct Bvh {
+    bvh_node *nodes;
+    uint nodes_len, nodes_cap;
+    uint *parent;
+    uint *items, *leaf;
+    uint len, cap;
+    uint version;
+} bvh;
+
+
+/// @brief Initialize an empty hierarchy
+/// @param b hierarchy pointer
+void bvh_init(bvh *b);
+
+/// @brief Build the hierarchy over every object (median splits along the longest axis of the centers)
+/// @param b hierarchy pointer
+/// @param w world
+void bvh_build(bvh *b, const world *w);
+
+/// @brief Update the boxes above objects that moved, without changing the structure
+/// @param b hierarchy pointer
+/// @param w world (with the objects' new bounds)
+/// @param objects dense indices of the moved objects
+/// @param n number of moved objects
+void bvh_refit(bvh *b, const world *w, const uint *objects, const uint n);
+
+/// @brief Find the objects whose box intersects a view frustum
+/// @param b hierarchy pointer
+/// @param w world
+/// @param clip projection times view matrix
+/// @param visible set to 1 for each visible object, and 0 for the others (one entry per object)
+/// @return number of visible objects
+uint bvh_frustum(const bvh *b, const world *w, mat4x4 const clip, uint8_t *visible);
+
+/// @brief Find the nearest object whose box a ray hits
+/// @param b hierarchy pointer
+/// @param w world
+/// @param origin origin of the ray
+/// @param dir direction of the ray (need not be normalized)
+/// @param t set to the distance to the hit, in multiples of `dir`
+/// @return dense index of the object, or `BVH_NONE`
+uint bvh_raycast(const bvh *b, const world *w, const vec3 origin, const vec3 dir, float *t);
+
+/// @brief Time building, refitting and querying a hierarchy over the world, and check the queries against
+/// testing every object's box. Moves every object a little (to time the refit).
+/// @param w world
+/// @param projection projection matrix of the window (the queried views keep its aspect ratio)
+/// @param view view matrix of the camera (the rays are cast from its eye)
+/// @param out stream the results are written to, as one JSON object
+void bvh_bench(world *w, mat4x4 const projection, mat4x4 const view, FILE *out);
+
+/// @brief Release the hierarchy's memory
+/// @param b hierarchy pointer
+void bvh_free(bvh *b);
+
+#endif
@@ -0,0 +1,125 @@
+/// GPU frustum culling: a compute pass writes the indirect commands of the visible objects
+/// (and can skip those hidden behind the last frame's depth, see `hiz.h`).
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef CULL_H
+#define CULL_H
+
+#include "hiz.h"
+#include "world.h"
+
+
+// storage buffer binding points of the culling pass (the objects' matrices are at `SSBO_OBJECTS`)
+#define SSBO_CULL_DRAWS 1
+#define SSBO_CULL_MESHES 2
+#define SSBO_CULL_BATCHES 3
+#define SSBO_CULL_COMMANDS 4
+#define SSBO_CULL_COUNTS 5
+
+// frames whose visible counts may be in flight at once
+#define CULL_READBACK 4
+
+// invocations per work group
+#define CULL_GROUP 64
+
+
+/// @brief How the objects outside of the view are skipped
+typedef enum CullMode {
+    CULL_NONE,
+    CULL_GPU,
+    CULL_CPU,
+    CULL_MODE_COUNT
+} cull_mode;
+
+
+/// @brief Names of the culling modes, as used on the command line
+extern const char *CULL_MODE_NAMES[CULL_MODE_COUNT];
+
+
+/// @brief Mesh as seen by the culling pass (`std430` layout of `Mesh`)
+/// @param sphere bounding sphere, in object space
+/// @param lo smallest corner of the bounding box, in object space
+/// @param hi largest corner of the bounding box, in object space
+/// @param count number of indices (or vertices)
+/// @param first first index (or first vertex)
+/// @param base_vertex first vertex
+/// @param indexed whether the mesh is drawn with its indices
+typedef struct CullMesh {
+    vec4 sphere, lo, hi;
+    uint count, first;
+    GLint base_vertex;
+    uint indexed;
+} cull_mesh;
+
+
+/// @brief Culling pass state
+/// @param program compute program
+/// @param compact whether visible commands are packed and counted (`ARB_indirect_parameters`), rather than
+/// every object keeping its command with an instance count of 0 or 1
+/// @param draws buffer of the mesh version and batch of every object, in draw order
+/// @param meshes buffer of `cull_mesh`, one per version a mesh may have (`LOD_MAX + 1`)
+/// @param batches buffer of the first object of every batch
+/// @param commands buffer the pass writes the indirect commands into
+/// @param counts buffer of the number of visible objects overall, of those hidden behind the last frame's depth,
+/// and then of visible objects per batch (read as draw counts)
+/// @param cap number of objects the buffers have room for
+/// @param objects number of objects tested each frame
+/// @param readback persistently mapped buffer receiving the overall visible and hidden counts of in-flight frames
+/// @param visible_counts mapping of `readback`
+/// @param fences fence of the frame that last used each readback slot (`NULL` if none)
+/// @param frame index of the current frame
+/// @param visible number of visible objects in the last frame read back
+/// @param visible_sum number of visible objects over every frame read back
+/// @param occluded number of objects in the view but hidden in the last frame read back
+/// @param occluded_sum number of hidden objects over every frame read back
+/// @param resolved number of frames read back
+typedef struct Culler {
+    uint program;
+    GLboolean compact;
+    uint draws, meshes, batches, commands, counts;
+    uint cap, objects;
+
+    uint readback;
+    const uint *visible_counts;
+    GLsync fences[CULL_READBACK];
+    uint64_t frame;
+    uint visible;
+    uint64_t visible_sum;
+    uint occluded;
+    uint64_t occluded_sum, resolved;
+} culler;
+
+
+/// @brief Run of objects sharing a program and a mode (defined by the renderer)
+struct DrawBatch;
+
+
+/// @brief Compile the compute program and create the buffers
+/// @param c culler pointer
+void cull_init(culler *c);
+
+/// @brief Upload the mesh, version and batch of every object (only needed when objects were added or removed,
+/// or switched versions)
+/// @param c culler pointer
+/// @param w world
+/// @param order object indices in draw order
+/// @param levels version of every object's mesh that is drawn (see `lod.h`)
+/// @param batches runs of the draw order
+/// @param batches_len number of batches
+void cull_build(culler *c, const world *w, const uint *order, const uint8_t *levels, const struct DrawBatch *batches,
+                const uint batches_len);
+
+/// @brief Test every object against the view frustum (then against the depth pyramid) and write the visible
+/// objects' commands (the objects' modelview matrices must be bound at `SSBO_OBJECTS`)
+/// @param c culler pointer
+/// @param projection projection matrix
+/// @param h depth pyramid of the last frame (`NULL`, off or not built yet to only test the frustum)
+/// @param view view matrix of the current frame
+void cull_dispatch(culler *c, mat4x4 const projection, const hiz *h, mat4x4 const view);
+
+/// @brief Delete the program and the buffers
+/// @param c culler pointer
+void cull_free(culler *c);
+
+#endif
@@ -5,7 +5,7 @@
 #ifndef FPSDBG_H
 #define FPSDBG_H
 
-#include "util.h"
+#include "world.h"
 
 // window dimensions
 extern uint WIDTH, HEIGHT;
@@ -29,34 +29,55 @@ void framebuffer_size_callback(GLFWwindow *window, const int w, const int h);
 /// @param yoffset scroll yoffset value
 void scroll_callback(GLFWwindow *window, const double xoffset, const double yoffset);
 
-/// @brief Calculate the normals for the provided vertex data
-/// @param n number of triangles
+/// @brief Calculate the flat normals of a triangle soup, on the calling thread (see `normals.h` for indexed meshes)
+/// @param n number of vertices (three per triangle)
 /// @param vertices vertices array
 /// @param normals normals array
 void calc_norm(const uint n, const vec3 vertices[], vec3 normals[]);
 
-/// @brief Create an object and automatically store it into the world container (this is unchecked, assumes there's enough space allocated)
+/// @brief Create an object with geometry of its own (with smooth normals, weighed by angle) and automatically
+/// store it into the world container
 /// @param wd world pointer
 /// @param program current program
 /// @param n size of vertices array
 /// @param m size of indices array
 /// @param vertices vertices array
 /// @param indices indices array
-/// @param usage type of usage
+/// @param usage type of usage (unused, as all geometry lives in the static mesh arenas)
 /// @param mode rendering mode
-/// @return GLuint identifier
-uint create_object(world *wd, const uint program, const uint n, const uint m, const float *vertices, const uint *indices, const GLenum usage, const GLenum mode);
+/// @return handle of the new object
+handle create_object(world *wd, const uint program, const uint n, const uint m, const float *vertices, const uint *indices, const GLenum usage, const GLenum mode);
 
-/// @brief Create a rectangular-prism based on the provided dimensions
+/// @brief Create an object from an existing mesh and store it into the world container
+/// @param wd world pointer
+/// @param program current program
+/// @param me index of the mesh
+/// @param model model matrix placing the mesh in the world
+/// @return handle of the new object
+handle create_instance(world *wd, const uint program, const uint me, mat4x4 const model);
+
+/// @brief Create a rectangular-prism based on the provided dimensions (an instance of the shared unit cube, with flat normals)
 /// @param wd world pointer
 /// @param program current program
 /// @param pos position of geometry
 /// @param dim dimensions of geometry
-/// @return GLuint identifier
-uint create_rect(world *wd, const uint program, const vec3 pos, const vec3 dim);
+/// @return handle of the new object
+handle create_rect(world *wd, const uint program, const vec3 pos, const vec3 dim);
+
+/// @brief Create a UV-sphere with the provided radius and resolution (an instance of the shared unit sphere, with smooth normals across its seam)
+/// @param wd world pointer
+/// @param program current program
+/// @param pos center of geometry
+/// @param r radius of geometry
+/// @param seg number of segments around the equator (half as many rings)
+/// @return handle of the new object
+handle create_sphere(world *wd, const uint program, const vec3 pos, const float r, const uint seg);
 
 /// @brief Convenience method for initializing the `GLFW` and `GLEW` libraries as well as a new and simple window
+/// @param width initial window width (0 uses half the monitor's width)
+/// @param height initial window height (0 uses half the monitor's height)
+/// @param samples number of MSAA samples
 /// @return newly initialized GLFW window
-GLFWwindow *init();
+GLFWwindow *init(const uint width, const uint height, const uint samples);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,366 @@
+/// GL call tracing: in profiling builds (`GLTRACE` defined, see `make profile`), the GL entry points the engine
+/// calls are redirected to wrappers counting the calls, the bytes they upload and the CPU time spent in each, per
+/// frame. Tracing is switched on and off at runtime; other builds keep none of it.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef GLTRACE_H
+#define GLTRACE_H
+
+#include <GL/glew.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+/// @brief Entry points traced, as `X(name, parameters, arguments, bytes uploaded)` for those returning nothing,
+/// and `R(return type, name, parameters, arguments, bytes uploaded)` for the others. This is every entry point the
+/// engine calls, setup included (a call missing from the table isn't counted, so new ones go here too).
+#define GLTRACE_ENTRIES(X, R) \
+    X(glActiveTexture, (GLenum texture), (texture), 0) \
+    X(glAttachShader, (GLuint program, GLuint shader), (program, shader), 0) \
+    X(glBindBuffer, (GLenum target, GLuint buffer), (target, buffer), 0) \
+    X(glBindBufferBase, (GLenum target, GLuint index, GLuint buffer), (target, index, buffer), 0) \
+    X(glBindBufferRange, (GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size), \
+      (target, index, buffer, offset, size), 0) \
+    X(glBindFramebuffer, (GLenum target, GLuint framebuffer), (target, framebuffer), 0) \
+    X(glBindImageTexture, (GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, \
+                           GLenum format), (unit, texture, level, layered, layer, access, format), 0) \
+    X(glBindRenderbuffer, (GLenum target, GLuint renderbuffer), (target, renderbuffer), 0) \
+    X(glBindTexture, (GLenum target, GLuint texture), (target, texture), 0) \
+    X(glBindVertexArray, (GLuint array), (array), 0) \
+    X(glBindVertexBuffer, (GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride), \
+      (binding, buffer, offset, stride), 0) \
+    X(glBlitFramebuffer, (GLint x0, GLint y0, GLint x1, GLint y1, GLint dx0, GLint dy0, GLint dx1, GLint dy1, \
+                          GLbitfield mask, GLenum filter), (x0, y0, x1, y1, dx0, dy0, dx1, dy1, mask, filter), 0) \
+    X(glBufferData, (GLenum target, GLsizeiptr size, const void *data, GLenum usage), (target, size, data, usage), \
+      data ? size : 0) \
+    X(glBufferStorage, (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags), \
+      (target, size, data, flags), data ? size : 0) \
+    X(glBufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, const void *data), \
+      (target, offset, size, data), size) \
+    R(GLenum, glCheckFramebufferStatus, (GLenum target), (target), 0) \
+    X(glClear, (GLbitfield mask), (mask), 0) \
+    X(glClearBufferData, (GLenum target, GLenum internal, GLenum format, GLenum type, const void *data), \
+      (target, internal, format, type, data), 0) \
+    X(glClearColor, (GLfloat r, GLfloat g, GLfloat b, GLfloat a), (r, g, b, a), 0) \
+    R(GLenum, glClientWaitSync, (GLsync sync, GLbitfield flags, GLuint64 timeout), (sync, flags, timeout), 0) \
+    X(glCompileShader, (GLuint shader), (shader), 0) \
+    X(glCopyBufferSubData, (GLenum from, GLenum to, GLintptr from_offset, GLintptr to_offset, GLsizeiptr size), \
+      (from, to, from_offset, to_offset, size), 0) \
+    R(GLuint, glCreateProgram, (void), (), 0) \
+    R(GLuint, glCreateShader, (GLenum type), (type), 0) \
+    X(glDeleteBuffers, (GLsizei n, const GLuint *buffers), (n, buffers), 0) \
+    X(glDeleteFramebuffers, (GLsizei n, const GLuint *framebuffers), (n, framebuffers), 0) \
+    X(glDeleteProgram, (GLuint program), (program), 0) \
+    X(glDeleteQueries, (GLsizei n, const GLuint *ids), (n, ids), 0) \
+    X(glDeleteRenderbuffers, (GLsizei n, const GLuint *renderbuffers), (n, renderbuffers), 0) \
+    X(glDeleteShader, (GLuint shader), (shader), 0) \
+    X(glDeleteSync, (GLsync sync), (sync), 0) \
+    X(glDeleteTextures, (GLsizei n, const GLuint *textures), (n, textures), 0) \
+    X(glDeleteVertexArrays, (GLsizei n, const GLuint *arrays), (n, arrays), 0) \
+    X(glDepthFunc, (GLenum func), (func), 0) \
+    X(glDisable, (GLenum cap), (cap), 0) \
+    X(glDispatchCompute, (GLuint x, GLuint y, GLuint z), (x, y, z), 0) \
+    X(glDrawArrays, (GLenum mode, GLint first, GLsizei count), (mode, first, count), 0) \
+    X(glDrawArraysInstancedBaseInstance, (GLenum mode, GLint first, GLsizei count, GLsizei instances, \
+                                          GLuint base_instance), (mode, first, count, instances, base_instance), 0) \
+    X(glDrawElementsInstancedBaseVertexBaseInstance, (GLenum mode, GLsizei count, GLenum type, const void *indices, \
+      GLsizei instances, GLint base_vertex, GLuint base_instance), \
+      (mode, count, type, indices, instances, base_vertex, base_instance), 0) \
+    X(glEnable, (GLenum cap), (cap), 0) \
+    X(glEnableVertexAttribArray, (GLuint index), (index), 0) \
+    R(GLsync, glFenceSync, (GLenum condition, GLbitfield flags), (condition, flags), 0) \
+    X(glFlush, (void), (), 0) \
+    X(glFramebufferRenderbuffer, (GLenum target, GLenum attachment, GLenum renderbuffer_target, GLuint renderbuffer), \
+      (target, attachment, renderbuffer_target, renderbuffer), 0) \
+    X(glFramebufferTexture2D, (GLenum target, GLenum attachment, GLenum texture_target, GLuint texture, GLint level), \
+      (target, attachment, texture_target, texture, level), 0) \
+    X(glGenBuffers, (GLsizei n, GLuint *buffers), (n, buffers), 0) \
+    X(glGenFramebuffers, (GLsizei n, GLuint *framebuffers), (n, framebuffers), 0) \
+    X(glGenQueries, (GLsizei n, GLuint *ids), (n, ids), 0) \
+    X(glGenRenderbuffers, (GLsizei n, GLuint *renderbuffers), (n, renderbuffers), 0) \
+    X(glGenTextures, (GLsizei n, GLuint *textures), (n, textures), 0) \
+    X(glGenVertexArrays, (GLsizei n, GLuint *arrays), (n, arrays), 0) \
+    R(GLenum, glGetError, (void), (), 0) \
+    X(glGetFramebufferAttachmentParameteriv, (GLenum target, GLenum attachment, GLenum name, GLint *data), \
+      (target, attachment, name, data), 0) \
+    X(glGetIntegerv, (GLenum name, GLint *data), (name, data), 0) \
+    X(glGetQueryObjectiv, (GLuint id, GLenum name, GLint *data), (id, name, data), 0) \
+    X(glGetQueryObjectui64v, (GLuint id, GLenum name, GLuint64 *data), (id, name, data), 0) \
+    X(glGetShaderInfoLog, (GLuint shader, GLsizei size, GLsizei *length, GLchar *log), (shader, size, length, log), 0) \
+    X(glGetShaderiv, (GLuint shader, GLenum name, GLint *data), (shader, name, data), 0) \
+    R(const GLubyte *, glGetString, (GLenum name), (name), 0) \
+    X(glLinkProgram, (GLuint program), (program), 0) \
+    R(void *, glMapBufferRange, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access), \
+      (target, offset, length, access), 0) \
+    X(glMemoryBarrier, (GLbitfield barriers), (barriers), 0) \
+    X(glMultiDrawArraysIndirect, (GLenum mode, const void *indirect, GLsizei count, GLsizei stride), \
+      (mode, indirect, count, stride), 0) \
+    X(glMultiDrawArraysIndirectCountARB, (GLenum mode, const void *indirect, GLintptr drawcount, GLsizei count, \
+      GLsizei stride), (mode, indirect, drawcount, count, stride), 0) \
+    X(glMultiDrawElementsIndirect, (GLenum mode, GLenum type, const void *indirect, GLsizei count, GLsizei stride), \
+      (mode, type, indirect, count, stride), 0) \
+    X(glMultiDrawElementsIndirectCountARB, (GLenum mode, GLenum type, const void *indirect, GLintptr drawcount, \
+      GLsizei count, GLsizei stride), (mode, type, indirect, drawcount, count, stride), 0) \
+    X(glPolygonMode, (GLenum face, GLenum mode), (face, mode), 0) \
+    X(glProgramUniform1i, (GLuint program, GLint location, GLint v), (program, location, v), sizeof(GLint)) \
+    X(glQueryCounter, (GLuint id, GLenum target), (id, target), 0) \
+    X(glRenderbufferStorageMultisample, (GLenum target, GLsizei samples, GLenum internal, GLsizei width, \
+      GLsizei height), (target, samples, internal, width, height), 0) \
+    X(glShaderSource, (GLuint shader, GLsizei count, const GLchar *const *source, const GLint *length), \
+      (shader, count, source, length), 0) \
+    X(glTexStorage2D, (GLenum target, GLsizei levels, GLenum internal, GLsizei width, GLsizei height), \
+      (target, levels, internal, width, height), 0) \
+    X(glTexStorage2DMultisample, (GLenum target, GLsizei samples, GLenum internal, GLsizei width, GLsizei height, \
+      GLboolean fixed_locations), (target, samples, internal, width, height, fixed_locations), 0) \
+    X(glUniform1i, (GLint location, GLint v), (location, v), sizeof(GLint)) \
+    X(glUniform1ui, (GLint location, GLuint v), (location, v), sizeof(GLuint)) \
+    X(glUniform2f, (GLint location, GLfloat v0, GLfloat v1), (location, v0, v1), 2 * sizeof(GLfloat)) \
+    X(glUniform4fv, (GLint location, GLsizei count, const GLfloat *v), (location, count, v), \
+      count * 4 * sizeof(GLfloat)) \
+    X(glUniformMatrix4fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *v), \
+      (location, count, transpose, v), count * 16 * sizeof(GLfloat)) \
+    R(GLboolean, glUnmapBuffer, (GLenum target), (target), 0) \
+    X(glUseProgram, (GLuint program), (program), 0) \
+    X(glVertexAttribBinding, (GLuint attrib, GLuint binding), (attrib, binding), 0) \
+    X(glVertexAttribFormat, (GLuint attrib, GLint size, GLenum type, GLboolean normalized, GLuint offset), \
+      (attrib, size, type, normalized, offset), 0) \
+    X(glViewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height), 0)
+
+
+#ifdef GLTRACE
+
+/// @brief Index of every traced entry point
+#define GLTRACE_INDEX(name, ...) GLTRACE_##name,
+#define GLTRACE_INDEX_R(ret, name, ...) GLTRACE_##name,
+typedef enum GlTraceEntry {
+    GLTRACE_ENTRIES(GLTRACE_INDEX, GLTRACE_INDEX_R)
+    GLTRACE_COUNT
+} gltrace_entry;
+#undef GLTRACE_INDEX
+#undef GLTRACE_INDEX_R
+
+
+/// @brief Cost of an entry point
+/// @param calls number of calls
+/// @param bytes bytes uploaded (buffer data and uniforms)
+/// @param ns CPU time spent in the calls
+typedef struct GlTraceCost {
+    uint64_t calls, bytes, ns;
+} gltrace_cost;
+
+
+/// @brief Tracing state
+/// @param enabled whether calls are traced
+/// @param frame cost of every entry point in the current frame
+/// @param all cost of every entry point over every traced frame
+/// @param frames number of traced frames
+typedef struct GlTrace {
+    int enabled;
+    gltrace_cost frame[GLTRACE_COUNT], all[GLTRACE_COUNT];
+    uint64_t frames;
+} gltrace;
+
+
+/// @brief Tracing state (calls are only made on the thread owning the context)
+extern gltrace gl_trace;
+
+
+/// @brief Switch tracing on or off
+/// @param on whether calls are traced from now on
+void gltrace_enable(const int on);
+
+/// @brief End a frame, adding its costs to the run's (frames in which tracing was off aren't counted)
+void gltrace_frame();
+
+/// @brief Write the mean cost per frame of every entry point called, as JSON
+/// @param out stream to write to
+void gltrace_json(FILE *out);
+
+
+// wrappers of the entry points, which every call below goes through (except in `gltrace.c`)
+#define GLTRACE_DECLARE(name, params, args, bytes) void gltrace_##name params;
+#define GLTRACE_DECLARE_R(ret, name, params, args, bytes) ret gltrace_##name params;
+GLTRACE_ENTRIES(GLTRACE_DECLARE, GLTRACE_DECLARE_R)
+#undef GLTRACE_DECLARE
+#undef GLTRACE_DECLARE_R
+
+#ifndef GLTRACE_IMPL
+    #undef glActiveTexture
+    #define glActiveTexture(...) gltrace_glActiveTexture(__VA_ARGS__)
+    #undef glAttachShader
+    #define glAttachShader(...) gltrace_glAttachShader(__VA_ARGS__)
+    #undef glBindBuffer
+    #define glBindBuffer(...) gltrace_glBindBuffer(__VA_ARGS__)
+    #undef glBindBufferBase
+    #define glBindBufferBase(...) gltrace_glBindBufferBase(__VA_ARGS__)
+    #undef glBindBufferRange
+    #define glBindBufferRange(...) gltrace_glBindBufferRange(__VA_ARGS__)
+    #undef glBindFramebuffer
+    #define glBindFramebuffer(...) gltrace_glBindFramebuffer(__VA_ARGS__)
+    #undef glBindImageTexture
+    #define glBindImageTexture(...) gltrace_glBindImageTexture(__VA_ARGS__)
+    #undef glBindRenderbuffer
+    #define glBindRenderbuffer(...) gltrace_glBindRenderbuffer(__VA_ARGS__)
+    #undef glBindTexture
+    #define glBindTexture(...) gltrace_glBindTexture(__VA_ARGS__)
+    #undef glBindVertexArray
+    #define glBindVertexArray(...) gltrace_glBindVertexArray(__VA_ARGS__)
+    #undef glBindVertexBuffer
+    #define glBindVertexBuffer(...) gltrace_glBindVertexBuffer(__VA_ARGS__)
+    #undef glBlitFramebuffer
+    #define glBlitFramebuffer(...) gltrace_glBlitFramebuffer(__VA_ARGS__)
+    #undef glBufferData
+    #define glBufferData(...) gltrace_glBufferData(__VA_ARGS__)
+    #undef glBufferStorage
+    #define glBufferStorage(...) gltrace_glBufferStorage(__VA_ARGS__)
+    #undef glBufferSubData
+    #define glBufferSubData(...) gltrace_glBufferSubData(__VA_ARGS__)
+    #undef glCheckFramebufferStatus
+    #define glCheckFramebufferStatus(...) gltrace_glCheckFramebufferStatus(__VA_ARGS__)
+    #undef glClear
+    #define glClear(...) gltrace_glClear(__VA_ARGS__)
+    #undef glClearBufferData
+    #define glClearBufferData(...) gltrace_glClearBufferData(__VA_ARGS__)
+    #undef glClearColor
+    #define glClearColor(...) gltrace_glClearColor(__VA_ARGS__)
+    #undef glClientWaitSync
+    #define glClientWaitSync(...) gltrace_glClientWaitSync(__VA_ARGS__)
+    #undef glCompileShader
+    #define glCompileShader(...) gltrace_glCompileShader(__VA_ARGS__)
+    #undef glCopyBufferSubData
+    #define glCopyBufferSubData(...) gltrace_glCopyBufferSubData(__VA_ARGS__)
+    #undef glCreateProgram
+    #define glCreateProgram(...) gltrace_glCreateProgram(__VA_ARGS__)
+    #undef glCreateShader
+    #define glCreateShader(...) gltrace_glCreateShader(__VA_ARGS__)
+    #undef glDeleteBuffers
+    #define glDeleteBuffers(...) gltrace_glDeleteBuffers(__VA_ARGS__)
+    #undef glDeleteFramebuffers
+    #define glDeleteFramebuffers(...) gltrace_glDeleteFramebuffers(__VA_ARGS__)
+    #undef glDeleteProgram
+    #define glDeleteProgram(...) gltrace_glDeleteProgram(__VA_ARGS__)
+    #undef glDeleteQueries
+    #define glDeleteQueries(...) gltrace_glDeleteQueries(__VA_ARGS__)
+    #undef glDeleteRenderbuffers
+    #define glDeleteRenderbuffers(...) gltrace_glDeleteRenderbuffers(__VA_ARGS__)
+    #undef glDeleteShader
+    #define glDeleteShader(...) gltrace_glDeleteShader(__VA_ARGS__)
+    #undef glDeleteSync
+    #define glDeleteSync(...) gltrace_glDeleteSync(__VA_ARGS__)
+    #undef glDeleteTextures
+    #define glDeleteTextures(...) gltrace_glDeleteTextures(__VA_ARGS__)
+    #undef glDeleteVertexArrays
+    #define glDeleteVertexArrays(...) gltrace_glDeleteVertexArrays(__VA_ARGS__)
+    #undef glDepthFunc
+    #define glDepthFunc(...) gltrace_glDepthFunc(__VA_ARGS__)
+    #undef glDisable
+    #define glDisable(...) gltrace_glDisable(__VA_ARGS__)
+    #undef glDispatchCompute
+    #define glDispatchCompute(...) gltrace_glDispatchCompute(__VA_ARGS__)
+    #undef glDrawArrays
+    #define glDrawArrays(...) gltrace_glDrawArrays(__VA_ARGS__)
+    #undef glDrawArraysInstancedBaseInstance
+    #define glDrawArraysInstancedBaseInstance(...) gltrace_glDrawArraysInstancedBaseInstance(__VA_ARGS__)
+    #undef glDrawElementsInstancedBaseVertexBaseInstance
+    #define glDrawElementsInstancedBaseVertexBaseInstance(...) \
+        gltrace_glDrawElementsInstancedBaseVertexBaseInstance(__VA_ARGS__)
+    #undef glEnable
+    #define glEnable(...) gltrace_glEnable(__VA_ARGS__)
+    #undef glEnableVertexAttribArray
+    #define glEnableVertexAttribArray(...) gltrace_glEnableVertexAttribArray(__VA_ARGS__)
+    #undef glFenceSync
+    #define glFenceSync(...) gltrace_glFenceSync(__VA_ARGS__)
+    #undef glFlush
+    #define glFlush(...) gltrace_glFlush(__VA_ARGS__)
+    #undef glFramebufferRenderbuffer
+    #define glFramebufferRenderbuffer(...) gltrace_glFramebufferRenderbuffer(__VA_ARGS__)
+    #undef glFramebufferTexture2D
+    #define glFramebufferTexture2D(...) gltrace_glFramebufferTexture2D(__VA_ARGS__)
+    #undef glGenBuffers
+    #define glGenBuffers(...) gltrace_glGenBuffers(__VA_ARGS__)
+    #undef glGenFramebuffers
+    #define glGenFramebuffers(...) gltrace_glGenFramebuffers(__VA_ARGS__)
+    #undef glGenQueries
+    #define glGenQueries(...) gltrace_glGenQueries(__VA_ARGS__)
+    #undef glGenRenderbuffers
+    #define glGenRenderbuffers(...) gltrace_glGenRenderbuffers(__VA_ARGS__)
+    #undef glGenTextures
+    #define glGenTextures(...) gltrace_glGenTextures(__VA_ARGS__)
+    #undef glGenVertexArrays
+    #define glGenVertexArrays(...) gltrace_glGenVertexArrays(__VA_ARGS__)
+    #undef glGetError
+    #define glGetError(...) gltrace_glGetError(__VA_ARGS__)
+    #undef glGetFramebufferAttachmentParameteriv
+    #define glGetFramebufferAttachmentParameteriv(...) gltrace_glGetFramebufferAttachmentParameteriv(__VA_ARGS__)
+    #undef glGetIntegerv
+    #define glGetIntegerv(...) gltrace_glGetIntegerv(__VA_ARGS__)
+    #undef glGetQueryObjectiv
+    #define glGetQueryObjectiv(...) gltrace_glGetQueryObjectiv(__VA_ARGS__)
+    #undef glGetQueryObjectui64v
+    #define glGetQueryObjectui64v(...) gltrace_glGetQueryObjectui64v(__VA_ARGS__)
+    #undef glGetShaderInfoLog
+    #define glGetShaderInfoLog(...) gltrace_glGetShaderInfoLog(__VA_ARGS__)
+    #undef glGetShaderiv
+    #define glGetShaderiv(...) gltrace_glGetShaderiv(__VA_ARGS__)
+    #undef glGetString
+    #define glGetString(...) gltrace_glGetString(__VA_ARGS__)
+    #undef glLinkProgram
+    #define glLinkProgram(...) gltrace_glLinkProgram(__VA_ARGS__)
+    #undef glMapBufferRange
+    #define glMapBufferRange(...) gltrace_glMapBufferRange(__VA_ARGS__)
+    #undef glMemoryBarrier
+    #define glMemoryBarrier(...) gltrace_glMemoryBarrier(__VA_ARGS__)
+    #undef glMultiDrawArraysIndirect
+    #define glMultiDrawArraysIndirect(...) gltrace_glMultiDrawArraysIndirect(__VA_ARGS__)
+    #undef glMultiDrawArraysIndirectCountARB
+    #define glMultiDrawArraysIndirectCountARB(...) gltrace_glMultiDrawArraysIndirectCountARB(__VA_ARGS__)
+    #undef glMultiDrawElementsIndirect
+    #define glMultiDrawElementsIndirect(...) gltrace_glMultiDrawElementsIndirect(__VA_ARGS__)
+    #undef glMultiDrawElementsIndirectCountARB
+    #define glMultiDrawElementsIndirectCountARB(...) gltrace_glMultiDrawElementsIndirectCountARB(__VA_ARGS__)
+    #undef glPolygonMode
+    #define glPolygonMode(...) gltrace_glPolygonMode(__VA_ARGS__)
+    #undef glProgramUniform1i
+    #define glProgramUniform1i(...) gltrace_glProgramUniform1i(__VA_ARGS__)
+    #undef glQueryCounter
+    #define glQueryCounter(...) gltrace_glQueryCounter(__VA_ARGS__)
+    #undef glRenderbufferStorageMultisample
+    #define glRenderbufferStorageMultisample(...) gltrace_glRenderbufferStorageMultisample(__VA_ARGS__)
+    #undef glShaderSource
+    #define glShaderSource(...) gltrace_glShaderSource(__VA_ARGS__)
+    #undef glTexStorage2D
+    #define glTexStorage2D(...) gltrace_glTexStorage2D(__VA_ARGS__)
+    #undef glTexStorage2DMultisample
+    #define glTexStorage2DMultisample(...) gltrace_glTexStorage2DMultisample(__VA_ARGS__)
+    #undef glUniform1i
+    #define glUniform1i(...) gltrace_glUniform1i(__VA_ARGS__)
+    #undef glUniform1ui
+    #define glUniform1ui(...) gltrace_glUniform1ui(__VA_ARGS__)
+    #undef glUniform2f
+    #define glUniform2f(...) gltrace_glUniform2f(__VA_ARGS__)
+    #undef glUniform4fv
+    #define glUniform4fv(...) gltrace_glUniform4fv(__VA_ARGS__)
+    #undef glUniformMatrix4fv
+    #define glUniformMatrix4fv(...) gltrace_glUniformMatrix4fv(__VA_ARGS__)
+    #undef glUnmapBuffer
+    #define glUnmapBuffer(...) gltrace_glUnmapBuffer(__VA_ARGS__)
+    #undef glUseProgram
+    #define glUseProgram(...) gltrace_glUseProgram(__VA_ARGS__)
+    #undef glVertexAttribBinding
+    #define glVertexAttribBinding(...) gltrace_glVertexAttribBinding(__VA_ARGS__)
+    #undef glVertexAttribFormat
+    #define glVertexAttribFormat(...) gltrace_glVertexAttribFormat(__VA_ARGS__)
+    #undef glViewport
+    #define glViewport(...) gltrace_glViewport(__VA_ARGS__)
+#endif
+
+#else
+
+// without `GLTRACE`, every call goes straight to GL
+#define gltrace_enable(on) ((void)0)
+#define gltrace_frame() ((void)0)
+
+#endif
+
+#endif
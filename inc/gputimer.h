@@ -0,0 +1,55 @@
+/// GPU-side frame timing through a ring of in-flight `GL_TIMESTAMP` queries.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include "prof.h"
+
+
+// number of frames whose queries may be in flight at once
+#define GPU_TIMER_RING 4
+
+// timestamps taken per frame (one before the first phase, one after each phase)
+#define GPU_STAMPS (GPU_PHASE_COUNT + 1)
+
+
+/// @brief GPU timer state
+/// @param queries query objects, one set per in-flight frame
+/// @param pending whether the queries of a slot were issued and not read back yet
+/// @param frame index of the current frame
+/// @param stamp number of timestamps issued in the current frame
+/// @param dropped number of frames whose results were not ready before their slot got reused
+typedef struct GpuTimer {
+    uint queries[GPU_TIMER_RING][GPU_STAMPS];
+    GLboolean pending[GPU_TIMER_RING];
+    uint64_t frame;
+    uint stamp;
+    uint64_t dropped;
+} gpu_timer;
+
+
+/// @brief Create the query objects
+/// @param t timer pointer
+void gpu_timer_init(gpu_timer *t);
+
+/// @brief Read back every finished frame (without waiting on the GPU) and start a new frame
+/// @param t timer pointer
+/// @param p profiler receiving the results
+void gpu_timer_begin(gpu_timer *t, profiler *p);
+
+/// @brief Mark the end of a phase in the GPU command stream
+/// @param t timer pointer
+/// @param ph the phase that was just submitted
+void gpu_timer_mark(gpu_timer *t, const gpu_phase ph);
+
+/// @brief Finish the current frame
+/// @param t timer pointer
+void gpu_timer_end(gpu_timer *t);
+
+/// @brief Delete the query objects
+/// @param t timer pointer
+void gpu_timer_free(gpu_timer *t);
+
+#endif
@@ -0,0 +1,51 @@
+/// Offscreen rendering context (EGL surfaceless, or a hidden GLFW window as a fallback) drawing into an FBO.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "util.h"
+#include <EGL/egl.h>
+#include <stdint.h>
+
+
+// number of frames the CPU may run ahead of the GPU (like a double-buffered swap chain)
+#define HEADLESS_LATENCY 2
+
+
+/// @brief Offscreen context and its render target
+/// @param display EGL display (`EGL_NO_DISPLAY` when the GLFW fallback is used)
+/// @param context EGL context
+/// @param window hidden GLFW window (only when EGL is unavailable)
+/// @param fbo framebuffer object everything is rendered into
+/// @param color color renderbuffer
+/// @param depth depth renderbuffer
+/// @param fences one fence per in-flight frame
+/// @param frame number of presented frames
+typedef struct Headless {
+    EGLDisplay display;
+    EGLContext context;
+    GLFWwindow *window;
+    uint fbo, color, depth;
+    GLsync fences[HEADLESS_LATENCY];
+    uint64_t frame;
+} headless;
+
+
+/// @brief Create an offscreen context with a `w` by `h` framebuffer (exits on failure, like `init`)
+/// @param hl headless pointer
+/// @param w framebuffer width
+/// @param h framebuffer height
+/// @param samples number of MSAA samples
+void init_headless(headless *hl, const uint w, const uint h, const uint samples);
+
+/// @brief Finish a frame, waiting only when the GPU is more than `HEADLESS_LATENCY` frames behind
+/// @param hl headless pointer
+void headless_swap(headless *hl);
+
+/// @brief Destroy the framebuffer and the context
+/// @param hl headless pointer
+void headless_free(headless *hl);
+
+#endif
@@ -0,0 +1,92 @@
+/// Hierarchical depth (Hi-Z): a pyramid of the farthest depth under every texel of the last frame's depth buffer,
+/// built by a compute downsample chain, so the culling pass can tell objects hidden behind what was drawn.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef HIZ_H
+#define HIZ_H
+
+#include "util.h"
+
+
+// texture unit the pyramid (and a depth buffer without samples) is read from
+#define HIZ_UNIT 0
+
+// texture unit a multisampled depth buffer is read from
+#define HIZ_UNIT_SAMPLES 1
+
+// invocations per side of a work group of the downsample pass
+#define HIZ_GROUP 8
+
+// most levels of the pyramid (enough for a 32768-pixel side)
+#define HIZ_MAX_LEVELS 16
+
+// level shown first by `HIZ_SHOW`
+#define HIZ_SHOW_LEVEL 3
+
+
+/// @brief Whether objects are culled against the depth pyramid
+typedef enum HizMode {
+    HIZ_OFF,
+    HIZ_ON,
+    HIZ_SHOW, // culled, and a level of the pyramid is drawn over the frame
+    HIZ_MODE_COUNT
+} hiz_mode;
+
+
+/// @brief Names of the modes, as used on the command line
+extern const char *HIZ_MODE_NAMES[HIZ_MODE_COUNT];
+
+
+/// @brief Depth pyramid state
+/// @param mode whether objects are culled against the pyramid, and whether it is shown
+/// @param reduce compute program building a level from the one below (or from the depth buffer)
+/// @param show program drawing a level of the pyramid over the frame (with `HIZ_SHOW`)
+/// @param fbo framebuffer the depth buffer is copied into
+/// @param depth depth texture of `fbo`, in the format of the drawn depth buffer (and with as many samples)
+/// @param format internal format of `depth`
+/// @param samples samples per pixel of `depth` (0 if it isn't multisampled)
+/// @param pyramid texture of the farthest depths (`GL_R32F`), one level per halving of the size (rounded down,
+/// the last texel of a row or column also covering the one left over)
+/// @param width width of the pyramid's first level (the framebuffer's)
+/// @param height height of the pyramid's first level
+/// @param levels number of levels, down to a single texel
+/// @param clip projection times view matrix of the frame the pyramid was built from
+/// @param ready whether the pyramid was built (from a frame of the current size)
+/// @param level level drawn over the frame with `HIZ_SHOW`
+typedef struct Hiz {
+    hiz_mode mode;
+    uint reduce, show;
+    uint fbo, depth;
+    GLenum format;
+    uint samples;
+    uint pyramid;
+    uint width, height, levels;
+    mat4x4 clip;
+    int ready;
+    uint level;
+} hiz;
+
+
+/// @brief Compile the programs (the textures are made for the first frame's size)
+/// @param h pyramid pointer
+/// @param mode whether objects are culled against the pyramid (nothing is created with `HIZ_OFF`)
+void hiz_init(hiz *h, const hiz_mode mode);
+
+/// @brief Build the pyramid from the depth buffer of the bound draw framebuffer, as the frame just drawn left it
+/// @param h pyramid pointer
+/// @param clip projection times view matrix of the frame
+/// @param width framebuffer width
+/// @param height framebuffer height
+void hiz_build(hiz *h, mat4x4 const clip, const uint width, const uint height);
+
+/// @brief Draw a level of the pyramid over the frame, from near (black) to far (white) on a logarithmic scale
+/// @param h pyramid pointer
+/// @param projection projection matrix (for the near and far planes)
+void hiz_show(const hiz *h, mat4x4 const projection);
+
+/// @brief Delete the programs and textures
+/// @param h pyramid pointer
+void hiz_free(hiz *h);
+
+#endif
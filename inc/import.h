@@ -0,0 +1,79 @@
+/// Streaming importer of Wavefront OBJ and PLY meshes. The file is mapped and split into chunks, parsed a
+/// wave at a time by a thread of its own and its pool, while the calling thread welds the vertices of
+/// every finished mesh and hands it on, so meshes are uploaded while later chunks are still being parsed.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include "scene.h"
+
+
+// bytes of a file per chunk
+#define IMPORT_CHUNK (1u << 20)
+
+// chunks per wave, for each parsing thread
+#define IMPORT_WAVE 2
+
+
+/// @brief Receives every mesh of a file, in the order of the file
+/// @param ctx data passed to the importer
+/// @param name name of the mesh (its OBJ object or group, or `mesh`)
+/// @param n size of vertices array (three floats per vertex, no two vertices at the same position)
+/// @param m size of indices array (three per triangle, polygons split into fans)
+/// @param vertices vertex positions array
+/// @param indices indices array
+typedef void (*import_fn)(void *ctx, const char *name, const uint n, const uint m, const float *vertices,
+                          const uint *indices);
+
+
+/// @brief What an import read, and how fast
+/// @param bytes size of the file
+/// @param meshes number of meshes
+/// @param vertices_read number of vertices in the file
+/// @param vertices number of vertices handed on (once welded, per mesh)
+/// @param triangles number of triangles
+/// @param ms time from opening the file to handing the last mesh on, in milliseconds
+/// @param mb_s throughput, in megabytes per second
+/// @param triangles_s throughput, in triangles per second
+typedef struct ImportStats {
+    uint64_t bytes;
+    uint meshes;
+    uint64_t vertices_read, vertices, triangles;
+    double ms, mb_s, triangles_s;
+} import_stats;
+
+
+/// @brief Whether a path names a file the importer reads (by its `.obj` or `.ply` extension)
+/// @param path path to the file
+/// @return 1 if it does, 0 otherwise
+int import_supports(const char *path);
+
+/// @brief Read an OBJ or PLY file (ASCII, or little-endian binary), handing its meshes on as they're done
+/// @param path path to the file
+/// @param threads threads parsing the chunks (0 for one per core), besides the calling thread
+/// @param fn receives the meshes, on the calling thread
+/// @param ctx data passed to `fn`
+/// @param stats what was read (may be `NULL`)
+/// @return 1 on success, 0 (after printing the file and line at fault) otherwise
+int import_file(const char *path, const uint threads, import_fn fn, void *ctx, import_stats *stats);
+
+/// @brief Import a file into the world, as an object per mesh, placed as modelled
+/// @param wd world pointer
+/// @param program program used by every object
+/// @param path path to the file
+/// @param threads threads parsing the chunks (0 for one per core)
+/// @param info information on the imported scene
+/// @param stats what was read (may be `NULL`)
+/// @return 1 on success, 0 (after printing the error) otherwise
+int import_load(world *wd, const uint program, const char *path, const uint threads, scene_info *info,
+                import_stats *stats);
+
+/// @brief Print a line with the throughput of an import
+/// @param st what was read
+/// @param path path to the file
+/// @param out output stream
+void import_report(const import_stats *st, const char *path, FILE *out);
+
+#endif
@@ -0,0 +1,71 @@
+/// Pool of worker threads that split loops over large arrays between the cores.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "util.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+
+// most worker threads (besides the calling thread)
+#define JOBS_MAX_THREADS 63
+
+
+/// @brief Work on a range of a loop
+/// @param ctx data shared by every range
+/// @param first first item of the range
+/// @param count number of items in the range
+typedef void (*job_fn)(void *ctx, const uint first, const uint count);
+
+
+/// @brief Worker threads, and the loop they're working on
+/// @param threads worker threads
+/// @param threads_len number of worker threads (0 runs every loop on the calling thread)
+/// @param lock guards everything below
+/// @param start signalled when a loop starts (or the pool is freed)
+/// @param done signalled when the last worker is done with a loop
+/// @param fn function of the current loop
+/// @param ctx data of the current loop
+/// @param len number of items of the current loop
+/// @param grain number of items taken at a time
+/// @param next first item no thread has taken yet
+/// @param active number of workers still on the current loop
+/// @param generation incremented with every loop, so workers tell a new loop from a spurious wake-up
+/// @param quit set when the pool is freed
+typedef struct JobPool {
+    pthread_t *threads;
+    uint threads_len;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start, done;
+    job_fn fn;
+    void *ctx;
+    uint len, grain;
+    atomic_uint next;
+    uint active, generation;
+    int quit;
+} job_pool;
+
+
+/// @brief Start the worker threads
+/// @param p pool pointer
+/// @param threads number of threads working on a loop, including the calling one (0 for one per core)
+void jobs_init(job_pool *p, uint threads);
+
+/// @brief Run `fn` over the ranges of `[0, len)`, on the workers and the calling thread, and wait for every range
+/// (loops that fit in one range run on the calling thread alone)
+/// @param p pool pointer
+/// @param fn function run on each range
+/// @param ctx data passed to every range
+/// @param len number of items
+/// @param grain number of items per range
+void jobs_run(job_pool *p, job_fn fn, void *ctx, const uint len, const uint grain);
+
+/// @brief Stop the worker threads
+/// @param p pool pointer
+void jobs_free(job_pool *p);
+
+#endif
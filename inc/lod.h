@@ -0,0 +1,127 @@
+/// Levels of detail: simplified versions of a mesh, made by quadric error edge collapses (Garland and Heckbert)
+/// that move a vertex onto a neighbour, so every version indexes the mesh's own vertices and only needs indices
+/// of its own. A version is drawn once its error, projected onto the screen, is small enough.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef LOD_H
+#define LOD_H
+
+#include "jobs.h"
+#include "meshlet.h"
+#include <stdint.h>
+
+
+// most simplified versions of a mesh (besides the mesh itself)
+#define LOD_MAX 4
+
+// vertices each thread takes at a time while looking for their cheapest collapse
+#define LOD_GRAIN 16384
+
+// doubles of an error quadric
+#define LOD_QUADRIC 11
+
+// simplified versions made of a mesh unless set otherwise
+#define LOD_DEFAULT 3
+
+// meshes with fewer triangles are always drawn whole
+#define LOD_MIN_TRIANGLES 1024
+
+// each version keeps about this fraction of the triangles of the one before
+#define LOD_RATIO 0.25f
+
+// a version that removes less than this fraction of the triangles of the one before isn't kept
+#define LOD_MIN_GAIN 0.1f
+
+// largest error of a drawn version, projected onto the screen, in pixels
+#define LOD_PIXELS 1.0f
+
+// a version is only left once its projected error is off by this fraction of `LOD_PIXELS`, so objects close
+// to a threshold don't switch back and forth
+#define LOD_HYSTERESIS 0.25f
+
+
+/// @brief Version of a mesh
+/// @param first_index first index of the version in the index arena, counted in indices of the mesh's type
+/// @param indices_len size of the indices array
+/// @param error largest distance of the version to the mesh, in object space (0 for the mesh itself)
+/// @param meshlets clusters of the version's indices, which are ordered meshlet by meshlet (`NULL` if it has none)
+/// @param meshlets_len number of meshlets
+typedef struct LodLevel {
+    uint first_index, indices_len;
+    float error;
+    meshlet *meshlets;
+    uint meshlets_len;
+} lod_level;
+
+
+/// @brief Edge collapses in progress on a mesh (vertices on a border, or sharing their position with another
+/// vertex, such as the seam of a sphere, stay where they are, so the mesh never opens up)
+/// @param jobs worker threads (`NULL` for the calling thread alone)
+/// @param count number of vertices
+/// @param positions vertex positions
+/// @param quadrics error quadric of every vertex (the upper triangle of a symmetric 4x4 matrix, then the area
+/// it is weighed by)
+/// @param locked whether every vertex stays
+/// @param indices indices of the current version
+/// @param m size of indices array
+/// @param error largest error of a collapse so far (in object space, as a root mean square distance)
+typedef struct LodSimplifier {
+    job_pool *jobs;
+    uint count;
+    const vec3 *positions;
+    double (*quadrics)[LOD_QUADRIC];
+    uint8_t *locked;
+    uint *indices;
+    uint m;
+    float error;
+} lod_simplifier;
+
+
+/// @brief Start simplifying an indexed triangle mesh
+/// @param s simplifier pointer
+/// @param jobs worker threads (`NULL` for the calling thread alone)
+/// @param count number of vertices
+/// @param positions vertex positions (which must outlive the simplifier)
+/// @param m size of indices array
+/// @param indices indices array (copied)
+void lod_init(lod_simplifier *s, job_pool *jobs, const uint count, const vec3 *positions, const uint m,
+              const uint *indices);
+
+/// @brief Collapse the cheapest edges (a set of independent ones at a time) until at most `triangles` are left,
+/// or no edge can go without flipping a triangle
+/// @param s simplifier pointer
+/// @param triangles number of triangles to get down to
+/// @return size of the indices array left (`s->indices`)
+uint lod_reduce(lod_simplifier *s, const uint triangles);
+
+/// @brief Release a simplifier
+/// @param s simplifier pointer
+void lod_free(lod_simplifier *s);
+
+/// @brief Make the simplified versions of an indexed triangle mesh, each with about `LOD_RATIO` of the triangles of
+/// the one before, until one would barely be simpler (none for meshes under `LOD_MIN_TRIANGLES` triangles, or whose
+/// indices aren't all within the vertices)
+/// @param jobs worker threads (`NULL` for the calling thread alone)
+/// @param count number of vertices
+/// @param vertices position of the first vertex (then every `stride` bytes)
+/// @param stride distance between vertices, in bytes
+/// @param m size of indices array
+/// @param indices indices array
+/// @param levels most versions to make (at most `LOD_MAX` are)
+/// @param out set to the versions made (with `first_index` counted from the start of `out_indices`)
+/// @param out_indices set to the indices of every version, one after the other, on the heap (`NULL` without any)
+/// @return number of versions made
+uint lod_build(job_pool *jobs, const uint count, const void *vertices, const size_t stride, const uint m,
+               const uint *indices, const uint levels, lod_level *out, uint **out_indices);
+
+/// @brief Pick the version of an object to draw, moving away from the current one only once it is off by more
+/// than `LOD_HYSTERESIS`
+/// @param levels versions of the mesh (with increasing errors, the first being the mesh itself)
+/// @param len number of versions
+/// @param current version drawn so far
+/// @param pixels size of one unit of object space on the screen, in pixels (0 or less draws the full mesh)
+/// @return the version to draw
+uint lod_select(const lod_level *levels, const uint len, const uint current, const float pixels);
+
+#endif
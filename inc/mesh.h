@@ -0,0 +1,208 @@
+/// Mesh registry, so objects with the same geometry share a single set of buffers.
+/// Every mesh lives at an offset in one vertex arena and one index arena, read through a single VAO.
+/// Normals are generated as meshes are created, and stored next to their positions in the registry's vertex format.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef MESH_H
+#define MESH_H
+
+#include "arena.h"
+#include "lod.h"
+#include "meshlet.h"
+#include "meshopt.h"
+#include "normals.h"
+#include "vformat.h"
+
+
+// returned by `mesh_find` when no mesh has the name
+#define MESH_NONE (~0u)
+
+// longest mesh name (including the terminator)
+#define MESH_NAME_LEN 32
+
+// initial room in the arenas (they double whenever they run out)
+#define MESH_ARENA_VERTICES (1u << 16)
+#define MESH_ARENA_INDICES (1u << 18)
+
+// most vertices of a mesh whose indices are uploaded in 16 bits
+#define MESH_SHORT_VERTICES (1u << 16)
+
+// size of an index of a type, in bytes
+#define MESH_INDEX_SIZE(type) ((type) == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint))
+
+
+/// @brief Vertex as generated, and as stored in the vertex arena in the `VFORMAT_F32` format
+/// @param pos position
+/// @param norm normal
+typedef struct Vertex {
+    vec3 pos, norm;
+} vertex;
+
+
+/// @brief Axis-aligned bounding box
+/// @param lo smallest corner
+/// @param hi largest corner
+typedef struct Aabb {
+    vec3 lo, hi;
+} aabb;
+
+
+/// @brief Geometry uploaded to the GPU, in object space
+/// @param base_vertex first vertex of the mesh in the vertex arena
+/// @param first_index first index of the mesh in the index arena, counted in indices of its type
+/// @param vertices_len size of the vertices' positions array (three floats per vertex)
+/// @param indices_len size of the indices array
+/// @param mode rendering mode
+/// @param has_ebo whether the mesh is drawn with its indices
+/// @param index_type type of the indices (`GL_UNSIGNED_SHORT` up to `MESH_SHORT_VERTICES` vertices,
+/// `GL_UNSIGNED_INT` above, 0 without indices)
+/// @param bytes GPU memory used by the mesh
+/// @param sphere bounding sphere (center and radius)
+/// @param box bounding box
+/// @param dequant center and scale of the stored positions (see `vformat_dequant`)
+/// @param lods number of versions (1 for the mesh alone, 0 once destroyed)
+/// @param lod versions of the mesh, the mesh itself first and then simplified ones (see `lod.h`), all sharing its
+/// vertices and index type, each with meshlets of its own if it is large enough
+/// @param name name used to share the mesh (empty if it is not shared)
+typedef struct Mesh {
+    uint base_vertex, first_index, vertices_len, indices_len;
+    GLenum mode;
+    GLboolean has_ebo;
+    GLenum index_type;
+    size_t bytes;
+    vec4 sphere;
+    aabb box;
+    vec4 dequant;
+    uint lods;
+    lod_level lod[LOD_MAX + 1];
+    char name[MESH_NAME_LEN];
+} mesh;
+
+
+/// @brief All meshes
+/// @param meshes array of meshes
+/// @param len number of meshes
+/// @param cap number of meshes there is room for
+/// @param vao vertex array object shared by every mesh (0 until the first mesh is created)
+/// @param vertices arena of vertices (positions and normals, in `format`)
+/// @param indices arena of indices (32-bit elements, each holding one index or two 16-bit ones)
+/// @param jobs worker threads normals are generated on (`NULL` for the calling thread alone)
+/// @param optimize how the indices of new meshes are reordered (`MESHOPT_NONE` unless set)
+/// @param opt what reordering the indices gained, and how many meshes have 16-bit ones
+/// @param format format of the vertex arena (`VFORMAT_F32` unless set before the first mesh)
+/// @param lods most simplified versions made of every new mesh (none unless set, at most `LOD_MAX`)
+/// @param clusters whether new meshes and versions of `MESHLET_MIN_TRIANGLES` triangles or more are split into
+/// meshlets (not unless set)
+typedef struct MeshRegistry {
+    mesh *meshes;
+    uint len, cap;
+    uint vao;
+    arena vertices, indices;
+    job_pool *jobs;
+    meshopt_mode optimize;
+    meshopt_stats opt;
+    vertex_format format;
+    uint lods;
+    int clusters;
+} mesh_registry;
+
+
+/// @brief Generate the normals of some geometry, reorder its indices (see `meshopt.h`), upload both into the
+/// arenas, register them as a new mesh and make its simplified versions (flat normals unshare the corners of the
+/// triangles, so the mesh is no longer indexed; meshes other than `GL_TRIANGLES` get normals pointing away from the
+/// origin)
+/// @param mr registry pointer
+/// @param name name to share the mesh under (`NULL` for a private mesh)
+/// @param n size of vertices array
+/// @param m size of indices array
+/// @param vertices vertex positions array
+/// @param indices indices array
+/// @param mode rendering mode
+/// @param normals how the normals are generated
+/// @return index of the mesh
+uint mesh_create(mesh_registry *mr, const char *name, const uint n, const uint m, const float *vertices, const uint *indices,
+                 const GLenum mode, const normal_mode normals);
+
+/// @brief Upload vertices (with their normals) and indices as they are, and register them as a new mesh
+/// (the data is copied by GL straight from the pointers, which may point into a mapped file, unless the
+/// vertices are packed into the registry's format, or the indices reordered into meshlets or narrowed to
+/// 16 bits first)
+/// @param mr registry pointer
+/// @param name name to share the mesh under (`NULL` for a private mesh)
+/// @param count number of vertices
+/// @param m size of indices array
+/// @param vertices vertices array
+/// @param indices indices array
+/// @param mode rendering mode
+/// @param box bounding box of the vertices
+/// @param sphere bounding sphere of the vertices
+/// @return index of the mesh
+uint mesh_upload(mesh_registry *mr, const char *name, const uint count, const uint m, const vertex *vertices,
+                 const uint *indices, const GLenum mode, const aabb *box, vec4 const sphere);
+
+/// @brief Make the simplified versions of a mesh just uploaded, each with about `LOD_RATIO` of the triangles of the
+/// one before (only meshes of `GL_TRIANGLES` with at least `LOD_MIN_TRIANGLES` have any), and upload their indices
+/// @param mr registry pointer
+/// @param me index of the mesh
+/// @param vertices the mesh's vertices, as uploaded
+/// @param indices the mesh's indices, as uploaded
+void mesh_lods(mesh_registry *mr, const uint me, const vertex *vertices, const uint *indices);
+
+/// @brief Upload the indices of a simplified version of a mesh (made beforehand, such as those of a scene file),
+/// after its versions so far, split into meshlets if it is large enough
+/// @param mr registry pointer
+/// @param me index of the mesh
+/// @param vertices the mesh's vertices, as uploaded
+/// @param m size of indices array
+/// @param indices indices of the version, into the mesh's vertices
+/// @param error largest distance of the version to the mesh, in object space
+void mesh_lod(mesh_registry *mr, const uint me, const vertex *vertices, const uint m, const uint *indices,
+              const float error);
+
+/// @brief Make room in the arenas for meshes about to be uploaded, growing each at most once
+/// @param mr registry pointer
+/// @param vertices number of vertices
+/// @param indices number of indices
+void mesh_reserve(mesh_registry *mr, const uint vertices, const uint indices);
+
+/// @brief Generate the normals of some geometry and interleave them with its positions, as `mesh_create` does
+/// @param jobs worker threads (`NULL` for the calling thread alone)
+/// @param count number of vertices (replaced by the number of vertices generated)
+/// @param m size of indices array (replaced by the number of indices left, 0 once flat normals unshared the corners)
+/// @param vertices vertex positions array
+/// @param indices indices array
+/// @param mode rendering mode
+/// @param normals how the normals are generated
+/// @return the vertices, on the heap
+vertex *mesh_vertices(job_pool *jobs, uint *count, uint *m, const float *vertices, const uint *indices,
+                      const GLenum mode, const normal_mode normals);
+
+/// @brief Bounding box of some vertex positions, and a bounding sphere around its center
+/// @param box bounding box
+/// @param sphere bounding sphere (center and radius)
+/// @param n size of vertices array
+/// @param vertices vertex positions array
+void mesh_bounds(aabb *box, vec4 sphere, const uint n, const float *vertices);
+
+/// @brief Return a mesh's ranges to the arenas (its index stays taken, and objects using it must be gone)
+/// @param mr registry pointer
+/// @param me index of the mesh
+void mesh_destroy(mesh_registry *mr, const uint me);
+
+/// @brief Look a shared mesh up by its name
+/// @param mr registry pointer
+/// @param name name of the mesh
+/// @return index of the mesh, or `MESH_NONE`
+uint mesh_find(const mesh_registry *mr, const char *name);
+
+/// @brief Total GPU memory used by every mesh
+/// @param mr registry pointer
+/// @return size in bytes
+size_t mesh_bytes(const mesh_registry *mr);
+
+/// @brief Delete every mesh, the arenas and the VAO
+/// @param mr registry pointer
+void mesh_registry_free(mesh_registry *mr);
+
+#endif
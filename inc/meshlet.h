@@ -0,0 +1,59 @@
+/// Meshlets: clusters of neighbouring triangles, each with a bounding sphere and a cone around its normals,
+/// so parts of a large mesh that are off the screen or facing away are skipped before their indices are drawn.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include "util.h"
+
+
+// most vertices of a meshlet
+#define MESHLET_VERTICES 64
+
+// most triangles of a meshlet
+#define MESHLET_TRIANGLES 124
+
+// meshes with fewer triangles are culled whole
+#define MESHLET_MIN_TRIANGLES 1024
+
+
+/// @brief Cluster of triangles, drawn from a range of its mesh's indices
+/// @param sphere bounding sphere of its vertices (center and radius), in object space
+/// @param cone average normal of its triangles (first three components), and the sine of the largest angle
+/// between it and any of their normals (fourth; 1 when they face too many ways to ever all face away)
+/// @param first first index of the meshlet, counted from the first index of its mesh's version
+/// @param indices_len size of the meshlet's indices array
+typedef struct Meshlet {
+    vec4 sphere, cone;
+    uint first, indices_len;
+} meshlet;
+
+
+/// @brief Split a triangle mesh into meshlets, growing each from a triangle through its neighbours (preferring
+/// those that bring the fewest new vertices, then the nearest), and reorder its triangles so that every meshlet's
+/// are contiguous (a mesh whose indices aren't all within its vertices has no meshlets)
+/// @param count number of vertices
+/// @param vertices position of the first vertex (then every `stride` bytes)
+/// @param stride distance between vertices, in bytes
+/// @param m size of indices array
+/// @param indices indices array (reordered in place)
+/// @param len set to the number of meshlets
+/// @return the meshlets, on the heap (`NULL` without any)
+meshlet *meshlet_build(const uint count, const void *vertices, const size_t stride, const uint m, uint *indices,
+                       uint *len);
+
+/// @brief Find the meshlets of an object that may be seen: those whose sphere intersects the view frustum,
+/// and whose triangles don't all face away from the camera (back faces must be culled as they're drawn)
+/// @param meshlets meshlets of the object's mesh
+/// @param len number of meshlets
+/// @param sphere bounding sphere of the whole mesh (every meshlet is skipped when it is out of the frustum)
+/// @param modelview modelview matrix of the object
+/// @param clip projection times modelview matrix of the object
+/// @param visible set to the indices of the meshlets that may be seen
+/// @return number of meshlets that may be seen
+uint meshlet_cull(const meshlet *meshlets, const uint len, vec4 const sphere, mat4x4 const modelview,
+                  mat4x4 const clip, uint *visible);
+
+#endif
@@ -0,0 +1,94 @@
+/// Index buffer optimization: triangles reordered for the post-transform vertex cache (Tipsify), clusters of
+/// them sorted so the outward-facing ones are drawn first (less overdraw), and vertices renumbered in the
+/// order they are first used (fetch locality), with the cache simulated before and after to measure the gain.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef MESHOPT_H
+#define MESHOPT_H
+
+#include "util.h"
+#include <stdint.h>
+
+
+// entries of the simulated (FIFO) post-transform vertex cache, which Tipsify also aims for
+#define MESHOPT_CACHE 16
+
+// largest increase of a cluster's cache misses per triangle accepted when splitting it for overdraw
+#define MESHOPT_THRESHOLD 1.05f
+
+
+/// @brief How much of the optimization runs
+typedef enum MeshoptMode {
+    MESHOPT_NONE, // indices and vertices are kept as given
+    MESHOPT_CACHE_ORDER, // triangles reordered for the vertex cache, vertices for fetching
+    MESHOPT_OVERDRAW, // as above, then clusters of triangles sorted to draw the outward-facing ones first
+    MESHOPT_MODE_COUNT
+} meshopt_mode;
+
+
+/// @brief Names of the modes
+extern const char *MESHOPT_MODE_NAMES[MESHOPT_MODE_COUNT];
+
+
+/// @brief Simulated vertex cache misses of optimized meshes, before and after
+/// @param meshes number of optimized meshes
+/// @param triangles number of their triangles
+/// @param vertices number of their vertices
+/// @param misses_before cache misses of the indices as given
+/// @param misses_after cache misses of the optimized indices
+/// @param clusters clusters sorted for overdraw
+/// @param short_meshes meshes whose indices fit in 16 bits
+typedef struct MeshoptStats {
+    uint meshes;
+    uint64_t triangles, vertices, misses_before, misses_after, clusters;
+    uint short_meshes;
+} meshopt_stats;
+
+
+/// @brief Count the misses of a FIFO vertex cache of `MESHOPT_CACHE` entries drawing some indices
+/// (the average cache miss ratio, ACMR, is the misses per triangle; ATVR is the misses per vertex)
+/// @param count number of vertices
+/// @param m size of indices array
+/// @param indices indices array
+/// @return number of misses
+uint meshopt_misses(const uint count, const uint m, const uint *indices);
+
+/// @brief Whether every index is within the vertices (indices read from a scene file aren't checked as it is
+/// loaded, so passes reading vertices through them check first)
+/// @param count number of vertices
+/// @param m size of indices array
+/// @param indices indices array
+/// @return 1 if they all are, 0 otherwise
+int meshopt_in_range(const uint count, const uint m, const uint *indices);
+
+/// @brief Reorder the triangles of an indexed triangle mesh in place, keeping its vertices as they are (for
+/// indices sharing their vertices with others)
+/// @param mode how much of the optimization runs
+/// @param count number of vertices
+/// @param vertices vertices array, whose first three floats are the position
+/// @param stride size of a vertex, in bytes
+/// @param m size of indices array (three per triangle)
+/// @param indices indices array
+/// @return number of clusters the triangles were sorted in (0 if they were left as they are)
+uint meshopt_triangles(const meshopt_mode mode, const uint count, const void *vertices, const size_t stride,
+                       const uint m, uint *indices);
+
+/// @brief Optimize an indexed triangle mesh in place: reorder its triangles, then renumber its vertices
+/// @param mode how much of the optimization runs
+/// @param count number of vertices
+/// @param vertices vertices array, whose first three floats are the position
+/// @param stride size of a vertex, in bytes
+/// @param m size of indices array (three per triangle)
+/// @param indices indices array
+/// @param stats what was gained, added to (may be `NULL`)
+void meshopt_optimize(const meshopt_mode mode, const uint count, void *vertices, const size_t stride, const uint m,
+                      uint *indices, meshopt_stats *stats);
+
+/// @brief Write the before and after statistics as a JSON object
+/// @param mode mode the meshes were optimized with
+/// @param st the statistics
+/// @param out output stream
+void meshopt_json(const meshopt_mode mode, const meshopt_stats *st, FILE *out);
+
+#endif
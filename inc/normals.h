@@ -0,0 +1,61 @@
+/// Normal generation for indexed meshes: flat normals, or smooth ones weighted by the area or the
+/// corner angle of every triangle around a vertex, shared across vertices welded by position.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef NORMALS_H
+#define NORMALS_H
+
+#include "jobs.h"
+
+
+// largest distance between welded positions, relative to the largest side of the mesh's bounding box
+#define NORMALS_WELD_TOLERANCE 1e-5f
+
+// triangles (or vertices) each thread takes at a time
+#define NORMALS_GRAIN 16384
+
+
+/// @brief How normals are generated
+typedef enum NormalMode {
+    NORMALS_FLAT, // every triangle gets its own corners, facing its own way
+    NORMALS_AREA, // triangles around a vertex weigh by their area
+    NORMALS_ANGLE, // triangles around a vertex weigh by their angle at the vertex
+    NORMALS_MODE_COUNT
+} normal_mode;
+
+
+/// @brief Names of the modes
+extern const char *NORMAL_MODE_NAMES[NORMALS_MODE_COUNT];
+
+
+/// @brief Map every vertex to the first one within `NORMALS_WELD_TOLERANCE` of it, through a hash
+/// map of the grid cells the positions fall into
+/// @param n number of vertices
+/// @param positions vertex positions
+/// @param remap welded vertex of each vertex (a vertex that stays its own maps to itself)
+/// @return number of distinct positions
+uint normals_weld(const uint n, const vec3 *positions, uint *remap);
+
+/// @brief Flat normals, with the corners of every triangle unshared
+/// @param jobs worker threads (`NULL` for the calling thread alone)
+/// @param m number of corners (size of the indices array, or number of vertices without one)
+/// @param positions vertex positions
+/// @param indices indices array (`NULL` when every three vertices form a triangle)
+/// @param corners position of every corner (`NULL` without indices, as the corners are the vertices)
+/// @param normals normal of every corner
+void normals_flat(job_pool *jobs, const uint m, const vec3 *positions, const uint *indices, vec3 *corners, vec3 *normals);
+
+/// @brief Smooth normals, shared by every vertex welded to the same position (vertices no triangle
+/// uses, or only degenerate ones, get zero)
+/// @param jobs worker threads (`NULL` for the calling thread alone)
+/// @param mode `NORMALS_AREA` or `NORMALS_ANGLE`
+/// @param n number of vertices
+/// @param positions vertex positions
+/// @param m number of corners (size of the indices array, or `n` without one)
+/// @param indices indices array (`NULL` when every three vertices form a triangle)
+/// @param normals normal of every vertex
+void normals_smooth(job_pool *jobs, const normal_mode mode, const uint n, const vec3 *positions, const uint m,
+                    const uint *indices, vec3 *normals);
+
+#endif
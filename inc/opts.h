@@ -0,0 +1,58 @@
+/// Command-line options.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef OPTS_H
+#define OPTS_H
+
+#include "render.h"
+#include "scene.h"
+
+
+/// @brief Runtime configuration, filled in from the command line
+/// @param report interval between profiler reports, in seconds (0 disables them)
+/// @param headless render offscreen instead of into a window
+/// @param frames number of frames to render before exiting (0 runs until the window is closed)
+/// @param width framebuffer width (0 picks a default)
+/// @param height framebuffer height (0 picks a default)
+/// @param samples number of MSAA samples
+/// @param threads threads working on the loops over every object (0 for one per core)
+/// @param scene the generated scene
+/// @param file scene file loaded instead of generating a scene (`NULL` for none)
+/// @param optimize how the indices of new meshes are reordered
+/// @param vertex format of the vertices in the vertex arena
+/// @param lods most simplified versions made of every dense mesh
+/// @param clusters split dense meshes into meshlets, and cull them meshlet by meshlet
+/// @param draw how the world is submitted
+/// @param order how the objects of a program are ordered
+/// @param cull how the objects outside of the view are skipped
+/// @param hiz whether objects hidden behind the last frame's depth are skipped too (and the depth is shown)
+/// @param gl_trace count the GL calls made every frame (only in profiling builds)
+/// @param bench_bvh benchmark the bounding-volume hierarchy instead of rendering
+/// @param bench_kernels benchmark the SIMD matrix kernels instead of rendering
+typedef struct Options {
+    double report;
+    int headless;
+    uint frames, width, height, samples, threads;
+    scene_desc scene;
+    const char *file;
+    meshopt_mode optimize;
+    vertex_format vertex;
+    uint lods;
+    int clusters;
+    draw_mode draw;
+    queue_order order;
+    cull_mode cull;
+    hiz_mode hiz;
+    int gl_trace;
+    int bench_bvh, bench_kernels;
+} options;
+
+
+/// @brief Parse the command line, exiting on invalid input or `--help`
+/// @param argc argument count
+/// @param argv argument vector
+/// @return the parsed options
+options parse_opts(int argc, char **argv);
+
+#endif
@@ -0,0 +1,158 @@
+/// Frame-time profiler, recording per-phase CPU time into a fixed-size ring and a log-linear (HDR-style) histogram.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef PROF_H
+#define PROF_H
+
+#include "util.h"
+#include <stdint.h>
+
+
+// number of frames kept in the sample ring (power of two)
+#define PROF_RING 1024
+
+// histogram layout: values below `PROF_SUB` are exact, every power of two above
+// that is split into `PROF_SUB / 2` linear sub-buckets (< 1% relative error)
+#define PROF_SUB_BITS 7
+#define PROF_SUB (1u << PROF_SUB_BITS)
+#define PROF_HALF (PROF_SUB >> 1)
+#define PROF_MAX_BITS 32
+#define PROF_BUCKETS (PROF_SUB + (PROF_MAX_BITS - PROF_SUB_BITS) * PROF_HALF)
+
+
+/// @brief Phases of a single frame of the main loop
+typedef enum ProfPhase {
+    PHASE_DISPLAY,
+    PHASE_POLL,
+    PHASE_SWAP,
+    PHASE_COUNT
+} prof_phase;
+
+
+/// @brief Phases of a single frame as measured on the GPU
+typedef enum GpuPhase {
+    GPU_CLEAR,
+    GPU_CULL,
+    GPU_DRAW,
+    GPU_HIZ,
+    GPU_PHASE_COUNT
+} gpu_phase;
+
+
+/// @brief A single recorded frame
+/// @param phase_ns CPU time spent in each phase
+/// @param frame_ns time since the end of the previous frame (since its own beginning for the first frame)
+typedef struct FrameSample {
+    uint64_t phase_ns[PHASE_COUNT];
+    uint64_t frame_ns;
+} frame_sample;
+
+
+/// @brief Log-linear histogram of microsecond values, fixed size so recording never allocates
+/// @param counts bucket counts
+/// @param total number of recorded values
+/// @param max largest recorded value
+/// @param sum sum of all recorded values
+typedef struct Histogram {
+    uint32_t counts[PROF_BUCKETS];
+    uint64_t total, max, sum;
+} histogram;
+
+
+/// @brief Frame profiler state
+/// @param ring most recent frame samples
+/// @param head number of frames recorded so far (next ring slot is `head % PROF_RING`)
+/// @param window histogram of frame times since the last report
+/// @param all histogram of frame times over the whole run
+/// @param cur the frame being recorded
+/// @param t_begin timestamp of the current frame's beginning
+/// @param t_mark timestamp of the last phase mark
+/// @param t_end timestamp of the previous frame's end (0 before the first frame)
+/// @param t_report timestamp of the last report
+/// @param t_start timestamp of `prof_init`
+/// @param window_head value of `head` at the last report
+/// @param interval_ns reporting interval (0 disables periodic reports)
+/// @param gpu_window histogram of GPU frame times since the last report
+/// @param gpu_all histogram of GPU frame times over the whole run
+/// @param gpu_phase_ns GPU time spent in each phase since the last report
+/// @param phase_all_ns CPU time spent in each phase over the whole run
+/// @param gpu_phase_all_ns GPU time spent in each phase over the whole run
+typedef struct Profiler {
+    frame_sample ring[PROF_RING];
+    uint64_t head;
+    histogram window, all;
+    histogram gpu_window, gpu_all;
+    uint64_t gpu_phase_ns[GPU_PHASE_COUNT];
+    uint64_t phase_all_ns[PHASE_COUNT];
+    uint64_t gpu_phase_all_ns[GPU_PHASE_COUNT];
+    frame_sample cur;
+    uint64_t t_begin, t_mark, t_end, t_report, t_start;
+    uint64_t window_head;
+    uint64_t interval_ns;
+} profiler;
+
+
+/// @brief Summary statistics of a histogram, in milliseconds
+typedef struct ProfStats {
+    uint64_t frames;
+    double p50, p95, p99, max, mean, fps;
+} prof_stats;
+
+
+/// @brief Monotonic clock used by the profiler
+/// @return current time in nanoseconds
+uint64_t prof_now();
+
+/// @brief Record a value into the histogram
+/// @param h histogram pointer
+/// @param us value in microseconds
+void hist_record(histogram *h, const uint64_t us);
+
+/// @brief Value at the given percentile
+/// @param h histogram pointer
+/// @param pct percentile in the range [0, 100]
+/// @return value in microseconds (the upper bound of the matching bucket)
+uint64_t hist_percentile(const histogram *h, const double pct);
+
+/// @brief Initialize the profiler
+/// @param p profiler pointer
+/// @param interval reporting interval in seconds (0 disables periodic reports)
+void prof_init(profiler *p, const double interval);
+
+/// @brief Mark the beginning of a frame
+/// @param p profiler pointer
+void prof_begin(profiler *p);
+
+/// @brief Mark the end of a phase (the phase started at the previous mark or at `prof_begin`)
+/// @param p profiler pointer
+/// @param ph the phase that just finished
+void prof_mark(profiler *p, const prof_phase ph);
+
+/// @brief Mark the end of a frame and commit its sample
+/// @param p profiler pointer
+void prof_end(profiler *p);
+
+/// @brief Record the GPU time of a (past) frame, as resolved by the GPU timer
+/// @param p profiler pointer
+/// @param phase_ns GPU time spent in each phase
+void prof_gpu(profiler *p, const uint64_t phase_ns[GPU_PHASE_COUNT]);
+
+/// @brief Summarize a histogram
+/// @param h histogram pointer
+/// @param seconds wall time covered by the histogram (used for the FPS figure)
+/// @return the summary
+prof_stats prof_summary(const histogram *h, const double seconds);
+
+/// @brief Write the statistics of the whole run as a JSON object
+/// @param p profiler pointer
+/// @param out output stream
+void prof_json(const profiler *p, FILE *out);
+
+/// @brief Print a report if the reporting interval has elapsed, then start a new window
+/// @param p profiler pointer
+/// @param out output stream
+/// @return whether a report was printed
+int prof_report(profiler *p, FILE *out);
+
+#endif
@@ -0,0 +1,117 @@
+/// Render queue: every object submits a 64-bit sort key (program, VAO, mode and indexing, then its mesh and,
+/// front to back, how far it is), and the queue orders the objects by key with a radix sort. Draws then go through
+/// a state cache, so a program or a VAO is only bound when it changes.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include "util.h"
+#include <stdint.h>
+
+
+// bits sorted per pass of the radix sort
+#define QUEUE_RADIX_BITS 8
+
+// fields of a key, from the most significant bits down (each keeps the low bits of its value)
+#define QUEUE_PROGRAM_BITS 16
+#define QUEUE_VAO_BITS 8
+#define QUEUE_MODE_BITS 4
+#define QUEUE_INDEX_BITS 3
+#define QUEUE_DEPTH_BITS 12
+#define QUEUE_MESH_BITS 21
+
+
+/// @brief How the objects of a program are ordered
+typedef enum QueueOrder {
+    ORDER_STATE, // by mode, indexing and mesh, so objects sharing a mesh form runs (sorted when the world changes)
+    ORDER_FRONT, // by mode and indexing, then nearest first (sorted every frame)
+    ORDER_COUNT
+} queue_order;
+
+
+/// @brief Names of the orders, as used on the command line
+extern const char *ORDER_NAMES[ORDER_COUNT];
+
+
+/// @brief Objects being sorted by key
+/// @param keys sort key of every object
+/// @param items object of every key
+/// @param keys_scratch room for as many keys, for the passes of the sort
+/// @param items_scratch room for as many objects
+/// @param last objects in the order of the last sort that changed it (see `queue_changed`)
+/// @param last_len number of objects in `last`
+/// @param cap number of objects there is room for
+typedef struct RenderQueue {
+    uint64_t *keys;
+    uint *items;
+    uint64_t *keys_scratch;
+    uint *items_scratch;
+    uint *last;
+    uint last_len;
+    uint cap;
+} render_queue;
+
+
+/// @brief State the draws last bound, so binding it again is skipped
+/// @param program program in use (`~0u` when unknown)
+/// @param vao vertex array object bound (`~0u` when unknown)
+/// @param binds binds asked for since the last reset (one program and one VAO per draw call)
+/// @param changes binds that changed the state since the last reset
+typedef struct RenderState {
+    uint program, vao;
+    uint binds, changes;
+} render_state;
+
+
+/// @brief Make sure a queue has room for `n` objects
+/// @param q queue pointer
+/// @param n number of objects
+void queue_reserve(render_queue *q, const uint n);
+
+/// @brief Sort key of an object
+/// @param order how the objects of a program are ordered
+/// @param program program of the object
+/// @param vao vertex array object of its mesh
+/// @param mode rendering mode of the object
+/// @param has_ebo whether it is drawn with indices
+/// @param index_type type of its indices
+/// @param mesh mesh of the object
+/// @param depth distance to the object along the view axis, from the near plane (0) to the far plane (1)
+/// @return the key
+uint64_t queue_key(const queue_order order, const uint program, const uint vao, const GLenum mode,
+                   const GLboolean has_ebo, const GLenum index_type, const uint mesh, const float depth);
+
+/// @brief Sort the first `len` keys (and their objects), with equal keys kept in order, skipping the passes
+/// over bits every key shares
+/// @param q queue pointer
+/// @param len number of keys
+void queue_sort(render_queue *q, const uint len);
+
+/// @brief Whether the first `len` objects were sorted into another order than the last time this returned true
+/// (keys built from depths move every frame, while the order they give mostly stays)
+/// @param q queue pointer
+/// @param len number of objects
+/// @return whether the order changed
+int queue_changed(render_queue *q, const uint len);
+
+/// @brief Release a queue
+/// @param q queue pointer
+void queue_free(render_queue *q);
+
+/// @brief Forget the state the draws bound (after anything else used a program or a VAO), and start counting
+/// @param s state pointer
+void state_reset(render_state *s);
+
+/// @brief Use a program, unless it is in use already
+/// @param s state pointer
+/// @param program program to use
+void state_program(render_state *s, const uint program);
+
+/// @brief Bind a vertex array object, unless it is bound already
+/// @param s state pointer
+/// @param vao vertex array object to bind
+void state_vao(render_state *s, const uint vao);
+
+#endif
@@ -0,0 +1,233 @@
+/// Draws the world with one draw call per object, one instanced draw call per mesh, or one multi-draw-indirect
+/// call per program, primitive mode and index type (whose commands a compute pass can cull against the view frustum,
+/// and against the depth the last frame left).
+/// Objects whose meshes are split into meshlets are culled meshlet by meshlet instead, and drawn with one
+/// multi-draw-indirect call per program and index type.
+/// Objects are ordered by the sort keys of a render queue, and the draws only bind the state that changed.
+/// Shaders read the projection from a per-frame uniform block, and the modelview and normal matrices
+/// from a per-object storage buffer indexed by `gl_BaseInstanceARB + gl_InstanceID`.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "bvh.h"
+#include "cull.h"
+#include "gputimer.h"
+#include "jobs.h"
+#include "queue.h"
+#include "stream.h"
+#include "world.h"
+
+
+// binding point of the per-frame uniform block
+#define UBO_FRAME 0
+
+// binding point of the per-object storage block
+#define SSBO_OBJECTS 0
+
+// objects whose modelviews are computed by one batched product (on the stack)
+#define RENDER_BATCH 256
+
+// objects each worker thread takes at a time (smaller draw lists stay on the calling thread)
+#define RENDER_JOB 8192
+
+// objects split into meshlets each worker thread culls at a time
+#define RENDER_CLUSTER_JOB 16
+
+
+/// @brief Per-frame shader data (`std140` layout of the `Frame` block)
+/// @param projection projection matrix
+/// @param view view matrix (including the scene's rotation)
+typedef struct FrameData {
+    mat4x4 projection, view;
+} frame_data;
+
+
+/// @brief Per-object shader data (`std430` layout of `Object`, where a `mat3` has `vec4` columns)
+/// @param modelview modelview matrix
+/// @param normal normal matrix (the inverse transpose of the modelview's upper 3x3, up to scale)
+/// @param dequant center and scale of the positions of the object's mesh (see `vformat_dequant`)
+typedef struct ObjectData {
+    mat4x4 modelview;
+    vec4 normal[3];
+    vec4 dequant;
+} object_data;
+
+
+/// @brief Indirect draw command (`DrawElementsIndirectCommand`; the first four fields also form a `DrawArraysIndirectCommand`)
+/// @param count number of indices (or vertices)
+/// @param instance_count number of instances
+/// @param first first index (or first vertex)
+/// @param base_vertex added to every index (`baseInstance` of an arrays command)
+/// @param base_instance first entry of the per-object storage buffer
+typedef struct DrawCommand {
+    uint count, instance_count, first;
+    GLint base_vertex;
+    uint base_instance;
+} draw_command;
+
+
+/// @brief Run of draw commands submitted with a single multi-draw call
+/// @param program program of every command
+/// @param mode rendering mode of every command
+/// @param has_ebo whether the commands are indexed
+/// @param index_type type of the indices of every command
+/// @param first first command
+/// @param count number of commands
+/// @param first_object first object of the batch, in draw order
+/// @param objects number of objects in the batch
+typedef struct DrawBatch {
+    uint program;
+    GLenum mode;
+    GLboolean has_ebo;
+    GLenum index_type;
+    uint first, count;
+    uint first_object, objects;
+} draw_batch;
+
+
+/// @brief How the world is submitted
+typedef enum DrawMode {
+    DRAW_LOOP,
+    DRAW_INSTANCED,
+    DRAW_MDI,
+    DRAW_MODE_COUNT
+} draw_mode;
+
+
+/// @brief Names of the draw modes, as used on the command line
+extern const char *DRAW_MODE_NAMES[DRAW_MODE_COUNT];
+
+
+/// @brief Renderer state
+/// @param mode how the world is submitted
+/// @param frame uniform buffer stream holding the `frame_data`
+/// @param objects storage buffer stream holding one `object_data` per drawn instance, in the order the objects are drawn
+/// @param order how the objects of a program are ordered
+/// @param queue object indices sorted by program, mode, index type and mesh, so each run (of objects also sharing a
+/// version of the mesh) becomes one instanced draw, or nearest first
+/// @param order_cap number of objects the order has room for
+/// @param order_version world version the order was built for
+/// @param order_changed whether the objects were sorted into another order in the current frame
+/// @param state program and VAO last bound by the draws, and how many binds they asked for and made
+/// @param commands one indirect command per run (CPU copy)
+/// @param commands_len number of commands
+/// @param commands_cap number of commands there is room for
+/// @param commands_buffer indirect buffer holding the commands
+/// @param commands_version world version the commands were built for
+/// @param batches runs of commands sharing a program, a mode and an index type
+/// @param batches_len number of batches
+/// @param batches_cap number of batches there is room for
+/// @param cull how the objects outside of the view are skipped
+/// @param culling GPU culling pass (with `CULL_GPU`)
+/// @param occlusion depth pyramid the culling pass tests objects against (with `CULL_GPU`)
+/// @param tree hierarchy over the objects, for CPU culling and picking (built on first use)
+/// @param visible whether each object passed the CPU culling
+/// @param culled draw list of the objects that passed the CPU culling
+/// @param list objects drawn in the current frame, in order
+/// @param list_len number of objects drawn in the current frame
+/// @param view view matrix of the current frame
+/// @param levels version of its mesh every object is drawn with (see `lod.h`), by dense index
+/// @param levels_version world version the levels are for (they start over from the full meshes otherwise)
+/// @param levels_changed whether any object switched versions in the current frame
+/// @param split draw list with every run split by version (when some mesh has versions)
+/// @param switches number of times an object switched versions
+/// @param level_objects objects drawn with each version in the last frame
+/// @param level_triangles triangles drawn in the last frame, before GPU culling (when some mesh has versions)
+/// @param partition draw list with the objects drawn meshlet by meshlet moved after the others (see `meshlet.h`)
+/// @param clustered number of objects after the draw list, drawn meshlet by meshlet (their shader data follows
+/// the list's)
+/// @param cluster_first first command of every clustered object (then one past the last object's)
+/// @param cluster_visible number of meshlets of every clustered object that may be seen
+/// @param cluster_ids meshlets of every clustered object that may be seen, from its first command on
+/// @param cluster_commands one indirect command per meshlet that may be seen, packed
+/// @param cluster_commands_len number of commands
+/// @param cluster_commands_cap number of commands (and meshlets) there is room for
+/// @param cluster_buffer indirect buffer holding the meshlets' commands
+/// @param cluster_batches runs of meshlets' commands sharing a program and an index type
+/// @param cluster_batches_len number of batches
+/// @param cluster_tested meshlets of the clustered objects in the last frame
+/// @param cluster_triangles triangles of the meshlets drawn in the last frame
+/// @param jobs worker threads building the per-object shader data
+/// @param draws draw calls issued in the last frame
+typedef struct Renderer {
+    draw_mode mode;
+    stream_buffer frame, objects;
+    queue_order order;
+    render_queue queue;
+    uint order_cap;
+    uint order_version;
+    int order_changed;
+    render_state state;
+
+    draw_command *commands;
+    uint commands_len, commands_cap, commands_buffer, commands_version;
+    draw_batch *batches;
+    uint batches_len, batches_cap;
+
+    cull_mode cull;
+    culler culling;
+    hiz occlusion;
+    bvh tree;
+    uint8_t *visible;
+    uint *culled;
+
+    const uint *list;
+    uint list_len;
+    mat4x4 view;
+
+    uint8_t *levels;
+    uint levels_version;
+    int levels_changed;
+    uint *split;
+    uint64_t switches;
+    uint level_objects[LOD_MAX + 1];
+    uint64_t level_triangles;
+
+    uint *partition;
+    uint clustered;
+    uint *cluster_first, *cluster_visible, *cluster_ids;
+    draw_command *cluster_commands;
+    uint cluster_commands_len, cluster_commands_cap, cluster_buffer;
+    draw_batch *cluster_batches;
+    uint cluster_batches_len;
+    uint cluster_tested;
+    uint64_t cluster_triangles;
+
+    job_pool *jobs;
+    uint draws;
+} renderer;
+
+
+/// @brief Initialize the renderer (and its buffers, so it needs a current context)
+/// @param r renderer pointer
+/// @param mode how the world is submitted
+/// @param order how the objects of a program are ordered
+/// @param cull how the objects outside of the view are skipped (`CULL_GPU` needs `DRAW_MDI`)
+/// @param occlusion whether the culling pass also skips objects hidden in the last frame (only with `CULL_GPU`)
+/// @param jobs worker threads (which the renderer doesn't own)
+void render_init(renderer *r, const draw_mode mode, const queue_order order, const cull_mode cull,
+                 const hiz_mode occlusion, job_pool *jobs);
+
+/// @brief Handle drawing everything to the window
+/// @param r renderer pointer
+/// @param w world to draw (its moved objects are refit into the CPU culling's hierarchy)
+/// @param gt GPU timer marking the clear, cull, draw and depth pyramid phases
+/// @param t animation time, in seconds
+void display(renderer *r, world *w, gpu_timer *gt, const double t);
+
+/// @brief Find the nearest object whose bounding box is under a point of the last frame
+/// @param r renderer pointer
+/// @param w world (as last drawn, its moved objects are refit into the hierarchy first)
+/// @param x horizontal position, in normalized device coordinates
+/// @param y vertical position, in normalized device coordinates
+/// @return handle of the object, or `HANDLE_NULL`
+handle render_pick(renderer *r, world *w, const float x, const float y);
+
+/// @brief Release the renderer's memory and buffers
+/// @param r renderer pointer
+void render_free(renderer *r);
+
+#endif
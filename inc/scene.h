@@ -0,0 +1,66 @@
+/// Scene generator, populating the world with many objects for scaling tests.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "world.h"
+
+
+// largest supported number of generated objects
+#define SCENE_MAX_OBJECTS 1000000
+
+
+/// @brief How objects are placed
+typedef enum SceneLayout {
+    LAYOUT_GRID,
+    LAYOUT_RANDOM,
+    LAYOUT_CLUSTERED
+} scene_layout;
+
+
+/// @brief Which meshes are generated
+typedef enum SceneMesh {
+    MESH_CUBE,
+    MESH_SPHERE,
+    MESH_MIXED
+} scene_mesh;
+
+
+/// @brief Description of a generated scene
+/// @param objects number of objects
+/// @param layout placement of the objects
+/// @param mesh kind of meshes
+/// @param detail number of segments of the largest spheres
+/// @param seed seed of the random placement
+typedef struct SceneDesc {
+    uint objects;
+    scene_layout layout;
+    scene_mesh mesh;
+    uint detail, seed;
+} scene_desc;
+
+
+/// @brief What was generated
+/// @param triangles total number of triangles
+/// @param radius radius of a sphere around the origin containing every object
+typedef struct SceneInfo {
+    uint64_t triangles;
+    float radius;
+} scene_info;
+
+
+/// @brief Names of the layouts and meshes, as used on the command line
+extern const char *LAYOUT_NAMES[3];
+extern const char *MESH_NAMES[3];
+
+
+/// @brief Populate the world
+/// @param wd world pointer
+/// @param program program used by every object
+/// @param sd scene description
+/// @return information on the generated scene
+scene_info generate_scene(world *wd, const uint program, const scene_desc *sd);
+
+#endif
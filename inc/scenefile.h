@@ -0,0 +1,150 @@
+/// Binary scene files: meshes with their normals, bounds and simplified versions, and the objects placing them, laid
+/// out so the file is mapped into memory and its blocks handed to GL as they are, without any parsing.
+/// A file is a header, then page-aligned blocks (vertices, indices, meshes and objects), all little-endian.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include "scene.h"
+#include <stdint.h>
+
+
+// first bytes of every scene file
+#define SCENEFILE_MAGIC "FPSDSCN"
+
+// format version (files of other versions are rejected)
+#define SCENEFILE_VERSION 2
+
+// alignment of the blocks, so each starts on a page of its own
+#define SCENEFILE_ALIGN 4096
+
+
+/// @brief Blocks of a scene file
+typedef enum SceneFileBlock {
+    SCENEFILE_VERTICES, // `vertex` array shared by every mesh
+    SCENEFILE_INDICES, // `uint32_t` array shared by every mesh and version (relative to the mesh's first vertex)
+    SCENEFILE_MESHES, // `scenefile_mesh` array
+    SCENEFILE_OBJECTS, // `scenefile_object` array
+    SCENEFILE_BLOCKS
+} scenefile_block;
+
+
+/// @brief Where a block is in the file
+/// @param offset offset from the start of the file, in bytes (a multiple of `SCENEFILE_ALIGN`)
+/// @param size size of the block, in bytes
+typedef struct SceneFileRange {
+    uint64_t offset, size;
+} scenefile_range;
+
+/// @brief Header at the start of a scene file
+/// @param magic `SCENEFILE_MAGIC`
+/// @param version `SCENEFILE_VERSION`
+/// @param vertex_size size of a vertex, in bytes
+/// @param mesh_size size of a mesh, in bytes
+/// @param object_size size of an object, in bytes
+/// @param blocks index of the blocks
+typedef struct SceneFileHeader {
+    char magic[8];
+    uint32_t version, vertex_size, mesh_size, object_size;
+    scenefile_range blocks[SCENEFILE_BLOCKS];
+} scenefile_header;
+
+/// @brief Simplified version of a mesh of a scene file (see `lod.h`)
+/// @param first_index first index of the version in the indices block
+/// @param indices_len number of indices
+/// @param error largest distance of the version to the mesh, in object space
+typedef struct SceneFileLod {
+    uint32_t first_index, indices_len;
+    float error;
+} scenefile_lod;
+
+/// @brief Mesh of a scene file
+/// @param first_vertex first vertex of the mesh in the vertices block
+/// @param vertices_len number of vertices
+/// @param first_index first index of the mesh in the indices block
+/// @param indices_len number of indices (0 draws the vertices in order)
+/// @param mode rendering mode
+/// @param lods number of simplified versions
+/// @param lod simplified versions, each with fewer triangles than the one before
+/// @param sphere bounding sphere (center and radius)
+/// @param box bounding box
+/// @param name name of the mesh
+typedef struct SceneFileMesh {
+    uint32_t first_vertex, vertices_len, first_index, indices_len;
+    uint32_t mode;
+    uint32_t lods;
+    scenefile_lod lod[LOD_MAX];
+    vec4 sphere;
+    aabb box;
+    char name[MESH_NAME_LEN];
+} scenefile_mesh;
+
+/// @brief Object of a scene file
+/// @param model model matrix placing the mesh in the world
+/// @param mesh index of the mesh
+typedef struct SceneFileObject {
+    mat4x4 model;
+    uint32_t mesh;
+} scenefile_object;
+
+
+/// @brief Scene file mapped into memory
+/// @param map the whole file
+/// @param size size of the file, in bytes
+/// @param vertices vertices block
+/// @param indices indices block
+/// @param meshes meshes block
+/// @param objects objects block
+/// @param vertices_len number of vertices
+/// @param indices_len number of indices
+/// @param meshes_len number of meshes
+/// @param objects_len number of objects (a file without any has an object per mesh, in place)
+typedef struct SceneFile {
+    void *map;
+    size_t size;
+    const vertex *vertices;
+    const uint32_t *indices;
+    const scenefile_mesh *meshes;
+    const scenefile_object *objects;
+    uint vertices_len, indices_len, meshes_len, objects_len;
+} scene_file;
+
+
+/// @brief Map a scene file into memory and check its header and meshes (not its indices, as that would read every
+/// page of them before GL does: the passes that read vertices through them, such as splitting meshes into meshlets,
+/// check them first, and skip meshes indexing past their vertices)
+/// @param sf file pointer
+/// @param path path to the file
+/// @return 1 on success, 0 (after printing what is wrong with the file) otherwise
+int scenefile_open(scene_file *sf, const char *path);
+
+/// @brief Upload the meshes (and as many of their simplified versions as the registry keeps) straight from the mapped
+/// blocks, and add the objects to the world
+/// @param sf file pointer
+/// @param wd world pointer
+/// @param program program used by every object
+/// @return information on the loaded scene
+scene_info scenefile_load(const scene_file *sf, world *wd, const uint program);
+
+/// @brief Unmap a scene file (its meshes stay uploaded)
+/// @param sf file pointer
+void scenefile_close(scene_file *sf);
+
+/// @brief Write a scene file
+/// @param path path to the file
+/// @param vertices vertices of every mesh
+/// @param vertices_len number of vertices
+/// @param indices indices of every mesh
+/// @param indices_len number of indices
+/// @param meshes meshes
+/// @param meshes_len number of meshes
+/// @param objects objects
+/// @param objects_len number of objects
+/// @return 1 on success, 0 (after printing the error) otherwise
+int scenefile_write(const char *path, const vertex *vertices, const uint vertices_len, const uint32_t *indices,
+                    const uint indices_len, const scenefile_mesh *meshes, const uint meshes_len,
+                    const scenefile_object *objects, const uint objects_len);
+
+#endif
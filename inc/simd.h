@@ -0,0 +1,80 @@
+/// SIMD versions of the hot linmath functions, picked at runtime from the features of the CPU.
+/// The scalar linmath functions stay the reference, and the fallback on every other CPU.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "jobs.h"
+#include <stdio.h>
+
+
+// largest error allowed against the scalar versions, relative to the largest element of the result
+#define SIMD_TOLERANCE 1e-5
+#define SIMD_TOLERANCE_INVERT 1e-4
+
+// inputs each kernel is timed and checked on by `simd_bench`
+#define SIMD_BENCH_INPUTS (1u << 14)
+#define SIMD_BENCH_ROUNDS 16
+
+// matrices each thread takes at a time from a batched product split between threads
+#define SIMD_BATCH_GRAIN 4096
+
+
+/// @brief Instruction sets the kernels are written for, from slowest to fastest
+typedef enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE41,
+    SIMD_AVX2,
+    SIMD_LEVEL_COUNT
+} simd_level;
+
+
+/// @brief Names of the levels
+extern const char *SIMD_LEVEL_NAMES[SIMD_LEVEL_COUNT];
+
+
+/// @brief Implementations of the hot linmath functions (taking the same arguments as the linmath ones)
+/// @param level instruction set the kernels use
+/// @param mat4x4_mul matrix product
+/// @param mat4x4_mul_vec4 matrix times vector
+/// @param mat4x4_invert general inverse
+/// @param quat_mul quaternion product
+/// @param mat4x4_mul_batch product of one matrix with many: `out[i] = a * b[index[i]]` (`b[i]` without an index)
+/// @param mat4x4_rotate_Y_batch rotation of many matrices about Y: `out[i] = in[i] * rotate_Y(angles[i])`
+/// @param tri_normals face normals of many triangles: `out[i] = (b - a) x (c - a)` for the corners `3i` to `3i + 2`
+/// (looked up in `index` when there is one), scaled to unit length if `unit` (degenerate triangles stay zero)
+typedef struct SimdKernels {
+    simd_level level;
+    void (*mat4x4_mul)(mat4x4 M, mat4x4 const a, mat4x4 const b);
+    void (*mat4x4_mul_vec4)(vec4 r, mat4x4 const M, vec4 const v);
+    void (*mat4x4_invert)(mat4x4 T, mat4x4 const M);
+    void (*quat_mul)(quat r, quat const p, quat const q);
+    void (*mat4x4_mul_batch)(mat4x4 *out, mat4x4 const a, mat4x4 const *b, const uint *index, const uint n);
+    void (*mat4x4_rotate_Y_batch)(mat4x4 *out, mat4x4 const *in, const float *angles, const uint n);
+    void (*tri_normals)(vec3 *out, const vec3 *positions, const uint *index, const uint n, const int unit);
+} simd_kernels;
+
+
+/// @brief Kernels in use (the scalar ones until `simd_init` is called)
+extern simd_kernels simd;
+
+
+/// @brief Pick the fastest kernels the CPU supports
+/// @return level of the picked kernels
+simd_level simd_init();
+
+/// @brief Kernels of a level
+/// @param level instruction set
+/// @return the kernels, or `NULL` if the CPU (or the build) doesn't support the level
+const simd_kernels *simd_kernels_of(const simd_level level);
+
+/// @brief Time every supported level's kernels against the scalar ones on random input, and check
+/// their results are within `SIMD_TOLERANCE`; then time the batched product on every thread of a pool
+/// @param jobs worker threads
+/// @param out stream the results are written to, as one JSON object
+/// @return the number of kernels outside of the tolerance
+uint simd_bench(job_pool *jobs, FILE *out);
+
+#endif
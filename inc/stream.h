@@ -0,0 +1,65 @@
+/// Persistently mapped streaming buffers, split into per-frame regions guarded by fences.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "util.h"
+#include <stdint.h>
+
+
+// number of frame-sized regions (the CPU fills one while the GPU may still be reading the other two)
+#define STREAM_REGIONS 3
+
+
+/// @brief Buffer the CPU writes each frame's data straight into, without orphaning or stalling on `glBufferData`
+/// @param buffer buffer object (immutable storage, mapped for its whole lifetime)
+/// @param target binding target (`GL_UNIFORM_BUFFER` or `GL_SHADER_STORAGE_BUFFER`)
+/// @param align required alignment of bound ranges
+/// @param ptr mapping of the whole buffer
+/// @param region size of a region, in bytes
+/// @param fences fence of the last frame that used each region (`NULL` if none)
+/// @param frame index of the current frame
+/// @param waits number of frames whose region was still being read by the GPU
+/// @param wait_ns total time spent waiting for the GPU, in nanoseconds
+/// @param resizes number of times the buffer had to grow
+typedef struct StreamBuffer {
+    uint buffer;
+    GLenum target;
+    GLint align;
+    uint8_t *ptr;
+    size_t region;
+    GLsync fences[STREAM_REGIONS];
+    uint64_t frame;
+    uint64_t waits, wait_ns, resizes;
+} stream_buffer;
+
+
+/// @brief Create and map the buffer
+/// @param s stream pointer
+/// @param target binding target
+/// @param size initial size of a region, in bytes
+void stream_init(stream_buffer *s, const GLenum target, const size_t size);
+
+/// @brief Start writing the current frame's data (waits if the GPU still reads the region)
+/// @param s stream pointer
+/// @param size number of bytes that will be written (the buffer grows if needed)
+/// @return pointer to the region of the current frame
+void *stream_map(stream_buffer *s, const size_t size);
+
+/// @brief Bind the current frame's region to an indexed binding point
+/// @param s stream pointer
+/// @param index binding point
+/// @param size number of bytes written into the region
+void stream_bind(const stream_buffer *s, const uint index, const size_t size);
+
+/// @brief Fence the current frame's region once every command reading it was issued, and move on to the next one
+/// @param s stream pointer
+void stream_fence(stream_buffer *s);
+
+/// @brief Unmap and delete the buffer
+/// @param s stream pointer
+void stream_free(stream_buffer *s);
+
+#endif
@@ -23,23 +23,6 @@
 typedef unsigned int uint;
 
 
-/// @brief Simple object-struct, containing the information for drawing the geometry
-typedef struct Object {
-    uint vao, program, vertices_len, indices_len;
-    GLenum mode;
-    GLboolean has_ebo;
-} obj;
-
-
-/// @brief Encapsulation of all objects.
-/// @param objects array of objects
-/// @param objects_len number of objects
-typedef struct World {
-    obj *objects;
-    uint objects_len;
-} world;
-
-
 /// @brief Basic camera struct
 /// @param eye eye attribute
 /// @param center center attribute
@@ -72,4 +55,8 @@ typedef struct Shader {
 int compile_shader(uint *s, const shader sh);
 
 
+// GL calls go through the tracing wrappers in profiling builds
+#include "gltrace.h"
+
+
 #endif // UTIL_H
\ No newline at end of file
@@ -0,0 +1,85 @@
+/// Vertex formats of the vertex arena: 32-bit floats, or positions in half floats or 16-bit normalized
+/// integers (relative to the bounds of their mesh) with normals packed in two components (octahedral).
+/// The attribute fetch turns every format back into floats, and the vertex shader undoes the packing.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef VFORMAT_H
+#define VFORMAT_H
+
+#include "util.h"
+#include <stdint.h>
+
+
+/// @brief Layout of the vertices (interleaved, position then normal)
+typedef enum VertexFormat {
+    VFORMAT_F32, // float position, float normal (24 bytes)
+    VFORMAT_F16_OCT16, // half-float position, octahedral normal in two snorm16 (12 bytes)
+    VFORMAT_S16_OCT16, // snorm16 position, octahedral normal in two snorm16 (12 bytes)
+    VFORMAT_S16_OCT8, // snorm16 position, octahedral normal in two snorm8 (8 bytes)
+    VFORMAT_COUNT
+} vertex_format;
+
+
+/// @brief Names of the formats, as used on the command line
+extern const char *VFORMAT_NAMES[VFORMAT_COUNT];
+
+
+/// @brief How a format lays its attributes out
+/// @param size size of a vertex, in bytes
+/// @param pos_type component type of the position
+/// @param pos_normalized whether the position's integers map to [-1, 1]
+/// @param norm_offset offset of the normal, in bytes
+/// @param norm_type component type of the normal
+/// @param norm_size components of the normal (3 for a vector, 2 packed octahedrally)
+typedef struct VertexLayout {
+    uint size;
+    GLenum pos_type;
+    GLboolean pos_normalized;
+    uint norm_offset;
+    GLenum norm_type;
+    uint norm_size;
+} vertex_layout;
+
+
+/// @brief Layout of every format
+extern const vertex_layout VFORMAT_LAYOUTS[VFORMAT_COUNT];
+
+
+/// @brief Nearest half float to a float (rounding to even, with overflows going to infinity)
+/// @param f the float
+/// @return bits of the half float
+uint16_t vformat_half(const float f);
+
+/// @brief Pack a unit vector octahedrally: projected onto the octahedron `|x| + |y| + |z| = 1`, whose lower half
+/// is folded over the upper one (a zero vector packs to `(0, 0)`, which unpacks to `+z`)
+/// @param out the two components, in [-1, 1]
+/// @param n the vector
+void vformat_oct(float out[2], vec3 const n);
+
+/// @brief Where the positions of a mesh are quantized relative to: its center, and its largest half-extent
+/// (formats with float positions keep them as they are, with a zero center and a unit scale)
+/// @param format vertex format
+/// @param dequant center (first three components) and scale (fourth) turning a stored position back into one
+/// in object space
+/// @param lo smallest corner of the mesh's bounding box
+/// @param hi largest corner of the mesh's bounding box
+void vformat_dequant(const vertex_format format, vec4 dequant, vec3 const lo, vec3 const hi);
+
+/// @brief Write vertices in a format
+/// @param format vertex format
+/// @param out `count` vertices of the format's size
+/// @param count number of vertices
+/// @param positions position of the first vertex (then every `stride` bytes)
+/// @param normals normal of the first vertex (then every `stride` bytes)
+/// @param stride distance between the vertices of the inputs, in bytes
+/// @param dequant as given by `vformat_dequant`
+void vformat_encode(const vertex_format format, void *out, const uint count, const float *positions,
+                    const float *normals, const size_t stride, vec4 const dequant);
+
+/// @brief Set the position (location 0) and normal (location 1) attributes of the bound VAO to a format,
+/// both read from binding 0
+/// @param format vertex format
+void vformat_attribs(const vertex_format format);
+
+#endif
@@ -0,0 +1,153 @@
+/// Growable object storage, keeping the fields read by the draw loop in parallel (structure-of-arrays) form.
+/// @file
+/// @author Evan Schwartzentruber
+
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "mesh.h"
+#include <stdint.h>
+
+
+// a handle packs the index of its slot with the slot's generation
+#define HANDLE_INDEX_BITS 24
+#define HANDLE_INDEX_MASK ((1u << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_INDEX(h) ((h) & HANDLE_INDEX_MASK)
+#define HANDLE_GEN(h) ((h) >> HANDLE_INDEX_BITS)
+#define HANDLE_MAX_GEN 0xFF
+
+// never refers to an object (generations start at 1)
+#define HANDLE_NULL 0u
+
+// end of the free-slot list
+#define WORLD_NO_SLOT (~0u)
+
+
+/// @brief Stable reference to an object, which stays valid while other objects are added or removed
+typedef uint handle;
+
+
+/// @brief Simple object-struct, containing the information for drawing the geometry
+/// (the draw fields are copied from its mesh, so drawing needs no extra lookup)
+typedef struct Object {
+    uint base_vertex, first_index, program, vertices_len, indices_len;
+    GLenum mode;
+    GLboolean has_ebo;
+    GLenum index_type;
+    uint mesh;
+    mat4x4 model;
+} obj;
+
+
+/// @brief Encapsulation of all objects.
+/// Objects are stored densely in parallel arrays (entry `i` of each array belongs to the same object),
+/// so the draw loop only streams through the fields it needs. Removing an object moves the last one
+/// into its place, and handles are resolved through a slot table that follows these moves.
+/// @param base_vertex first vertex of each object's mesh in the vertex arena
+/// @param first_index first index of each object's mesh in the index arena
+/// @param program program of each object
+/// @param vertices_len size of the vertices array of each object
+/// @param indices_len size of the indices array of each object
+/// @param mode rendering mode of each object
+/// @param has_ebo whether each object is drawn with its indices
+/// @param index_type type of the indices of each object
+/// @param mesh mesh of each object
+/// @param model model matrix of each object
+/// @param bounds world-space bounding box of each object (its mesh's box, transformed by its model matrix)
+/// @param owner slot of each object
+/// @param dirty whether each object is in `moved`
+/// @param moved objects moved since the list was last cleared (each listed once, by dense index)
+/// @param moved_len number of moved objects
+/// @param len number of objects
+/// @param cap number of objects the arrays have room for
+/// @param slots dense index of each used slot, the next free slot of each unused one, or `WORLD_NO_SLOT` for retired ones
+/// @param gens current generation of each slot
+/// @param slots_len number of slots
+/// @param slots_cap number of slots there is room for
+/// @param free_slot first unused slot (`WORLD_NO_SLOT` when there is none)
+/// @param version incremented whenever objects are added or removed (which also clears `moved`)
+/// @param meshes meshes the objects are made of
+typedef struct World {
+    uint *base_vertex, *first_index, *program, *vertices_len, *indices_len;
+    GLenum *mode;
+    GLboolean *has_ebo;
+    GLenum *index_type;
+    uint *mesh;
+    mat4x4 *model;
+    aabb *bounds;
+    uint *owner;
+    uint8_t *dirty;
+    uint *moved;
+    uint len, cap, moved_len;
+
+    uint *slots;
+    uint8_t *gens;
+    uint slots_len, slots_cap, free_slot;
+
+    uint version;
+    mesh_registry meshes;
+} world;
+
+
+/// @brief Initialize an empty world
+/// @param wd world pointer
+/// @param cap number of objects to reserve room for
+void world_init(world *wd, const uint cap);
+
+/// @brief Make sure there's room for at least `cap` objects
+/// @param wd world pointer
+/// @param cap number of objects
+void world_reserve(world *wd, const uint cap);
+
+/// @brief Add an object, growing the storage if needed
+/// @param wd world pointer
+/// @param o the object
+/// @return handle of the new object
+handle world_add(world *wd, const obj o);
+
+/// @brief Whether the handle refers to a live object
+/// @param wd world pointer
+/// @param h handle
+/// @return boolean
+int world_valid(const world *wd, const handle h);
+
+/// @brief Dense index of an object (only valid until the next removal)
+/// @param wd world pointer
+/// @param h handle of a live object
+/// @return index into the parallel arrays
+uint world_index(const world *wd, const handle h);
+
+/// @brief Handle of the object at a dense index
+/// @param wd world pointer
+/// @param i index into the parallel arrays
+/// @return handle of the object
+handle world_handle(const world *wd, const uint i);
+
+/// @brief Move an object, updating its bounding box and adding it to the moved objects
+/// (structures built over the bounds, such as a `bvh`, have to be refit with them)
+/// @param wd world pointer
+/// @param h handle of a live object
+/// @param model new model matrix
+void world_set_model(world *wd, const handle h, mat4x4 const model);
+
+/// @brief Empty the list of moved objects (once the structures over their bounds are refit)
+/// @param wd world pointer
+void world_clear_moved(world *wd);
+
+/// @brief Copy an object out of the world
+/// @param wd world pointer
+/// @param h handle of a live object
+/// @return the object
+obj world_get(const world *wd, const handle h);
+
+/// @brief Remove an object in O(1), by moving the last object into its place (its GL objects are left alone).
+/// After `HANDLE_MAX_GEN` removals a slot is retired for good, so a stale handle never becomes valid again.
+/// @param wd world pointer
+/// @param h handle of a live object
+void world_remove(world *wd, const handle h);
+
+/// @brief Release the storage and every mesh
+/// @param wd world pointer
+void world_free(world *wd);
+
+#endif
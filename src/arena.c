@@ -0,0 +1,167 @@
+/// Sub-allocator handing out ranges of one large GL buffer, so many meshes share a single buffer.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "arena.h"
+#include <string.h>
+
+
+/// @brief Insert a free range at position `k` of the sorted list
+static void arena_insert(arena *a, const uint k, const arena_block b) {
+    if (a->blocks_len == a->blocks_cap) {
+        a->blocks_cap = a->blocks_cap ? a->blocks_cap * 2 : 16;
+        a->blocks = realloc(a->blocks, a->blocks_cap * sizeof(arena_block));
+        if (!a->blocks) {
+            error("Failed to grow an arena's free-list.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    memmove(&a->blocks[k + 1], &a->blocks[k], (a->blocks_len - k) * sizeof(arena_block));
+    a->blocks[k] = b;
+    a->blocks_len++;
+}
+
+/// @brief Remove the free range at position `k`
+static void arena_erase(arena *a, const uint k) {
+    memmove(&a->blocks[k], &a->blocks[k + 1], (a->blocks_len - k - 1) * sizeof(arena_block));
+    a->blocks_len--;
+}
+
+/// @brief Add a free range, merging it with the ranges it touches
+static void arena_add_block(arena *a, const uint offset, const uint n) {
+    // first range after the new one
+    uint k = 0;
+    while (k < a->blocks_len && a->blocks[k].offset < offset)
+        k++;
+
+    const int prev = k > 0 && a->blocks[k - 1].offset + a->blocks[k - 1].size == offset;
+    const int next = k < a->blocks_len && offset + n == a->blocks[k].offset;
+
+    if (prev && next) {
+        a->blocks[k - 1].size += n + a->blocks[k].size;
+        arena_erase(a, k);
+    } else if (prev)
+        a->blocks[k - 1].size += n;
+    else if (next) {
+        a->blocks[k].offset = offset;
+        a->blocks[k].size += n;
+    } else {
+        const arena_block b = {offset, n};
+        arena_insert(a, k, b);
+    }
+}
+
+/// @brief Create a buffer with room for `cap` elements
+/// (buffers are only ever bound to the copy targets, so the element buffer of a bound VAO is never replaced)
+static uint arena_buffer(const arena *a, const uint cap) {
+    uint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, (size_t)cap * a->stride, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return buffer;
+}
+
+/// @brief Move everything into a buffer with room for at least `n` more elements at the end
+static void arena_grow(arena *a, const uint n) {
+    uint cap = a->cap ? a->cap : 1;
+    while (cap - a->cap < n)
+        cap *= 2;
+
+    // the copy happens on the GPU, and the ranges keep their offsets
+    const uint buffer = arena_buffer(a, cap);
+    glBindBuffer(GL_COPY_READ_BUFFER, a->buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (size_t)a->cap * a->stride);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &a->buffer);
+
+    a->buffer = buffer;
+    arena_add_block(a, a->cap, cap - a->cap);
+    a->cap = cap;
+    a->grows++;
+}
+
+void arena_init(arena *a, const uint stride, const uint cap) {
+    memset(a, 0, sizeof(*a));
+    a->stride = stride;
+    a->cap = cap;
+    a->buffer = arena_buffer(a, cap);
+    arena_add_block(a, 0, cap);
+}
+
+uint arena_alloc(arena *a, const uint n, const void *data) {
+    // first fit
+    uint k = 0;
+    while (k < a->blocks_len && a->blocks[k].size < n)
+        k++;
+
+    // growing appends free space, which merges with a free range at the end
+    if (k == a->blocks_len) {
+        arena_grow(a, n);
+        k = a->blocks_len - 1;
+    }
+
+    const uint offset = a->blocks[k].offset;
+    if (a->blocks[k].size == n)
+        arena_erase(a, k);
+    else {
+        a->blocks[k].offset += n;
+        a->blocks[k].size -= n;
+    }
+
+    if (data && n) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, a->buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (size_t)offset * a->stride, (size_t)n * a->stride, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    a->used += n;
+    a->allocs++;
+    return offset;
+}
+
+void arena_reserve(arena *a, const uint n) {
+    // the free range at the end grows along with the buffer
+    const arena_block *last = a->blocks_len ? &a->blocks[a->blocks_len - 1] : NULL;
+    const uint tail = last && last->offset + last->size == a->cap ? last->size : 0;
+    if (tail < n)
+        arena_grow(a, n - tail);
+}
+
+void arena_release(arena *a, const uint offset, const uint n) {
+    if (!n)
+        return;
+
+    arena_add_block(a, offset, n);
+    a->used -= n;
+    a->allocs--;
+}
+
+uint arena_largest(const arena *a) {
+    uint largest = 0;
+    for (uint k = 0; k < a->blocks_len; k++)
+        if (a->blocks[k].size > largest)
+            largest = a->blocks[k].size;
+    return largest;
+}
+
+double arena_fragmentation(const arena *a) {
+    const uint free_space = a->cap - a->used;
+    return free_space ? 1.0 - (double)arena_largest(a) / free_space : 0.0;
+}
+
+void arena_json(const arena *a, FILE *out) {
+    fprintf(out, "{\"bytes\": %lu, \"used_bytes\": %lu, \"utilization\": %.4f, \"allocs\": %u, \"free_blocks\": %u, \"largest_free_bytes\": %lu, \"fragmentation\": %.4f, \"grows\": %u}",
+            (unsigned long)a->cap * a->stride, (unsigned long)a->used * a->stride,
+            a->cap ? (double)a->used / a->cap : 0.0, a->allocs, a->blocks_len,
+            (unsigned long)arena_largest(a) * a->stride, arena_fragmentation(a), a->grows);
+}
+
+void arena_free(arena *a) {
+    glDeleteBuffers(1, &a->buffer);
+    free(a->blocks);
+    memset(a, 0, sizeof(*a));
+}
@@ -0,0 +1,648 @@
+/// Bounding-volume hierarchy over the world's objects, for frustum culling and ray queries on the CPU.
+/// Nodes are 4 wide and store their children's boxes in structure-of-arrays form, so a node (or a leaf's objects)
+/// is tested with a single SIMD pass.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "bvh.h"
+#include "prof.h"
+#include <float.h>
+#include <string.h>
+
+#ifdef __SSE__
+    #include <xmmintrin.h>
+#endif
+
+
+// deepest traversal stack (each level pushes at most `BVH_WIDTH - 1` more entries than it pops)
+#define BVH_STACK 256
+
+
+/// @brief Resize an array, exiting on failure
+static void *grow(void *p, const size_t n, const size_t size) {
+    void *q = realloc(p, n * size);
+    if (!q && n) {
+        error("Failed to grow the bounding-volume hierarchy.");
+        exit(EXIT_FAILURE);
+    }
+    return q;
+}
+
+/// @brief Set the box of a child
+static void slot_set(bvh_node *nd, const uint c, const aabb *box) {
+    for (uint l = 0; l < 3; l++) {
+        nd->lo[l][c] = box->lo[l];
+        nd->hi[l][c] = box->hi[l];
+    }
+}
+
+/// @brief Whether the box of a child is `box`
+static int slot_equal(const bvh_node *nd, const uint c, const aabb *box) {
+    for (uint l = 0; l < 3; l++)
+        if (nd->lo[l][c] != box->lo[l] || nd->hi[l][c] != box->hi[l])
+            return 0;
+    return 1;
+}
+
+/// @brief Box that contains nothing (and that no test passes)
+static void aabb_empty(aabb *box) {
+    for (uint l = 0; l < 3; l++) {
+        box->lo[l] = FLT_MAX;
+        box->hi[l] = -FLT_MAX;
+    }
+}
+
+/// @brief Grow a box to contain another
+static void aabb_merge(aabb *box, const aabb *other) {
+    for (uint l = 0; l < 3; l++) {
+        box->lo[l] = fminf(box->lo[l], other->lo[l]);
+        box->hi[l] = fmaxf(box->hi[l], other->hi[l]);
+    }
+}
+
+/// @brief Add a node whose children are all empty
+static uint node_alloc(bvh *b) {
+    if (b->nodes_len == b->nodes_cap) {
+        b->nodes_cap = b->nodes_cap ? b->nodes_cap * 2 : 64;
+        b->nodes = grow(b->nodes, b->nodes_cap, sizeof(bvh_node));
+        b->parent = grow(b->parent, b->nodes_cap, sizeof(uint));
+    }
+
+    bvh_node *nd = &b->nodes[b->nodes_len];
+    aabb empty;
+    aabb_empty(&empty);
+    for (uint c = 0; c < BVH_WIDTH; c++) {
+        slot_set(nd, c, &empty);
+        nd->child[c] = 0;
+        nd->count[c] = 0;
+    }
+
+    b->parent[b->nodes_len] = BVH_NONE;
+    return b->nodes_len++;
+}
+
+/// @brief Box around the objects of the items `[s, e)`
+static void range_bounds(const bvh *b, const world *w, const uint s, const uint e, aabb *box) {
+    aabb_empty(box);
+    for (uint k = s; k < e; k++)
+        aabb_merge(box, &w->bounds[b->items[k]]);
+}
+
+/// @brief Box around the children of a node
+static void node_bounds(const bvh_node *nd, aabb *box) {
+    for (uint l = 0; l < 3; l++) {
+        box->lo[l] = fminf(fminf(nd->lo[l][0], nd->lo[l][1]), fminf(nd->lo[l][2], nd->lo[l][3]));
+        box->hi[l] = fmaxf(fmaxf(nd->hi[l][0], nd->hi[l][1]), fmaxf(nd->hi[l][2], nd->hi[l][3]));
+    }
+}
+
+/// @brief Partially sort the items `[s, e)` so item `m` has the median center along an axis (quickselect)
+static void select_median(uint *items, const vec3 *centers, const uint axis, const uint s, const uint e, const uint m) {
+    int lo = s, hi = e - 1;
+    while (lo < hi) {
+        const float pivot = centers[items[(lo + hi) / 2]][axis];
+
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (centers[items[i]][axis] < pivot)
+                i++;
+            while (centers[items[j]][axis] > pivot)
+                j--;
+            if (i <= j) {
+                const uint t = items[i];
+                items[i++] = items[j];
+                items[j--] = t;
+            }
+        }
+
+        // `[lo, j]` is at most the pivot, and `[i, hi]` at least
+        if ((int)m <= j)
+            hi = j;
+        else if ((int)m >= i)
+            lo = i;
+        else
+            break;
+    }
+}
+
+/// @brief Split the items `[s, e)` in half along the longest axis of their centers
+/// @return first item of the second half
+static uint split(bvh *b, const vec3 *centers, const uint s, const uint e) {
+    vec3 lo, hi;
+    vec3_dup(lo, centers[b->items[s]]);
+    vec3_dup(hi, centers[b->items[s]]);
+    for (uint k = s + 1; k < e; k++)
+        for (uint l = 0; l < 3; l++) {
+            lo[l] = fminf(lo[l], centers[b->items[k]][l]);
+            hi[l] = fmaxf(hi[l], centers[b->items[k]][l]);
+        }
+
+    uint axis = 0;
+    for (uint l = 1; l < 3; l++)
+        if (hi[l] - lo[l] > hi[axis] - lo[axis])
+            axis = l;
+
+    const uint m = s + (e - s) / 2;
+    select_median(b->items, centers, axis, s, e, m);
+    return m;
+}
+
+/// @brief Build a node over the items `[s, e)`
+/// @return index of the node
+static uint build_node(bvh *b, const world *w, const vec3 *centers, const uint s, const uint e) {
+    const uint node = node_alloc(b);
+
+    // keep halving the largest range until there is one per child, or every range fits in a leaf
+    uint rs[BVH_WIDTH] = {s}, re[BVH_WIDTH] = {e}, n = 1;
+    while (n < BVH_WIDTH) {
+        uint big = 0;
+        for (uint c = 1; c < n; c++)
+            if (re[c] - rs[c] > re[big] - rs[big])
+                big = c;
+        if (re[big] - rs[big] <= BVH_LEAF)
+            break;
+
+        const uint m = split(b, centers, rs[big], re[big]);
+        rs[n] = m, re[n] = re[big];
+        re[big] = m;
+        n++;
+    }
+
+    // nodes may move while the children are built, so they're only referred to by index
+    for (uint c = 0; c < n; c++) {
+        aabb box;
+        if (re[c] - rs[c] <= BVH_LEAF) {
+            for (uint k = rs[c]; k < re[c]; k++)
+                b->leaf[b->items[k]] = node * BVH_WIDTH + c;
+            range_bounds(b, w, rs[c], re[c], &box);
+            b->nodes[node].child[c] = rs[c];
+            b->nodes[node].count[c] = re[c] - rs[c];
+        } else {
+            const uint child = build_node(b, w, centers, rs[c], re[c]);
+            b->parent[child] = node * BVH_WIDTH + c;
+            node_bounds(&b->nodes[child], &box);
+            b->nodes[node].child[c] = child;
+        }
+        slot_set(&b->nodes[node], c, &box);
+    }
+    return node;
+}
+
+void bvh_init(bvh *b) {
+    memset(b, 0, sizeof(*b));
+
+    // never matches a world's version, so the hierarchy is built before its first use
+    b->version = ~0u;
+}
+
+void bvh_build(bvh *b, const world *w) {
+    if (w->len > b->cap) {
+        b->items = grow(b->items, w->len, sizeof(uint));
+        b->leaf = grow(b->leaf, w->len, sizeof(uint));
+        b->cap = w->len;
+    }
+    b->len = w->len;
+    b->nodes_len = 0;
+
+    vec3 *centers = grow(NULL, w->len, sizeof(vec3));
+    for (uint i = 0; i < w->len; i++) {
+        vec3_add(centers[i], w->bounds[i].lo, w->bounds[i].hi);
+        vec3_scale(centers[i], centers[i], 0.5f);
+        b->items[i] = i;
+    }
+
+    // an empty world still gets a root, with no children
+    if (w->len)
+        build_node(b, w, centers, 0, w->len);
+    else
+        node_alloc(b);
+
+    free(centers);
+    b->version = w->version;
+}
+
+void bvh_refit(bvh *b, const world *w, const uint *objects, const uint n) {
+    for (uint k = 0; k < n; k++) {
+        uint node = b->leaf[objects[k]] / BVH_WIDTH;
+        const uint c = b->leaf[objects[k]] % BVH_WIDTH;
+
+        aabb box;
+        bvh_node *nd = &b->nodes[node];
+        range_bounds(b, w, nd->child[c], nd->child[c] + nd->count[c], &box);
+        if (slot_equal(nd, c, &box))
+            continue;
+        slot_set(nd, c, &box);
+
+        // walk up until a box doesn't change
+        while (b->parent[node] != BVH_NONE) {
+            const uint up = b->parent[node];
+            node_bounds(&b->nodes[node], &box);
+
+            bvh_node *p = &b->nodes[up / BVH_WIDTH];
+            if (slot_equal(p, up % BVH_WIDTH, &box))
+                break;
+            slot_set(p, up % BVH_WIDTH, &box);
+            node = up / BVH_WIDTH;
+        }
+    }
+}
+
+/// @brief Test four boxes against the frustum planes (pointing inwards)
+/// @param inside set to the boxes entirely inside the frustum
+/// @return bit `c` is set when box `c` intersects the frustum
+static uint frustum4(const float lo[3][BVH_WIDTH], const float hi[3][BVH_WIDTH], const vec4 planes[6], uint *inside) {
+#ifdef __SSE__
+    const __m128 zero = _mm_setzero_ps();
+    __m128 l[3], h[3];
+    for (uint a = 0; a < 3; a++) {
+        l[a] = _mm_loadu_ps(lo[a]);
+        h[a] = _mm_loadu_ps(hi[a]);
+    }
+
+    // a box is out when its corner farthest along a plane's normal is behind it, and
+    // crosses a plane when its nearest corner is
+    __m128 out = zero, cross = zero;
+    for (uint p = 0; p < 6; p++) {
+        __m128 far = _mm_set1_ps(planes[p][3]), near = far;
+        for (uint a = 0; a < 3; a++) {
+            const __m128 n = _mm_set1_ps(planes[p][a]);
+            const int pos = planes[p][a] >= 0.0f;
+            far = _mm_add_ps(far, _mm_mul_ps(n, pos ? h[a] : l[a]));
+            near = _mm_add_ps(near, _mm_mul_ps(n, pos ? l[a] : h[a]));
+        }
+        out = _mm_or_ps(out, _mm_cmplt_ps(far, zero));
+        cross = _mm_or_ps(cross, _mm_cmplt_ps(near, zero));
+    }
+
+    const uint o = _mm_movemask_ps(out), x = _mm_movemask_ps(cross);
+#else
+    uint o = 0, x = 0;
+    for (uint c = 0; c < BVH_WIDTH; c++)
+        for (uint p = 0; p < 6; p++) {
+            float far = planes[p][3], near = far;
+            for (uint a = 0; a < 3; a++) {
+                const int pos = planes[p][a] >= 0.0f;
+                far += planes[p][a] * (pos ? hi[a][c] : lo[a][c]);
+                near += planes[p][a] * (pos ? lo[a][c] : hi[a][c]);
+            }
+            o |= (far < 0.0f) << c;
+            x |= (near < 0.0f) << c;
+        }
+#endif
+    *inside = ~(o | x) & 0xF;
+    return ~o & 0xF;
+}
+
+/// @brief Test four boxes against a ray, up to a distance
+/// @param near set to the distance at which the ray enters each box
+/// @return bit `c` is set when box `c` is hit
+static uint ray4(const float lo[3][BVH_WIDTH], const float hi[3][BVH_WIDTH], const vec3 origin, const vec3 inv, const float tmax, float near[BVH_WIDTH]) {
+#ifdef __SSE__
+    __m128 t0 = _mm_setzero_ps(), t1 = _mm_set1_ps(tmax);
+    for (uint a = 0; a < 3; a++) {
+        const __m128 o = _mm_set1_ps(origin[a]), d = _mm_set1_ps(inv[a]);
+        const __m128 ta = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(lo[a]), o), d);
+        const __m128 tb = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(hi[a]), o), d);
+        t0 = _mm_max_ps(t0, _mm_min_ps(ta, tb));
+        t1 = _mm_min_ps(t1, _mm_max_ps(ta, tb));
+    }
+    _mm_storeu_ps(near, t0);
+
+    // empty children have inverted boxes, which the slabs alone wouldn't reject
+    const __m128 valid = _mm_cmple_ps(_mm_loadu_ps(lo[0]), _mm_loadu_ps(hi[0]));
+    return _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(t0, t1), valid));
+#else
+    uint hit = 0;
+    for (uint c = 0; c < BVH_WIDTH; c++) {
+        float t0 = 0.0f, t1 = tmax;
+        for (uint a = 0; a < 3; a++) {
+            const float ta = (lo[a][c] - origin[a]) * inv[a], tb = (hi[a][c] - origin[a]) * inv[a];
+            t0 = fmaxf(t0, fminf(ta, tb));
+            t1 = fminf(t1, fmaxf(ta, tb));
+        }
+        near[c] = t0;
+        hit |= (t0 <= t1 && lo[0][c] <= hi[0][c]) << c;
+    }
+    return hit;
+#endif
+}
+
+/// @brief Gather the boxes of up to four objects into the layout of a node
+/// @param items objects of the boxes (`NULL` for the objects `first` onwards)
+static void gather_boxes(const world *w, const uint *items, const uint first, const uint count, float lo[3][BVH_WIDTH], float hi[3][BVH_WIDTH]) {
+    for (uint c = 0; c < BVH_WIDTH; c++) {
+        const aabb *box = c < count ? &w->bounds[items ? items[first + c] : first + c] : NULL;
+        for (uint l = 0; l < 3; l++) {
+            lo[l][c] = box ? box->lo[l] : FLT_MAX;
+            hi[l][c] = box ? box->hi[l] : -FLT_MAX;
+        }
+    }
+}
+
+/// @brief Frustum planes from the rows of a projection times view matrix (Gribb and Hartmann), in world space
+static void frustum_planes(vec4 planes[6], mat4x4 const clip) {
+    for (uint i = 0; i < 3; i++)
+        for (uint l = 0; l < 4; l++) {
+            planes[2 * i][l] = clip[l][3] + clip[l][i];
+            planes[2 * i + 1][l] = clip[l][3] - clip[l][i];
+        }
+}
+
+/// @brief Mark every object below a node as visible
+static uint mark_node(const bvh *b, const uint node, uint8_t *visible) {
+    const bvh_node *nd = &b->nodes[node];
+
+    uint n = 0;
+    for (uint c = 0; c < BVH_WIDTH; c++)
+        if (nd->count[c]) {
+            for (uint k = nd->child[c]; k < nd->child[c] + nd->count[c]; k++)
+                visible[b->items[k]] = 1;
+            n += nd->count[c];
+        } else if (nd->lo[0][c] <= nd->hi[0][c])
+            n += mark_node(b, nd->child[c], visible);
+    return n;
+}
+
+uint bvh_frustum(const bvh *b, const world *w, mat4x4 const clip, uint8_t *visible) {
+    memset(visible, 0, b->len);
+    if (!b->len)
+        return 0;
+
+    vec4 planes[6];
+    frustum_planes(planes, clip);
+
+    uint n = 0;
+    uint stack[BVH_STACK], top = 0;
+    stack[top++] = 0;
+    while (top) {
+        const bvh_node *nd = &b->nodes[stack[--top]];
+
+        uint inside;
+        const uint hit = frustum4(nd->lo, nd->hi, planes, &inside);
+        for (uint c = 0; c < BVH_WIDTH; c++) {
+            if (!(hit >> c & 1))
+                continue;
+
+            // children entirely inside need no more tests
+            if (inside >> c & 1) {
+                if (nd->count[c]) {
+                    for (uint k = nd->child[c]; k < nd->child[c] + nd->count[c]; k++)
+                        visible[b->items[k]] = 1;
+                    n += nd->count[c];
+                } else
+                    n += mark_node(b, nd->child[c], visible);
+            } else if (nd->count[c]) {
+                float lo[3][BVH_WIDTH], hi[3][BVH_WIDTH];
+                gather_boxes(w, b->items, nd->child[c], nd->count[c], lo, hi);
+
+                uint in;
+                const uint objects = frustum4(lo, hi, planes, &in);
+                for (uint k = 0; k < nd->count[c]; k++)
+                    if (objects >> k & 1) {
+                        visible[b->items[nd->child[c] + k]] = 1;
+                        n++;
+                    }
+            } else
+                stack[top++] = nd->child[c];
+        }
+    }
+    return n;
+}
+
+uint bvh_raycast(const bvh *b, const world *w, const vec3 origin, const vec3 dir, float *t) {
+    uint best = BVH_NONE;
+    float tmax = FLT_MAX;
+    if (!b->len)
+        return best;
+
+    vec3 inv;
+    for (uint l = 0; l < 3; l++)
+        inv[l] = 1.0f / dir[l];
+
+    // nodes wait on the stack with the distance at which the ray enters them
+    uint stack[BVH_STACK], top = 0;
+    float dist[BVH_STACK];
+    stack[top] = 0, dist[top++] = 0.0f;
+    while (top) {
+        top--;
+        if (dist[top] > tmax)
+            continue;
+        const bvh_node *nd = &b->nodes[stack[top]];
+
+        float near[BVH_WIDTH];
+        const uint hit = ray4(nd->lo, nd->hi, origin, inv, tmax, near);
+
+        // push the farthest children first, so the nearest is visited next
+        uint order[BVH_WIDTH], n = 0;
+        for (uint c = 0; c < BVH_WIDTH; c++)
+            if (hit >> c & 1) {
+                uint k = n++;
+                for (; k > 0 && near[order[k - 1]] < near[c]; k--)
+                    order[k] = order[k - 1];
+                order[k] = c;
+            }
+
+        for (uint k = 0; k < n; k++) {
+            const uint c = order[k];
+            if (nd->count[c]) {
+                float lo[3][BVH_WIDTH], hi[3][BVH_WIDTH], d[BVH_WIDTH];
+                gather_boxes(w, b->items, nd->child[c], nd->count[c], lo, hi);
+
+                const uint objects = ray4(lo, hi, origin, inv, tmax, d);
+                for (uint o = 0; o < nd->count[c]; o++)
+                    if (objects >> o & 1 && d[o] < tmax) {
+                        tmax = d[o];
+                        best = b->items[nd->child[c] + o];
+                    }
+            } else
+                stack[top] = nd->child[c], dist[top++] = near[c];
+        }
+    }
+
+    *t = tmax;
+    return best;
+}
+
+void bvh_free(bvh *b) {
+    free(b->nodes);
+    free(b->parent);
+    free(b->items);
+    free(b->leaf);
+    memset(b, 0, sizeof(*b));
+}
+
+/// @brief Test every object against a frustum, without the hierarchy
+static uint brute_frustum(const world *w, mat4x4 const clip, uint8_t *visible) {
+    vec4 planes[6];
+    frustum_planes(planes, clip);
+
+    uint n = 0;
+    for (uint i = 0; i < w->len; i += BVH_WIDTH) {
+        const uint count = w->len - i < BVH_WIDTH ? w->len - i : BVH_WIDTH;
+        float lo[3][BVH_WIDTH], hi[3][BVH_WIDTH];
+        gather_boxes(w, NULL, i, count, lo, hi);
+
+        uint in;
+        const uint hit = frustum4(lo, hi, planes, &in);
+        for (uint c = 0; c < count; c++) {
+            visible[i + c] = hit >> c & 1;
+            n += visible[i + c];
+        }
+    }
+    return n;
+}
+
+/// @brief Find the nearest box a ray hits, without the hierarchy
+static uint brute_raycast(const world *w, const vec3 origin, const vec3 dir, float *t) {
+    vec3 inv;
+    for (uint l = 0; l < 3; l++)
+        inv[l] = 1.0f / dir[l];
+
+    uint best = BVH_NONE;
+    float tmax = FLT_MAX;
+    for (uint i = 0; i < w->len; i += BVH_WIDTH) {
+        const uint count = w->len - i < BVH_WIDTH ? w->len - i : BVH_WIDTH;
+        float lo[3][BVH_WIDTH], hi[3][BVH_WIDTH], near[BVH_WIDTH];
+        gather_boxes(w, NULL, i, count, lo, hi);
+
+        const uint hit = ray4(lo, hi, origin, inv, tmax, near);
+        for (uint c = 0; c < count; c++)
+            if (hit >> c & 1 && near[c] < tmax) {
+                tmax = near[c];
+                best = i + c;
+            }
+    }
+
+    *t = tmax;
+    return best;
+}
+
+/// @brief Run every frustum query of the benchmark: from the middle of the scene, a full turn looking out (and up and
+/// down), with a narrow field of view, so every view sees part of the scene and cuts through nodes and leaves
+/// @return number of objects the hierarchy and the brute-force test disagree on
+static uint bench_frustum(const bvh *b, const world *w, mat4x4 const projection, const int brute, uint8_t *visible,
+                          uint8_t *expected, uint64_t *ns, uint64_t *visible_sum) {
+    if (!w->len)
+        return 0;
+
+    vec3 lo = {FLT_MAX, FLT_MAX, FLT_MAX}, hi = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (uint i = 0; i < w->len; i++)
+        for (uint l = 0; l < 3; l++) {
+            lo[l] = fminf(lo[l], w->bounds[i].lo[l]);
+            hi[l] = fmaxf(hi[l], w->bounds[i].hi[l]);
+        }
+
+    vec3 eye, size;
+    vec3_add(eye, lo, hi);
+    vec3_scale(eye, eye, 0.5f);
+    vec3_sub(size, hi, lo);
+
+    // as wide as the window, and far enough to reach the corners of the scene
+    mat4x4 narrow;
+    const float far = vec3_len(size) + 1.0f;
+    mat4x4_perspective(narrow, BVH_BENCH_FOV, projection[1][1] / projection[0][0], far * 1e-4f, far);
+
+    uint mismatches = 0;
+    for (uint q = 0; q < BVH_BENCH_VIEWS; q++) {
+        const float yaw = M_TAU * q / BVH_BENCH_VIEWS, pitch = 0.6f * sinf(3.0f * yaw);
+        const vec3 up = {0.0f, 1.0f, 0.0f};
+        vec3 at = {eye[0] + cosf(pitch) * sinf(yaw), eye[1] + sinf(pitch), eye[2] - cosf(pitch) * cosf(yaw)};
+
+        mat4x4 view, clip;
+        mat4x4_look_at(view, eye, at, up);
+        mat4x4_mul(clip, narrow, view);
+
+        const uint64_t t = prof_now();
+        const uint n = brute ? brute_frustum(w, clip, visible) : bvh_frustum(b, w, clip, visible);
+        *ns += prof_now() - t;
+        *visible_sum += n;
+
+        // the brute-force pass fills in the expected results the next pass is checked against
+        if (brute)
+            memcpy(expected + (size_t)q * w->len, visible, w->len);
+        else
+            for (uint i = 0; i < w->len; i++)
+                mismatches += visible[i] != expected[(size_t)q * w->len + i];
+    }
+    return mismatches;
+}
+
+void bvh_bench(world *w, mat4x4 const projection, mat4x4 const view, FILE *out) {
+    bvh b;
+    bvh_init(&b);
+
+    uint8_t *visible = grow(NULL, w->len ? w->len : 1, 1);
+    uint8_t *expected = grow(NULL, (size_t)BVH_BENCH_VIEWS * (w->len ? w->len : 1), 1);
+
+    // build (best of a few, as the first one also allocates)
+    uint64_t build_ns = UINT64_MAX;
+    for (uint k = 0; k < BVH_BENCH_BUILDS; k++) {
+        const uint64_t t = prof_now();
+        bvh_build(&b, w);
+        const uint64_t dt = prof_now() - t;
+        build_ns = dt < build_ns ? dt : build_ns;
+    }
+
+    // frustum queries, against testing every box
+    uint64_t brute_ns = 0, bvh_ns = 0, brute_visible = 0, bvh_visible = 0;
+    bench_frustum(&b, w, projection, 1, visible, expected, &brute_ns, &brute_visible);
+    uint mismatches = bench_frustum(&b, w, projection, 0, visible, expected, &bvh_ns, &bvh_visible);
+
+    // rays from the eye towards random objects (xorshift, so every run casts the same rays)
+    mat4x4 inv;
+    mat4x4_invert(inv, view);
+    uint64_t ray_ns = 0, brute_ray_ns = 0, state = 0x9E3779B97F4A7C15ull;
+    uint hits = 0;
+    for (uint q = 0; q < BVH_BENCH_RAYS && w->len; q++) {
+        state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+        const aabb *target = &w->bounds[state % w->len];
+
+        vec3 dir;
+        for (uint l = 0; l < 3; l++)
+            dir[l] = (target->lo[l] + target->hi[l]) * 0.5f - inv[3][l];
+
+        float t, tb;
+        uint64_t t0 = prof_now();
+        const uint i = bvh_raycast(&b, w, inv[3], dir, &t);
+        ray_ns += prof_now() - t0;
+
+        t0 = prof_now();
+        const uint j = brute_raycast(w, inv[3], dir, &tb);
+        brute_ray_ns += prof_now() - t0;
+
+        // equally near boxes may be told apart differently, so only the distances are compared
+        hits += i != BVH_NONE;
+        mismatches += (i == BVH_NONE) != (j == BVH_NONE) || (i != BVH_NONE && fabsf(t - tb) > 1e-5f * (1.0f + tb));
+    }
+
+    // move every object a little, then refit instead of rebuilding
+    for (uint i = 0; i < w->len; i++) {
+        state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+        mat4x4 model;
+        mat4x4_translate(model, (state & 0xFF) / 2550.0f, (state >> 8 & 0xFF) / 2550.0f, (state >> 16 & 0xFF) / 2550.0f);
+        mat4x4_mul(model, model, w->model[i]);
+        world_set_model(w, world_handle(w, i), model);
+    }
+
+    uint64_t t0 = prof_now();
+    bvh_refit(&b, w, w->moved, w->moved_len);
+    const uint64_t refit_ns = prof_now() - t0;
+    world_clear_moved(w);
+
+    // the refit hierarchy has to agree with the moved boxes
+    brute_ns = bvh_ns = brute_visible = bvh_visible = 0;
+    bench_frustum(&b, w, projection, 1, visible, expected, &brute_ns, &brute_visible);
+    mismatches += bench_frustum(&b, w, projection, 0, visible, expected, &bvh_ns, &bvh_visible);
+
+    fprintf(out, "{\"objects\": %u, \"nodes\": %u, \"build_ms\": %.3f, \"refit_ms\": %.3f, ",
+            w->len, b.nodes_len, build_ns / 1e6, refit_ns / 1e6);
+    fprintf(out, "\"frustum\": {\"queries\": %u, \"visible_mean\": %.1f, \"bvh_us\": %.2f, \"brute_us\": %.2f}, ",
+            BVH_BENCH_VIEWS, (double)bvh_visible / BVH_BENCH_VIEWS, bvh_ns / 1e3 / BVH_BENCH_VIEWS, brute_ns / 1e3 / BVH_BENCH_VIEWS);
+    fprintf(out, "\"ray\": {\"queries\": %u, \"hits\": %u, \"bvh_us\": %.3f, \"brute_us\": %.3f}, ",
+            BVH_BENCH_RAYS, hits, ray_ns / 1e3 / BVH_BENCH_RAYS, brute_ray_ns / 1e3 / BVH_BENCH_RAYS);
+    fprintf(out, "\"mismatches\": %u}\n", mismatches);
+
+    free(visible);
+    free(expected);
+    bvh_free(&b);
+}
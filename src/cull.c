@@ -0,0 +1,344 @@
+/// GPU frustum culling: a compute pass writes the indirect commands of the visible objects
+/// (and can skip those hidden behind the last frame's depth, see `hiz.h`).
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "cull.h"
+#include "render.h"
+#include <string.h>
+
+
+const char *CULL_MODE_NAMES[CULL_MODE_COUNT] = {"none", "gpu", "cpu"};
+
+
+// one invocation per object (the work group size is `CULL_GROUP`)
+static const shader SHADER_CULL = {
+    "#version 450\n"
+    "layout(local_size_x = 64) in;\n"
+    "\n"
+    "struct Object {\n"
+    "    mat4 modelview;\n"
+    "    mat3 normal;\n"
+    "    vec4 dequant;\n"
+    "};\n"
+    "\n"
+    "struct Mesh {\n"
+    "    vec4 sphere, lo, hi;\n"
+    "    uint count, first;\n"
+    "    int base_vertex;\n"
+    "    uint indexed;\n"
+    "};\n"
+    "\n"
+    "struct Command {\n"
+    "    uint count, instance_count, first;\n"
+    "    int base_vertex;\n"
+    "    uint base_instance;\n"
+    "};\n"
+    "\n"
+    "layout(std430, binding = 0) readonly buffer Objects {\n"
+    "    Object objects[];\n"
+    "};\n"
+    "layout(std430, binding = 1) readonly buffer Draws {\n"
+    "    uvec2 draws[]; // mesh, batch\n"
+    "};\n"
+    "layout(std430, binding = 2) readonly buffer Meshes {\n"
+    "    Mesh meshes[];\n"
+    "};\n"
+    "layout(std430, binding = 3) readonly buffer Batches {\n"
+    "    uint batch_first[];\n"
+    "};\n"
+    "layout(std430, binding = 4) writeonly buffer Commands {\n"
+    "    Command commands[];\n"
+    "};\n"
+    "layout(std430, binding = 5) buffer Counts {\n"
+    "    uint visible;\n"
+    "    uint occluded;\n"
+    "    uint counts[];\n"
+    "};\n"
+    "\n"
+    "layout(location = 0) uniform vec4 planes[6]; // view space, pointing inwards\n"
+    "layout(location = 6) uniform uint n;\n"
+    "layout(location = 7) uniform bool compact;\n"
+    "layout(location = 8) uniform bool occlusion;\n"
+    "layout(location = 9) uniform mat4 reproject; // view space to the clip space of the pyramid's frame\n"
+    "\n"
+    "layout(binding = 0) uniform sampler2D pyramid; // farthest depth under every texel, one level per halving\n"
+    "\n"
+    "// whether a box (in object space) is behind the pyramid's depth everywhere it covers\n"
+    "bool occluded_box(mat4 mv, vec3 lo, vec3 hi) {\n"
+    "    mat4 m = reproject * mv;\n"
+    "    vec2 a = vec2(1.0), b = vec2(-1.0);\n"
+    "    float near = 1.0;\n"
+    "    for (int i = 0; i < 8; i++) {\n"
+    "        vec3 p = mix(lo, hi, bvec3((i & 1) != 0, (i & 2) != 0, (i & 4) != 0));\n"
+    "        vec4 q = m * vec4(p, 1.0);\n"
+    "\n"
+    "        // a box reaching behind the camera covers too much of the screen to tell\n"
+    "        if (q.w <= 1e-5)\n"
+    "            return false;\n"
+    "        q.xyz /= q.w;\n"
+    "        a = min(a, q.xy), b = max(b, q.xy);\n"
+    "        near = min(near, q.z);\n"
+    "    }\n"
+    "\n"
+    "    // nothing is known of the depth outside of the pyramid's frame\n"
+    "    if (any(lessThan(a, vec2(-1.0))) || any(greaterThan(b, vec2(1.0))))\n"
+    "        return false;\n"
+    "\n"
+    "    // texels of the first level under the box (and around it), then the level where they span two at most\n"
+    "    vec2 size = vec2(textureSize(pyramid, 0));\n"
+    "    ivec2 p0 = max(ivec2(floor((a * 0.5 + 0.5) * size)) - 1, ivec2(0));\n"
+    "    ivec2 p1 = min(ivec2(floor((b * 0.5 + 0.5) * size)) + 1, ivec2(size) - 1);\n"
+    "    ivec2 span = p1 - p0;\n"
+    "    int level = min(findMSB(max(span.x, span.y)) + 1, textureQueryLevels(pyramid) - 1);\n"
+    "    ivec2 last = textureSize(pyramid, level) - 1;\n"
+    "    p0 = min(p0 >> level, last), p1 = min(p1 >> level, last);\n"
+    "\n"
+    "    float far = max(max(texelFetch(pyramid, p0, level).r, texelFetch(pyramid, ivec2(p1.x, p0.y), level).r),\n"
+    "                    max(texelFetch(pyramid, ivec2(p0.x, p1.y), level).r, texelFetch(pyramid, p1, level).r));\n"
+    "    return near * 0.5 + 0.5 > far;\n"
+    "}\n"
+    "\n"
+    "void main() {\n"
+    "    uint k = gl_GlobalInvocationID.x;\n"
+    "    if (k >= n)\n"
+    "        return;\n"
+    "\n"
+    "    uvec2 d = draws[k];\n"
+    "    Mesh m = meshes[d.x];\n"
+    "    mat4 mv = objects[k].modelview;\n"
+    "\n"
+    "    // bounding sphere in view space (scaled by the largest axis)\n"
+    "    vec3 c = (mv * vec4(m.sphere.xyz, 1.0)).xyz;\n"
+    "    float s = max(length(mv[0].xyz), length(mv[1].xyz));\n"
+    "    float r = m.sphere.w * max(s, length(mv[2].xyz));\n"
+    "\n"
+    "    bool vis = true;\n"
+    "    for (int i = 0; i < 6; i++)\n"
+    "        vis = vis && dot(planes[i].xyz, c) > -planes[i].w - r;\n"
+    "\n"
+    "    // hidden behind what the last frame drew\n"
+    "    if (vis && occlusion && occluded_box(mv, m.lo.xyz, m.hi.xyz)) {\n"
+    "        vis = false;\n"
+    "        atomicAdd(occluded, 1u);\n"
+    "    }\n"
+    "\n"
+    "    if (vis)\n"
+    "        atomicAdd(visible, 1u);\n"
+    "\n"
+    "    // packed into the batch, or in the object's own slot\n"
+    "    uint slot = k;\n"
+    "    if (compact) {\n"
+    "        if (!vis)\n"
+    "            return;\n"
+    "        slot = batch_first[d.y] + atomicAdd(counts[d.y], 1u);\n"
+    "    }\n"
+    "\n"
+    "    // arrays commands end in their base instance\n"
+    "    uint inst = vis ? 1u : 0u;\n"
+    "    int last = m.indexed != 0u ? m.base_vertex : int(k);\n"
+    "    uint base = m.indexed != 0u ? k : 0u;\n"
+    "    commands[slot] = Command(m.count, inst, m.first, last, base);\n"
+    "}\n"
+    , GL_COMPUTE_SHADER
+};
+
+
+void cull_init(culler *c) {
+    memset(c, 0, sizeof(*c));
+
+    // without indirect draw counts, culled objects are drawn with no instances instead
+    c->compact = GLEW_ARB_indirect_parameters;
+
+    uint cs;
+    if (!compile_shader(&cs, SHADER_CULL)) {
+        error("Failed to compile the culling shader.");
+        exit(EXIT_FAILURE);
+    }
+    c->program = glCreateProgram();
+    glAttachShader(c->program, cs);
+    glLinkProgram(c->program);
+    glDeleteShader(cs);
+
+    glGenBuffers(1, &c->draws);
+    glGenBuffers(1, &c->meshes);
+    glGenBuffers(1, &c->batches);
+    glGenBuffers(1, &c->commands);
+    glGenBuffers(1, &c->counts);
+
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &c->readback);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, c->readback);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, CULL_READBACK * 2 * sizeof(uint), NULL, flags);
+    c->visible_counts = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, CULL_READBACK * 2 * sizeof(uint), flags);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/// @brief Replace the contents of a storage buffer
+static void cull_upload(const uint buffer, const size_t size, const void *data) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void cull_build(culler *c, const world *w, const uint *order, const uint8_t *levels, const struct DrawBatch *batches,
+                const uint batches_len) {
+    const mesh_registry *mr = &w->meshes;
+    const size_t n = w->len > 0 ? w->len : 1;
+    const size_t versions = (mr->len > 0 ? mr->len : 1) * (LOD_MAX + 1);
+
+    uint *draws = malloc(n * 2 * sizeof(uint));
+    cull_mesh *meshes = malloc(versions * sizeof(cull_mesh));
+    uint *first = malloc((batches_len > 0 ? batches_len : 1) * sizeof(uint));
+    if (!draws || !meshes || !first) {
+        error("Failed to allocate the culling data.");
+        exit(EXIT_FAILURE);
+    }
+
+    // mesh version and batch of every object, in draw order
+    for (uint b = 0; b < batches_len; b++) {
+        first[b] = batches[b].first_object;
+        for (uint k = first[b]; k < first[b] + batches[b].objects; k++) {
+            draws[2 * k] = w->mesh[order[k]] * (LOD_MAX + 1) + levels[order[k]];
+            draws[2 * k + 1] = b;
+        }
+    }
+
+    // every version of a mesh shares its bounds and vertices (missing versions are the mesh itself)
+    memset(meshes, 0, versions * sizeof(cull_mesh));
+    for (uint i = 0; i < mr->len; i++) {
+        const mesh *me = &mr->meshes[i];
+        for (uint l = 0; l <= LOD_MAX; l++) {
+            const lod_level *lod = &me->lod[l < me->lods ? l : 0];
+            cull_mesh *cm = &meshes[i * (LOD_MAX + 1) + l];
+            memcpy(cm->sphere, me->sphere, sizeof(vec4));
+            memcpy(cm->lo, me->box.lo, sizeof(vec3));
+            memcpy(cm->hi, me->box.hi, sizeof(vec3));
+            cm->indexed = me->has_ebo;
+            cm->count = me->has_ebo ? lod->indices_len : me->vertices_len / 3;
+            cm->first = me->has_ebo ? lod->first_index : me->base_vertex;
+            cm->base_vertex = me->base_vertex;
+        }
+    }
+
+    cull_upload(c->draws, n * 2 * sizeof(uint), draws);
+    cull_upload(c->meshes, versions * sizeof(cull_mesh), meshes);
+    cull_upload(c->batches, (batches_len > 0 ? batches_len : 1) * sizeof(uint), first);
+    cull_upload(c->counts, (2 + batches_len) * sizeof(uint), NULL);
+
+    // the commands are only ever written by the pass
+    if (n > c->cap) {
+        cull_upload(c->commands, n * sizeof(struct DrawCommand), NULL);
+        c->cap = n;
+    }
+    c->objects = batches_len ? batches[batches_len - 1].first_object + batches[batches_len - 1].objects : 0;
+
+    free(draws);
+    free(meshes);
+    free(first);
+}
+
+/// @brief Read back the visible counts of finished frames, oldest first, without waiting on the GPU
+static void cull_resolve(culler *c) {
+    for (uint64_t i = c->frame < CULL_READBACK ? 0 : c->frame - CULL_READBACK; i < c->frame; i++) {
+        const uint slot = i % CULL_READBACK;
+        if (!c->fences[slot])
+            continue;
+        if (glClientWaitSync(c->fences[slot], 0, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+
+        c->visible = c->visible_counts[2 * slot];
+        c->occluded = c->visible_counts[2 * slot + 1];
+        c->visible_sum += c->visible;
+        c->occluded_sum += c->occluded;
+        c->resolved++;
+        glDeleteSync(c->fences[slot]);
+        c->fences[slot] = NULL;
+    }
+}
+
+/// @brief Frustum planes in view space, pointing inwards (Gribb and Hartmann, from the rows of the projection)
+static void cull_planes(vec4 planes[6], mat4x4 const p) {
+    for (uint i = 0; i < 3; i++)
+        for (uint l = 0; l < 4; l++) {
+            planes[2 * i][l] = p[l][3] + p[l][i];
+            planes[2 * i + 1][l] = p[l][3] - p[l][i];
+        }
+
+    // unit normals, so the distances compare with the radius
+    for (uint i = 0; i < 6; i++)
+        vec4_scale(planes[i], planes[i], 1.0f / vec3_len(planes[i]));
+}
+
+void cull_dispatch(culler *c, mat4x4 const projection, const hiz *h, mat4x4 const view) {
+    cull_resolve(c);
+
+    // a frame whose count never arrived before its slot got reused is skipped
+    const uint slot = c->frame % CULL_READBACK;
+    if (c->fences[slot]) {
+        glDeleteSync(c->fences[slot]);
+        c->fences[slot] = NULL;
+    }
+
+    vec4 planes[6];
+    cull_planes(planes, projection);
+
+    // every count starts at 0 (cleared on the GPU, so the CPU never sees a visibility)
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, c->counts);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_CULL_DRAWS, c->draws);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_CULL_MESHES, c->meshes);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_CULL_BATCHES, c->batches);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_CULL_COMMANDS, c->commands);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_CULL_COUNTS, c->counts);
+
+    glUseProgram(c->program);
+    glUniform4fv(0, 6, (float *)planes);
+    glUniform1ui(6, c->objects);
+    glUniform1i(7, c->compact);
+
+    // the pyramid was built from the last frame, whose clip space the view space is taken back to
+    const int occlusion = h && h->mode != HIZ_OFF && h->ready;
+    glUniform1i(8, occlusion);
+    if (occlusion) {
+        mat4x4 inv, reproject;
+        mat4x4_invert(inv, (vec4 *)view);
+        mat4x4_mul(reproject, (vec4 *)h->clip, inv);
+        glUniformMatrix4fv(9, 1, GL_FALSE, (float *)reproject);
+        glActiveTexture(GL_TEXTURE0 + HIZ_UNIT);
+        glBindTexture(GL_TEXTURE_2D, h->pyramid);
+    }
+    if (c->objects)
+        glDispatchCompute((c->objects + CULL_GROUP - 1) / CULL_GROUP, 1, 1);
+    if (occlusion)
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+    // the commands and counts are read by the draws, and the overall counts by the copy below
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, c->counts);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, c->readback);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, slot * 2 * sizeof(uint), 2 * sizeof(uint));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    c->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    c->frame++;
+}
+
+void cull_free(culler *c) {
+    for (uint i = 0; i < CULL_READBACK; i++)
+        if (c->fences[i])
+            glDeleteSync(c->fences[i]);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, c->readback);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    const uint buffers[] = {c->draws, c->meshes, c->batches, c->commands, c->counts, c->readback};
+    glDeleteBuffers(6, buffers);
+    glDeleteProgram(c->program);
+    memset(c, 0, sizeof(*c));
+}
@@ -1,4 +1,5 @@
 #include "fpsdbg.h"
+#include "simd.h"
 
 uint WIDTH, HEIGHT;
 float ASPECT;
@@ -19,11 +20,11 @@ void upt_cam() {
 
     // init modelview matrix (model * view * translate * ...)
     mat4x4_identity(cam.m);
-    mat4x4_mul(cam.m, cam.m, cam.v);
+    simd.mat4x4_mul(cam.m, cam.m, cam.v);
 
     mat4x4_identity(cam.t);
     mat4x4_translate(cam.t, cam.pos[0], cam.pos[1], cam.pos[2]);
-    mat4x4_mul(cam.m, cam.m, cam.t);
+    simd.mat4x4_mul(cam.m, cam.m, cam.t);
 }
 
 void framebuffer_size_callback(GLFWwindow *window, const int w, const int h) {
@@ -46,173 +47,147 @@ void scroll_callback(GLFWwindow *window, const double xoffset, const double yoff
 }
 
 void calc_norm(const uint n, const vec3 vertices[], vec3 normals[]) {
-    /// @param i index of vertex (a)
-    /// @param j index of vertex (b)
-    /// @param k index of vertex (c)
-    /// @param l temp index variable
-    uint i, j, k, l;
-
-    /// @param a neighboring edge
-    /// @param b edge (u)
-    /// @param c edge (v)
-    const float *a, *b, *c;
-
-    /// @param dif_b magnitude between edges `a` and `b`
-    /// @param dif_c magnitude between edges `a` and `c`
-    /// @param prod cross product between vectors `dif_b` and `dif_c`
-    /// @param norm normalization of the cross product
-    vec3 dif_b, dif_c, prod, norm;
-
-    for (i = 0; i < n; i += 3) {
-        j = i + 1;
-        k = j + 1;
-
-        a = vertices[i],
-        b = vertices[j],
-        c = vertices[k];
-
-        // differences between edges
-        vec3_sub(dif_b, b, a);
-        vec3_sub(dif_c, c, a);
-
-        // cross product then unit length
-        vec3_mul_cross(prod, dif_b, dif_c);
-        vec3_norm(norm, prod);
-
-        // set each vertex to the unit vector
-        for (l = 0; l < 3; l++) {
-            normals[i][l] = norm[l];
-            normals[j][l] = norm[l];
-            normals[k][l] = norm[l];
-        }
-    }
+    normals_flat(NULL, n, vertices, NULL, NULL, normals);
 }
 
-uint create_object(world *wd, const uint program, const uint n, const uint m, const float *vertices, const uint *indices, const GLenum usage, const GLenum mode) {
-    uint vao, vbo;
-    GLboolean has_ebo = m > 0;
-
-    {
-        // init buffers and `a_pos` attribute
-        // creates and bind Vertex Array Object (VAO)
-        glGenVertexArrays(1, &vao);
-        glBindVertexArray(vao);
-
-        // create and bind Vertex Buffer Object (VBO)
-        glGenBuffers(1, &vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, n * sizeof(float), vertices, usage);
-
-        // create and bind Elements Buffer Object (EBO)
-        if (has_ebo) {
-            uint ebo;
-            glGenBuffers(1, &ebo);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, m * sizeof(float), indices, usage);
-        }
-
-        // enable `a_pos` vertex attribute
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(0);
-    }
-
-    {
-        // init `a_norm` attribute
-        // total number of triangles
-        const uint n_of_tri = n / 3;
-
-        // calculate the normals of the geometry
-        vec3 normals[n_of_tri];
-        calc_norm(n_of_tri, (vec3 *)vertices, normals);
+handle create_object(world *wd, const uint program, const uint n, const uint m, const float *vertices, const uint *indices, const GLenum usage, const GLenum mode) {
+    // the geometry gets a mesh of its own, placed as-is
+    mat4x4 model;
+    mat4x4_identity(model);
 
-        glBindBuffer(GL_NORMAL_ARRAY, vbo);
-        glBufferData(GL_NORMAL_ARRAY, n * sizeof(float), normals, usage);
-
-        // enable `a_norm` vertex attribute
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-        glEnableVertexAttribArray(1);
-    }
-
-    // unbind everything
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    const uint me = mesh_create(&wd->meshes, NULL, n, m, vertices, indices, mode, NORMALS_ANGLE);
+    return create_instance(wd, program, me, model);
+}
 
-    // current number of objects
-    const uint i = wd->objects_len;
+handle create_instance(world *wd, const uint program, const uint me, mat4x4 const model) {
+    const mesh *msh = &wd->meshes.meshes[me];
 
-    // assign next object
-    wd->objects[i] = (obj) {
-        vao, program, n, m, mode, has_ebo
+    obj o = {
+        msh->base_vertex, msh->first_index, program, msh->vertices_len, msh->indices_len, msh->mode, msh->has_ebo, msh->index_type, me
     };
+    mat4x4_dup(o.model, model);
 
-    // increment size
-    wd->objects_len += 1;
-
-    return i;
+    // store the object (the world grows as needed)
+    return world_add(wd, o);
 }
 
-uint create_rect(world *wd, const uint program, const vec3 pos, const vec3 dim) {
-    const float
-    x = pos[0], // x-pos
-    y = pos[1], // y-pos
-    z = pos[2], // z-pos
-    w = dim[0], // width
-    h = dim[1], // height
-    l = dim[2]; // length
-
-    // temp values
-    const float xw = x + w;
-    const float yh = y + h;
-    const float zl = z + l;
-
-    // vertex positions for a cube
-    const float vertices[] = {
-        x, y, z, // (0, 0, 0) [0]
-        x, y, zl, // (0, 0, 1) [1]
-        x, yh, z, // (0, 1, 0) [2]
-        x, yh, zl, // (0, 1, 1) [3]
-        xw, y, z, // (1, 0, 0) [4]
-        xw, y, zl, // (1, 0, 1) [5]
-        xw, yh, z, // (1, 1, 0) [6]
-        xw, yh, zl, // (1, 1, 1) [7]
-    };
-
-    // form the cube with all counter-clockwise triangles
-    const uint indices[] = {
-        // FRONT
-        1, 5, 7,
-        7, 3, 1,
+handle create_rect(world *wd, const uint program, const vec3 pos, const vec3 dim) {
+    // every rectangular-prism is an instance of the same unit cube
+    uint me = mesh_find(&wd->meshes, "cube");
+    if (me == MESH_NONE) {
+        // vertex positions for a cube (centered, so it rotates in place)
+        const float vertices[] = {
+            -0.5, -0.5, -0.5, // (0, 0, 0) [0]
+            -0.5, -0.5, 0.5, // (0, 0, 1) [1]
+            -0.5, 0.5, -0.5, // (0, 1, 0) [2]
+            -0.5, 0.5, 0.5, // (0, 1, 1) [3]
+            0.5, -0.5, -0.5, // (1, 0, 0) [4]
+            0.5, -0.5, 0.5, // (1, 0, 1) [5]
+            0.5, 0.5, -0.5, // (1, 1, 0) [6]
+            0.5, 0.5, 0.5, // (1, 1, 1) [7]
+        };
+
+        // form the cube with all counter-clockwise triangles
+        const uint indices[] = {
+            // FRONT
+            1, 5, 7,
+            7, 3, 1,
+
+            // RIGHT
+            5, 4, 6,
+            6, 7, 5,
+
+            // BACK
+            2, 6, 4,
+            4, 0, 2,
+
+            // LEFT
+            0, 1, 3,
+            3, 2, 0,
+
+            // BOTTOM
+            0, 4, 5,
+            5, 1, 0,
+
+            // TOP
+            3, 7, 6,
+            6, 2, 3
+        };
+
+        // create the cube (with normals)
+        me = mesh_create(&wd->meshes, "cube", 24, 36,
+                         vertices,
+                         indices,
+                         GL_TRIANGLES,
+                         NORMALS_FLAT);
+    }
 
-        // RIGHT
-        5, 4, 6,
-        6, 7, 5,
+    // move the unit cube's center to the center of the prism, then scale it to its dimensions
+    mat4x4 model;
+    mat4x4_translate(model, pos[0] + dim[0] / 2, pos[1] + dim[1] / 2, pos[2] + dim[2] / 2);
+    mat4x4_scale_aniso(model, model, dim[0], dim[1], dim[2]);
 
-        // BACK
-        2, 6, 4,
-        4, 0, 2,
+    return create_instance(wd, program, me, model);
+}
 
-        // LEFT
-        0, 1, 3,
-        3, 2, 0,
+handle create_sphere(world *wd, const uint program, const vec3 pos, const float r, const uint seg) {
+    // rings of latitude and longitude (at least a tetrahedron-ish shape)
+    const uint rings = seg < 4 ? 2 : seg / 2;
+    const uint cols = seg < 3 ? 3 : seg;
+
+    // spheres of the same resolution are instances of the same unit sphere
+    char name[MESH_NAME_LEN];
+    snprintf(name, sizeof(name), "sphere/%u", cols);
+
+    mat4x4 model;
+    mat4x4_translate(model, pos[0], pos[1], pos[2]);
+    mat4x4_scale_aniso(model, model, r, r, r);
+
+    const uint found = mesh_find(&wd->meshes, name);
+    if (found != MESH_NONE)
+        return create_instance(wd, program, found, model);
+
+    const uint n = (rings + 1) * (cols + 1) * 3;
+    const uint m = rings * cols * 6;
+    float *vertices = malloc(n * sizeof(float));
+    uint *indices = malloc(m * sizeof(uint));
+    if (!vertices || !indices) {
+        error("Failed to allocate sphere geometry.");
+        exit(EXIT_FAILURE);
+    }
 
-        // BOTTOM
-        0, 4, 5,
-        5, 1, 0,
+    // one vertex per grid point (the seam is duplicated, and welded back together for the normals)
+    float *v = vertices;
+    for (uint i = 0; i <= rings; i++) {
+        const float phi = M_PI * i / rings;
+        for (uint j = 0; j <= cols; j++) {
+            const float theta = M_TAU * j / cols;
+            *v++ = sinf(phi) * cosf(theta);
+            *v++ = cosf(phi);
+            *v++ = sinf(phi) * sinf(theta);
+        }
+    }
 
-        // TOP
-        3, 7, 6,
-        6, 2, 3
-    };
+    // two counter-clockwise triangles per grid cell
+    uint *e = indices;
+    for (uint i = 0; i < rings; i++)
+        for (uint j = 0; j < cols; j++) {
+            const uint a = i * (cols + 1) + j, b = a + cols + 1;
+            *e++ = a, *e++ = a + 1, *e++ = b;
+            *e++ = b, *e++ = a + 1, *e++ = b + 1;
+        }
 
-    // create the cube (with normals)
-    return create_object(wd, program, 24, 36,
-                         vertices,
-                         indices,
-                         GL_STATIC_DRAW,
-                         GL_TRIANGLES);
+    const uint me = mesh_create(&wd->meshes, name, n, m,
+                                vertices,
+                                indices,
+                                GL_TRIANGLES,
+                                NORMALS_ANGLE);
+    free(vertices);
+    free(indices);
+    return create_instance(wd, program, me, model);
 }
 
-GLFWwindow *init() {
+GLFWwindow *init(const uint width, const uint height, const uint samples) {
     glfwSetErrorCallback(_error);
 
     // init GLFW
@@ -237,16 +212,16 @@ GLFWwindow *init() {
         exit(EXIT_FAILURE);
     }
 
-    // initial window dimensions
-    const int w = video->width / 2;
-    const int h = video->height / 2;
+    // initial window dimensions (half the monitor, unless specified)
+    const int w = width ? (int)width : video->width / 2;
+    const int h = height ? (int)height : video->height / 2;
 
     // use GLSL 4.6
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 
-    // 8 samples of anti-aliasing
-    glfwWindowHint(GLFW_SAMPLES, 8);
+    // samples of anti-aliasing
+    glfwWindowHint(GLFW_SAMPLES, samples);
 
     // init GLFW window
     GLFWwindow *window = glfwCreateWindow(w, h, "fpsdbg", NULL, NULL);
@@ -0,0 +1,110 @@
+/// GL call tracing: in profiling builds (`GLTRACE` defined, see `make profile`), the GL entry points the engine
+/// calls are redirected to wrappers counting the calls, the bytes they upload and the CPU time spent in each, per
+/// frame. Tracing is switched on and off at runtime; other builds keep none of it.
+/// @file
+/// @author Evan Schwartzentruber
+
+// the wrappers call the entry points themselves
+#define GLTRACE_IMPL
+
+#include "gltrace.h"
+
+#ifdef GLTRACE
+
+#include "prof.h"
+#include <string.h>
+
+
+gltrace gl_trace;
+
+
+/// @brief Names of the entry points, by index
+#define GLTRACE_NAME(name, ...) #name,
+#define GLTRACE_NAME_R(ret, name, ...) #name,
+static const char *GLTRACE_NAMES[GLTRACE_COUNT] = {GLTRACE_ENTRIES(GLTRACE_NAME, GLTRACE_NAME_R)};
+#undef GLTRACE_NAME
+#undef GLTRACE_NAME_R
+
+
+/// @brief Add a call to the current frame
+static void gltrace_record(const gltrace_entry e, const uint64_t start, const uint64_t bytes) {
+    gltrace_cost *c = &gl_trace.frame[e];
+    c->calls++;
+    c->bytes += bytes;
+    c->ns += prof_now() - start;
+}
+
+// every wrapper goes straight to GL while tracing is off
+#define GLTRACE_WRAP(name, params, args, bytes) \
+    void gltrace_##name params { \
+        if (!gl_trace.enabled) { \
+            name args; \
+            return; \
+        } \
+        const uint64_t start = prof_now(); \
+        name args; \
+        gltrace_record(GLTRACE_##name, start, bytes); \
+    }
+#define GLTRACE_WRAP_R(ret, name, params, args, bytes) \
+    ret gltrace_##name params { \
+        if (!gl_trace.enabled) \
+            return name args; \
+        const uint64_t start = prof_now(); \
+        ret result = name args; \
+        gltrace_record(GLTRACE_##name, start, bytes); \
+        return result; \
+    }
+GLTRACE_ENTRIES(GLTRACE_WRAP, GLTRACE_WRAP_R)
+#undef GLTRACE_WRAP
+#undef GLTRACE_WRAP_R
+
+
+void gltrace_enable(const int on) {
+    // a frame is only counted if it was traced from its start
+    memset(gl_trace.frame, 0, sizeof(gl_trace.frame));
+    gl_trace.enabled = on;
+}
+
+void gltrace_frame() {
+    if (!gl_trace.enabled)
+        return;
+
+    for (uint e = 0; e < GLTRACE_COUNT; e++) {
+        gl_trace.all[e].calls += gl_trace.frame[e].calls;
+        gl_trace.all[e].bytes += gl_trace.frame[e].bytes;
+        gl_trace.all[e].ns += gl_trace.frame[e].ns;
+    }
+    memset(gl_trace.frame, 0, sizeof(gl_trace.frame));
+    gl_trace.frames++;
+}
+
+void gltrace_json(FILE *out) {
+    const double n = gl_trace.frames ? (double)gl_trace.frames : 1.0;
+
+    gltrace_cost sum = {0};
+    for (uint e = 0; e < GLTRACE_COUNT; e++) {
+        sum.calls += gl_trace.all[e].calls;
+        sum.bytes += gl_trace.all[e].bytes;
+        sum.ns += gl_trace.all[e].ns;
+    }
+
+    // costs are means per frame, the entry points in the order of the table
+    fprintf(out, "{\"frames\": %lu, \"calls\": %.1f, \"bytes\": %.0f, \"us\": %.3f, \"entries\": {",
+            (unsigned long)gl_trace.frames, sum.calls / n, sum.bytes / n, sum.ns / n / 1e3);
+    uint written = 0;
+    for (uint e = 0; e < GLTRACE_COUNT; e++) {
+        const gltrace_cost *c = &gl_trace.all[e];
+        if (!c->calls)
+            continue;
+        fprintf(out, "%s\"%s\": {\"calls\": %.1f, \"bytes\": %.0f, \"us\": %.3f}", written++ ? ", " : "",
+                GLTRACE_NAMES[e], c->calls / n, c->bytes / n, c->ns / n / 1e3);
+    }
+    fprintf(out, "}}");
+}
+
+#else
+
+// ISO C needs every file to declare something
+typedef int gltrace_none;
+
+#endif
@@ -0,0 +1,70 @@
+/// GPU-side frame timing through a ring of in-flight `GL_TIMESTAMP` queries.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "gputimer.h"
+
+
+void gpu_timer_init(gpu_timer *t) {
+    *t = (gpu_timer) {
+        0
+    };
+    glGenQueries(GPU_TIMER_RING * GPU_STAMPS, &t->queries[0][0]);
+}
+
+/// @brief Read back a slot if all of its results are available, without blocking
+/// @return whether the slot was resolved
+static int gpu_timer_resolve(gpu_timer *t, const uint slot, profiler *p) {
+    // timestamps complete in order, so the last one being available implies the rest are
+    GLint available = 0;
+    glGetQueryObjectiv(t->queries[slot][GPU_STAMPS - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return 0;
+
+    GLuint64 stamps[GPU_STAMPS];
+    for (uint i = 0; i < GPU_STAMPS; i++)
+        glGetQueryObjectui64v(t->queries[slot][i], GL_QUERY_RESULT, &stamps[i]);
+
+    uint64_t phase_ns[GPU_PHASE_COUNT];
+    for (uint k = 0; k < GPU_PHASE_COUNT; k++)
+        phase_ns[k] = stamps[k + 1] - stamps[k];
+
+    prof_gpu(p, phase_ns);
+    t->pending[slot] = GL_FALSE;
+    return 1;
+}
+
+void gpu_timer_begin(gpu_timer *t, profiler *p) {
+    // resolve finished frames oldest first, stopping at the first one still in flight
+    for (uint64_t i = t->frame < GPU_TIMER_RING ? 0 : t->frame - GPU_TIMER_RING; i < t->frame; i++) {
+        const uint slot = i % GPU_TIMER_RING;
+        if (t->pending[slot] && !gpu_timer_resolve(t, slot, p))
+            break;
+    }
+
+    // reusing a slot whose results never arrived discards them
+    const uint slot = t->frame % GPU_TIMER_RING;
+    if (t->pending[slot]) {
+        t->pending[slot] = GL_FALSE;
+        t->dropped++;
+    }
+
+    t->stamp = 0;
+    glQueryCounter(t->queries[slot][t->stamp++], GL_TIMESTAMP);
+}
+
+void gpu_timer_mark(gpu_timer *t, const gpu_phase ph) {
+    glQueryCounter(t->queries[t->frame % GPU_TIMER_RING][ph + 1], GL_TIMESTAMP);
+    t->stamp++;
+}
+
+void gpu_timer_end(gpu_timer *t) {
+    // only frames that issued every timestamp can be resolved
+    if (t->stamp == GPU_STAMPS)
+        t->pending[t->frame % GPU_TIMER_RING] = GL_TRUE;
+    t->frame++;
+}
+
+void gpu_timer_free(gpu_timer *t) {
+    glDeleteQueries(GPU_TIMER_RING * GPU_STAMPS, &t->queries[0][0]);
+}
@@ -0,0 +1,166 @@
+/// Offscreen rendering context (EGL surfaceless, or a hidden GLFW window as a fallback) drawing into an FBO.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "fpsdbg.h"
+#include "headless.h"
+#include <EGL/eglext.h>
+
+
+/// @brief Create a surfaceless EGL context with desktop OpenGL 4.6 (or 4.5, e.g. on llvmpipe)
+/// @return whether the context is current
+static int init_egl(headless *hl) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!get_platform_display)
+        return 0;
+
+    hl->display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (hl->display == EGL_NO_DISPLAY)
+        return 0;
+
+    if (!eglInitialize(hl->display, NULL, NULL) || !eglBindAPI(EGL_OPENGL_API)) {
+        hl->display = EGL_NO_DISPLAY;
+        return 0;
+    }
+
+    // highest version first
+    const EGLint minors[] = {6, 5};
+    for (uint i = 0; i < sizeof(minors) / sizeof(*minors); i++) {
+        const EGLint attribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, minors[i],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        hl->context = eglCreateContext(hl->display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+        if (hl->context != EGL_NO_CONTEXT)
+            break;
+    }
+
+    if (hl->context == EGL_NO_CONTEXT || !eglMakeCurrent(hl->display, EGL_NO_SURFACE, EGL_NO_SURFACE, hl->context)) {
+        eglTerminate(hl->display);
+        hl->display = EGL_NO_DISPLAY;
+        return 0;
+    }
+    return 1;
+}
+
+/// @brief Create a hidden GLFW window (needs a display server, but no monitor)
+/// @return whether the context is current
+static int init_hidden_window(headless *hl) {
+    glfwSetErrorCallback(_error);
+    if (!glfwInit())
+        return 0;
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    hl->window = glfwCreateWindow(1, 1, "fpsdbg", NULL, NULL);
+    if (!hl->window) {
+        glfwTerminate();
+        return 0;
+    }
+    glfwMakeContextCurrent(hl->window);
+
+    // never wait for vertical sync
+    glfwSwapInterval(0);
+    return 1;
+}
+
+/// @brief Release the context (and the window, if the fallback was used)
+static void destroy_context(headless *hl) {
+    if (hl->display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(hl->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(hl->display, hl->context);
+        eglTerminate(hl->display);
+    }
+
+    if (hl->window) {
+        glfwDestroyWindow(hl->window);
+        glfwTerminate();
+    }
+}
+
+void init_headless(headless *hl, const uint w, const uint h, uint samples) {
+    *hl = (headless) {
+        .display = EGL_NO_DISPLAY,
+        .context = EGL_NO_CONTEXT
+    };
+
+    if (!init_egl(hl) && !init_hidden_window(hl)) {
+        error("Failed to create an offscreen OpenGL context.");
+        exit(EXIT_FAILURE);
+    }
+
+    // init GLEW (without GLX, GLEW reports a missing display after loading the core entry points)
+    glewExperimental = GL_TRUE;
+    const GLenum err = glewInit();
+    if (err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY) {
+        error("Failed to initialize GLEW.");
+        destroy_context(hl);
+        exit(EXIT_FAILURE);
+    }
+    // discard errors raised while GLEW was probing
+    while (glGetError() != GL_NO_ERROR);
+
+    // offscreen render target, matching what the window would get (as far as the driver allows)
+    GLint max_samples;
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    if (samples > (uint)max_samples)
+        samples = max_samples;
+
+    glGenRenderbuffers(1, &hl->color);
+    glBindRenderbuffer(GL_RENDERBUFFER, hl->color);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, w, h);
+
+    glGenRenderbuffers(1, &hl->depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, hl->depth);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, w, h);
+
+    glGenFramebuffers(1, &hl->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, hl->fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, hl->color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, hl->depth);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        error("Failed to create the offscreen framebuffer.");
+        headless_free(hl);
+        exit(EXIT_FAILURE);
+    }
+
+    // same defaults as `init`
+    glEnable(GL_MULTISAMPLE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    framebuffer_size_callback(NULL, w, h);
+}
+
+void headless_swap(headless *hl) {
+    const uint slot = hl->frame % HEADLESS_LATENCY;
+
+    // wait for the frame that last used this slot, so at most `HEADLESS_LATENCY` frames are queued
+    if (hl->fences[slot]) {
+        while (glClientWaitSync(hl->fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(hl->fences[slot]);
+    }
+    hl->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    hl->frame++;
+}
+
+void headless_free(headless *hl) {
+    for (uint i = 0; i < HEADLESS_LATENCY; i++)
+        if (hl->fences[i])
+            glDeleteSync(hl->fences[i]);
+
+    glDeleteFramebuffers(1, &hl->fbo);
+    glDeleteRenderbuffers(1, &hl->color);
+    glDeleteRenderbuffers(1, &hl->depth);
+
+    destroy_context(hl);
+}
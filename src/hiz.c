@@ -0,0 +1,246 @@
+/// Hierarchical depth (Hi-Z): a pyramid of the farthest depth under every texel of the last frame's depth buffer,
+/// built by a compute downsample chain, so the culling pass can tell objects hidden behind what was drawn.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "hiz.h"
+#include <string.h>
+
+
+const char *HIZ_MODE_NAMES[HIZ_MODE_COUNT] = {"off", "on", "show"};
+
+
+// one invocation per texel of the level being built (the work group size is `HIZ_GROUP` squared)
+static const shader SHADER_REDUCE = {
+    "#version 450\n"
+    "layout(local_size_x = 8, local_size_y = 8) in;\n"
+    "\n"
+    "layout(binding = 0) uniform sampler2D depth;\n"
+    "layout(binding = 1) uniform sampler2DMS depth_samples;\n"
+    "layout(r32f, binding = 0) readonly uniform image2D src;\n"
+    "layout(r32f, binding = 1) writeonly uniform image2D dst;\n"
+    "\n"
+    "layout(location = 0) uniform bool first; // read the depth buffer rather than the level below\n"
+    "layout(location = 1) uniform int samples; // samples per pixel of the depth buffer (0 if not multisampled)\n"
+    "\n"
+    "void main() {\n"
+    "    ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+    "    ivec2 size = imageSize(dst);\n"
+    "    if (any(greaterThanEqual(p, size)))\n"
+    "        return;\n"
+    "\n"
+    "    // the farthest of a pixel's samples, as an object is only hidden where all of them are in front of it\n"
+    "    if (first) {\n"
+    "        float far = samples > 0 ? 0.0 : texelFetch(depth, p, 0).r;\n"
+    "        for (int k = 0; k < samples; k++)\n"
+    "            far = max(far, texelFetch(depth_samples, p, k).r);\n"
+    "        imageStore(dst, p, vec4(far));\n"
+    "        return;\n"
+    "    }\n"
+    "\n"
+    "    // the last texel of a row or column also covers the one left over by an odd size\n"
+    "    ivec2 below = imageSize(src);\n"
+    "    ivec2 last = mix(2 * p + 1, below - 1, equal(p, size - 1));\n"
+    "    float far = 0.0;\n"
+    "    for (int y = 2 * p.y; y <= last.y; y++)\n"
+    "        for (int x = 2 * p.x; x <= last.x; x++)\n"
+    "            far = max(far, imageLoad(src, ivec2(x, y)).r);\n"
+    "    imageStore(dst, p, vec4(far));\n"
+    "}\n"
+    , GL_COMPUTE_SHADER
+};
+
+// a triangle covering the screen
+static const shader SHADER_SHOW_VERT = {
+    "#version 450\n"
+    "\n"
+    "void main() {\n"
+    "    vec2 p = vec2((gl_VertexID & 1) * 4 - 1, (gl_VertexID & 2) * 2 - 1);\n"
+    "    gl_Position = vec4(p, 0.0, 1.0);\n"
+    "}\n"
+    , GL_VERTEX_SHADER
+};
+
+static const shader SHADER_SHOW_FRAG = {
+    "#version 450\n"
+    "\n"
+    "layout(binding = 0) uniform sampler2D pyramid;\n"
+    "\n"
+    "layout(location = 0) uniform int level;\n"
+    "layout(location = 1) uniform vec2 depth_range; // third row of the projection's last two columns\n"
+    "\n"
+    "out vec4 frag_color;\n"
+    "\n"
+    "void main() {\n"
+    "    ivec2 size = textureSize(pyramid, level);\n"
+    "    ivec2 p = min(ivec2(gl_FragCoord.xy) >> level, size - 1);\n"
+    "    float z = texelFetch(pyramid, p, level).r * 2.0 - 1.0;\n"
+    "\n"
+    "    // distances along the view axis, from the near plane (0) to the far plane (1)\n"
+    "    float a = depth_range.x, b = depth_range.y;\n"
+    "    float near = b / (a - 1.0), far = b / (a + 1.0);\n"
+    "    float d = b / (z + a);\n"
+    "    frag_color = vec4(vec3(clamp(log(d / near) / log(far / near), 0.0, 1.0)), 1.0);\n"
+    "}\n"
+    , GL_FRAGMENT_SHADER
+};
+
+
+/// @brief Link a program from shaders, exiting on failure
+static uint hiz_program(const shader *shaders, const uint n) {
+    const uint program = glCreateProgram();
+    for (uint k = 0; k < n; k++) {
+        uint s;
+        if (!compile_shader(&s, shaders[k])) {
+            error("Failed to compile the depth pyramid's shaders.");
+            exit(EXIT_FAILURE);
+        }
+        glAttachShader(program, s);
+        glDeleteShader(s);
+    }
+    glLinkProgram(program);
+    return program;
+}
+
+void hiz_init(hiz *h, const hiz_mode mode) {
+    memset(h, 0, sizeof(*h));
+    h->mode = mode;
+    h->level = HIZ_SHOW_LEVEL;
+    if (mode == HIZ_OFF)
+        return;
+
+    h->reduce = hiz_program(&SHADER_REDUCE, 1);
+    if (mode == HIZ_SHOW)
+        h->show = hiz_program((const shader[]) {SHADER_SHOW_VERT, SHADER_SHOW_FRAG}, 2);
+    glGenFramebuffers(1, &h->fbo);
+}
+
+/// @brief Depth format of the read framebuffer (a blit only copies depth between buffers of the same format
+/// and number of samples)
+static GLenum hiz_format(const uint fbo) {
+    const GLenum depth = fbo ? GL_DEPTH_ATTACHMENT : GL_DEPTH, stencil = fbo ? GL_STENCIL_ATTACHMENT : GL_STENCIL;
+
+    GLint bits = 0, type = GL_UNSIGNED_NORMALIZED, stencil_bits = 0, attached = GL_NONE;
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depth, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &bits);
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depth, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &type);
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, stencil, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &attached);
+    if (attached != GL_NONE)
+        glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, stencil, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE,
+                                              &stencil_bits);
+
+    if (type == GL_FLOAT)
+        return stencil_bits ? GL_DEPTH32F_STENCIL8 : GL_DEPTH_COMPONENT32F;
+    if (stencil_bits)
+        return GL_DEPTH24_STENCIL8;
+    return bits <= 16 ? GL_DEPTH_COMPONENT16 : bits <= 24 ? GL_DEPTH_COMPONENT24 : GL_DEPTH_COMPONENT32;
+}
+
+/// @brief Make the depth texture and the pyramid for a framebuffer of `width` by `height` (and `format` and
+/// `samples`)
+static void hiz_resize(hiz *h, const uint width, const uint height, const GLenum format, const uint samples) {
+    if (h->depth) {
+        glDeleteTextures(1, &h->depth);
+        glDeleteTextures(1, &h->pyramid);
+    }
+    h->width = width, h->height = height, h->format = format, h->samples = samples;
+
+    // a level per halving of the larger side, down to 1
+    h->levels = 1;
+    while ((width > height ? width : height) >> h->levels)
+        h->levels++;
+    if (h->levels > HIZ_MAX_LEVELS)
+        h->levels = HIZ_MAX_LEVELS;
+
+    glGenTextures(1, &h->depth);
+    if (samples) {
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, h->depth);
+        glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, format, width, height, GL_TRUE);
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+    } else {
+        glBindTexture(GL_TEXTURE_2D, h->depth);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+    }
+
+    glGenTextures(1, &h->pyramid);
+    glBindTexture(GL_TEXTURE_2D, h->pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, h->levels, GL_R32F, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, h->fbo);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8
+                           ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+                           samples ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D, h->depth, 0);
+}
+
+void hiz_build(hiz *h, mat4x4 const clip, const uint width, const uint height) {
+    if (h->mode == HIZ_OFF)
+        return;
+
+    // the frame was drawn into the bound framebuffer (the window's, or the offscreen one)
+    GLint drawn, read, samples;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawn);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read);
+    glGetIntegerv(GL_SAMPLES, &samples);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, drawn);
+
+    const GLenum format = hiz_format(drawn);
+    if (width != h->width || height != h->height || format != h->format || (uint)samples != h->samples)
+        hiz_resize(h, width, height, format, samples);
+
+    // copy the depth (with every sample) into a texture
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, h->fbo);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawn);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read);
+
+    // the first level is a copy of the depth, every other one the farthest depth of the texels below it
+    const GLenum target = samples ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+    glUseProgram(h->reduce);
+    glUniform1i(1, samples);
+    glActiveTexture(GL_TEXTURE0 + (samples ? HIZ_UNIT_SAMPLES : HIZ_UNIT));
+    glBindTexture(target, h->depth);
+    for (uint l = 0; l < h->levels; l++) {
+        const uint w = width >> l ? width >> l : 1, ht = height >> l ? height >> l : 1;
+        glUniform1i(0, !l);
+        if (l)
+            glBindImageTexture(0, h->pyramid, l - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, h->pyramid, l, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((w + HIZ_GROUP - 1) / HIZ_GROUP, (ht + HIZ_GROUP - 1) / HIZ_GROUP, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    glBindTexture(target, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    // the culling pass of the next frame reads the pyramid as a texture
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    mat4x4_dup(h->clip, clip);
+    h->ready = 1;
+}
+
+void hiz_show(const hiz *h, mat4x4 const projection) {
+    if (h->mode != HIZ_SHOW || !h->ready)
+        return;
+
+    glUseProgram(h->show);
+    glUniform1i(0, h->level < h->levels ? h->level : h->levels - 1);
+    glUniform2f(1, projection[2][2], projection[3][2]);
+    glActiveTexture(GL_TEXTURE0 + HIZ_UNIT);
+    glBindTexture(GL_TEXTURE_2D, h->pyramid);
+
+    // drawn over everything, without touching the depth buffer (the bound VAO's attributes go unread)
+    glDisable(GL_DEPTH_TEST);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glEnable(GL_DEPTH_TEST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void hiz_free(hiz *h) {
+    if (h->mode != HIZ_OFF) {
+        glDeleteTextures(1, &h->depth);
+        glDeleteTextures(1, &h->pyramid);
+        glDeleteFramebuffers(1, &h->fbo);
+        glDeleteProgram(h->reduce);
+        glDeleteProgram(h->show);
+    }
+    memset(h, 0, sizeof(*h));
+}
@@ -0,0 +1,1188 @@
+/// Streaming importer of Wavefront OBJ and PLY meshes. The file is mapped and split into chunks, parsed a
+/// wave at a time by a thread of its own and its pool, while the calling thread welds the vertices of
+/// every finished mesh and hands it on, so meshes are uploaded while later chunks are still being parsed.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "fpsdbg.h"
+#include "import.h"
+#include "jobs.h"
+#include "prof.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// most elements in a PLY header, and properties of an element
+#define PLY_ELEMENTS 8
+#define PLY_PROPERTIES 16
+
+// unused vertex, and free slot of the weld's hash map
+#define IMPORT_NONE (~0u)
+
+
+/// @brief Types of PLY properties
+typedef enum PlyType {
+    PLY_NONE, // not a list (as the type of a list's count)
+    PLY_INT8,
+    PLY_UINT8,
+    PLY_INT16,
+    PLY_UINT16,
+    PLY_INT32,
+    PLY_UINT32,
+    PLY_FLOAT32,
+    PLY_FLOAT64,
+    PLY_TYPES
+} ply_type;
+
+static const char *PLY_TYPE_NAMES[PLY_TYPES][2] = {
+    {"", ""}, {"char", "int8"}, {"uchar", "uint8"}, {"short", "int16"}, {"ushort", "uint16"},
+    {"int", "int32"}, {"uint", "uint32"}, {"float", "float32"}, {"double", "float64"}
+};
+static const uint PLY_TYPE_SIZES[PLY_TYPES] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+
+/// @brief What a PLY property holds
+typedef enum PlyRole {
+    PLY_OTHER, // skipped
+    PLY_X,
+    PLY_Y,
+    PLY_Z,
+    PLY_INDICES // the corners of a face
+} ply_role;
+
+/// @brief What a PLY element holds
+typedef enum PlyKind {
+    PLY_SKIP,
+    PLY_VERTICES,
+    PLY_FACES
+} ply_kind;
+
+
+/// @brief Property of a PLY element
+/// @param type type of the value (or of the list's values)
+/// @param count type of the list's count (`PLY_NONE` for a single value)
+/// @param role what the property holds
+typedef struct PlyProperty {
+    ply_type type, count;
+    ply_role role;
+} ply_property;
+
+/// @brief Element of a PLY file, and the layout of its records
+/// @param kind what the element holds
+/// @param count number of records
+/// @param props properties of every record
+/// @param props_len number of properties
+/// @param stride size of a binary record (0 when it holds a list)
+typedef struct PlyElement {
+    ply_kind kind;
+    uint64_t count;
+    ply_property props[PLY_PROPERTIES];
+    uint props_len, stride;
+} ply_element;
+
+
+/// @brief Start of an OBJ object (or group) within a chunk
+/// @param name name of the object
+/// @param corner first corner of the object in the chunk
+typedef struct ImportGroup {
+    char name[MESH_NAME_LEN];
+    uint corner;
+} import_group;
+
+/// @brief Part of the file, and what was parsed out of it (the arrays are kept from one use of the slot to the next)
+/// @param begin first byte
+/// @param end byte after the last
+/// @param element element the chunk's records belong to (`NULL` for OBJ files)
+/// @param records number of records (PLY files)
+/// @param line line the chunk starts at (ASCII PLY files, 0 when unknown)
+/// @param lines number of lines in the chunk
+/// @param positions vertex positions, three floats per vertex
+/// @param corners corners of the triangles, into the vertices of the file
+/// @param relative corners that count from the chunk's first vertex (OBJ's negative indices), each followed by its line within the chunk
+/// @param groups objects starting in the chunk
+/// @param fault what is wrong with the chunk (`NULL` if nothing)
+/// @param fault_line line of the fault within the chunk (0 when unknown)
+typedef struct ImportChunk {
+    const char *begin, *end;
+    const ply_element *element;
+    uint records, line, lines;
+    float *positions;
+    uint positions_len, positions_cap;
+    uint *corners;
+    uint corners_len, corners_cap;
+    uint *relative;
+    uint relative_len, relative_cap;
+    import_group *groups;
+    uint groups_len, groups_cap;
+    const char *fault;
+    uint fault_line;
+} import_chunk;
+
+/// @brief Mesh whose faces refer to vertices further down the file, handed on at the end
+/// @param name name of the mesh
+/// @param corners corners of the triangles
+/// @param len number of corners
+typedef struct ImportPending {
+    char name[MESH_NAME_LEN];
+    uint *corners;
+    uint len;
+} import_pending;
+
+
+/// @brief State of an import, shared by the thread splitting and parsing the file and the one taking the chunks
+/// @param path path to the file
+/// @param map the whole file
+/// @param end byte after the last of the file
+/// @param ply whether the file is a PLY file (an OBJ file otherwise)
+/// @param binary whether the PLY file is binary
+/// @param elements elements of the PLY file
+/// @param elements_len number of elements
+/// @param cursor first byte not split into chunks yet
+/// @param element current element of the PLY file
+/// @param remaining records of the current element not split into chunks yet
+/// @param line lines before the cursor (ASCII PLY files)
+/// @param split_fault what is wrong with the file's layout, found while splitting it (`NULL` if nothing)
+/// @param split_line line of the split fault (0 when unknown)
+/// @param pool threads parsing the chunks
+/// @param producer thread splitting the file and parsing it on the pool
+/// @param lock guards `head`, `tail`, `done` and `stop`
+/// @param ready signalled when chunks were parsed (or the file is done)
+/// @param room signalled when chunks were taken (or the import stops)
+/// @param slots ring of chunks
+/// @param slots_len number of slots
+/// @param wave number of chunks parsed at a time
+/// @param wave_first slot of the first chunk of the wave being parsed
+/// @param head chunks taken so far
+/// @param tail chunks parsed so far
+/// @param done set when the producer is done
+/// @param stop set when the import failed, so the producer stops early
+/// @param fn receives the meshes
+/// @param ctx data passed to `fn`
+/// @param positions positions of every vertex of the file so far
+/// @param positions_len size of positions array
+/// @param positions_cap room in positions array
+/// @param local vertex of the current mesh of every vertex of the file (`IMPORT_NONE` between meshes)
+/// @param corners corners of the current mesh
+/// @param corners_len number of corners
+/// @param corners_cap room for corners
+/// @param corners_max largest vertex the current mesh refers to
+/// @param name name of the current mesh
+/// @param pending meshes handed on at the end
+/// @param pending_len number of pending meshes
+/// @param pending_cap room for pending meshes
+/// @param lines lines taken so far (OBJ files)
+/// @param weld hash map of the welded positions of the mesh being handed on
+/// @param weld_cap number of slots of the hash map
+/// @param vertices welded vertex positions of the mesh being handed on
+/// @param vertices_cap room for welded vertices
+/// @param indices indices of the mesh being handed on
+/// @param indices_cap room for indices
+/// @param fault what is wrong with the file (`NULL` if nothing)
+/// @param fault_line line of the fault (0 when unknown)
+/// @param stats what was read
+typedef struct Importer {
+    const char *path;
+    const char *map, *end;
+    int ply, binary;
+    ply_element elements[PLY_ELEMENTS];
+    uint elements_len;
+
+    const char *cursor;
+    uint element;
+    uint64_t remaining;
+    uint line;
+    const char *split_fault;
+    uint split_line;
+
+    job_pool pool;
+    pthread_t producer;
+    pthread_mutex_t lock;
+    pthread_cond_t ready, room;
+    import_chunk *slots;
+    uint slots_len, wave, wave_first;
+    uint head, tail;
+    int done, stop;
+
+    import_fn fn;
+    void *ctx;
+    float *positions;
+    uint positions_len, positions_cap;
+    uint *local;
+    uint *corners;
+    uint corners_len, corners_cap, corners_max;
+    char name[MESH_NAME_LEN];
+    import_pending *pending;
+    uint pending_len, pending_cap;
+    uint lines;
+
+    uint *weld;
+    uint weld_cap;
+    float *vertices;
+    uint vertices_cap;
+    uint *indices;
+    uint indices_cap;
+
+    const char *fault;
+    uint fault_line;
+    import_stats stats;
+} importer;
+
+
+static const double POW10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/// @brief Make room for `need` elements in a growing array
+static void *import_grow(void *p, uint *cap, const uint64_t need, const size_t size) {
+    if (need <= *cap)
+        return p;
+    if (need > 0xFFFFFFFFull) {
+        error("Imported file is too large.");
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t c = *cap ? *cap : 1024;
+    while (c < need)
+        c *= 2;
+    if (c > 0xFFFFFFFFull)
+        c = 0xFFFFFFFFull;
+    p = realloc(p, c * size);
+    if (!p) {
+        error("Failed to grow the contents of an imported file.");
+        exit(EXIT_FAILURE);
+    }
+    *cap = c;
+    return p;
+}
+
+static inline int is_digit(const char c) {
+    return (unsigned)(c - '0') < 10;
+}
+
+static inline const char *skip_space(const char *p, const char *e) {
+    while (p < e && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+static inline const char *skip_token(const char *p, const char *e) {
+    while (p < e && !isspace((unsigned char)*p))
+        p++;
+    return p;
+}
+
+/// @brief Parse a float with `strtof`, out of a copy of the token (the file isn't terminated)
+static const char *parse_float_slow(const char *p, const char *e, float *out) {
+    char buf[64];
+    size_t len = skip_token(p, e) - p;
+    if (len >= sizeof(buf))
+        len = sizeof(buf) - 1;
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+
+    char *end;
+    *out = strtof(buf, &end);
+    return end == buf ? NULL : p + (end - buf);
+}
+
+/// @brief Parse a decimal float: the digits into an integer, then a single multiplication or division by a
+/// power of ten (exact up to 1e22), falling back to `strtof` for anything else
+/// @return the byte after the number, or `NULL` if there's none
+static const char *parse_float(const char *p, const char *e, float *out) {
+    const char *s = p;
+    const int neg = p < e && *p == '-';
+    if (p < e && (*p == '-' || *p == '+'))
+        p++;
+
+    // at most 19 significant digits (past those, the integer part only scales the number)
+    uint64_t mant = 0;
+    int digits = 0, exp = 0, any = 0;
+    for (; p < e && is_digit(*p); p++, any = 1)
+        if (digits < 19) {
+            mant = mant * 10 + (*p - '0');
+            digits += mant != 0;
+        } else
+            exp++;
+    if (p < e && *p == '.')
+        for (p++; p < e && is_digit(*p); p++, any = 1)
+            if (digits < 19) {
+                mant = mant * 10 + (*p - '0');
+                digits += mant != 0;
+                exp--;
+            }
+    if (!any)
+        return parse_float_slow(s, e, out);
+
+    if (p < e && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int eneg = 0, ev = 0, edigits = 0;
+        if (q < e && (*q == '-' || *q == '+'))
+            eneg = *q++ == '-';
+        for (; q < e && is_digit(*q); q++, edigits++)
+            if (ev < 10000)
+                ev = ev * 10 + (*q - '0');
+        if (edigits) {
+            exp += eneg ? -ev : ev;
+            p = q;
+        }
+    }
+
+    if (mant && (exp < -22 || exp > 22))
+        return parse_float_slow(s, e, out);
+    const double v = !mant ? 0.0 : exp < 0 ? (double)mant / POW10[-exp] : (double)mant * POW10[exp];
+    *out = neg ? -v : v;
+    return p;
+}
+
+/// @brief Parse a decimal integer
+/// @return the byte after the number, or `NULL` if there's none
+static const char *parse_int(const char *p, const char *e, int64_t *out) {
+    const int neg = p < e && *p == '-';
+    if (p < e && (*p == '-' || *p == '+'))
+        p++;
+    if (p == e || !is_digit(*p))
+        return NULL;
+
+    // large enough for any index, without overflowing
+    int64_t v = 0;
+    for (; p < e && is_digit(*p); p++)
+        if (v < 1000000000000ll)
+            v = v * 10 + (*p - '0');
+    *out = neg ? -v : v;
+    return p;
+}
+
+/// @brief Value of a binary PLY property (little-endian, as is the CPU)
+static inline double ply_value(const char *p, const ply_type t) {
+    switch (t) {
+        case PLY_INT8:
+            return (int8_t)*p;
+        case PLY_UINT8:
+            return (uint8_t)*p;
+        case PLY_INT16: {
+            int16_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case PLY_UINT16: {
+            uint16_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case PLY_INT32: {
+            int32_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case PLY_UINT32: {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case PLY_FLOAT32: {
+            float v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        case PLY_FLOAT64: {
+            double v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        default:
+            return 0.0;
+    }
+}
+
+/// @brief Add a corner to a chunk
+/// @param rel whether the corner counts from the chunk's first vertex
+static inline void chunk_corner(import_chunk *c, const uint v, const int rel) {
+    if (c->corners_len == c->corners_cap)
+        c->corners = import_grow(c->corners, &c->corners_cap, c->corners_len + 1, sizeof(uint));
+    if (rel) {
+        if (c->relative_len + 2 > c->relative_cap)
+            c->relative = import_grow(c->relative, &c->relative_cap, c->relative_len + 2, sizeof(uint));
+        c->relative[c->relative_len++] = c->corners_len;
+        c->relative[c->relative_len++] = c->fault_line;
+    }
+    c->corners[c->corners_len++] = v;
+}
+
+/// @brief Add a position to a chunk
+static inline float *chunk_position(import_chunk *c) {
+    if (c->positions_len + 3 > c->positions_cap)
+        c->positions = import_grow(c->positions, &c->positions_cap, c->positions_len + 3, sizeof(float));
+    c->positions_len += 3;
+    return c->positions + c->positions_len - 3;
+}
+
+/// @brief Name of an object, from the rest of its line
+static void obj_name(char *name, const char *p, const char *e) {
+    p = skip_space(p, e);
+    while (e > p && isspace((unsigned char)e[-1]))
+        e--;
+    if (p == e)
+        p = "mesh", e = p + 4;
+    const size_t len = e - p < MESH_NAME_LEN ? (size_t)(e - p) : MESH_NAME_LEN - 1;
+    memcpy(name, p, len);
+    name[len] = '\0';
+}
+
+/// @brief Parse a chunk of an OBJ file: positions, faces (split into fans), and the objects they belong to
+static void parse_obj(import_chunk *c) {
+    const char *p = c->begin, *e = c->end;
+    uint vertices = 0;
+    for (uint line = 1; p < e && !c->fault; line++) {
+        const char *eol = memchr(p, '\n', e - p);
+        if (!eol)
+            eol = e;
+        c->lines = line;
+        c->fault_line = line;
+        p = skip_space(p, eol);
+
+        if (eol - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            // a position (a fourth, weight coordinate is skipped)
+            float *pos = chunk_position(c);
+            p++;
+            for (uint l = 0; l < 3 && p; l++)
+                p = parse_float(skip_space(p, eol), eol, &pos[l]);
+            if (!p)
+                c->fault = "invalid vertex";
+            vertices++;
+        } else if (eol - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            // corners are `v`, `v/vt`, `v//vn` or `v/vt/vn`, counted from 1, or back from the last vertex when negative
+            uint n = 0, first = 0, prev = 0;
+            int first_rel = 0, prev_rel = 0;
+            for (p++;;) {
+                p = skip_space(p, eol);
+                if (p == eol || *p == '#')
+                    break;
+
+                int64_t i;
+                const char *q = parse_int(p, eol, &i);
+                const int64_t from = (int64_t)vertices + i;
+                if (!q || !i || i > 0xFFFFFFFFll || (i < 0 && from < INT32_MIN)) {
+                    c->fault = "invalid face";
+                    break;
+                }
+                const int rel = i < 0;
+                const uint v = rel ? (uint)(int32_t)from : (uint)(i - 1);
+
+                // the texture coordinate and normal
+                p = skip_token(q, eol);
+
+                // polygons are split into fans around their first corner
+                if (n >= 2) {
+                    chunk_corner(c, first, first_rel);
+                    chunk_corner(c, prev, prev_rel);
+                    chunk_corner(c, v, rel);
+                }
+                if (!n)
+                    first = v, first_rel = rel;
+                prev = v, prev_rel = rel;
+                n++;
+            }
+            if (!c->fault && n < 3)
+                c->fault = "face with fewer than three corners";
+        } else if (eol - p >= 1 && (p[0] == 'o' || p[0] == 'g') && (eol - p == 1 || isspace((unsigned char)p[1]))) {
+            // a new object, named after the rest of the line
+            c->groups = import_grow(c->groups, &c->groups_cap, c->groups_len + 1, sizeof(import_group));
+            import_group *g = &c->groups[c->groups_len++];
+            obj_name(g->name, p + 1, eol);
+            g->corner = c->corners_len;
+        }
+        p = eol < e ? eol + 1 : e;
+    }
+}
+
+/// @brief Parse a chunk of the records of an ASCII PLY element, a line each
+static void parse_ply_ascii(import_chunk *c) {
+    const ply_element *el = c->element;
+    const char *p = c->begin, *e = c->end;
+    for (uint r = 0; r < c->records && !c->fault; r++) {
+        const char *eol = memchr(p, '\n', e - p);
+        if (!eol)
+            eol = e;
+        c->lines = c->fault_line = r + 1;
+
+        float pos[3] = {0.0f, 0.0f, 0.0f};
+        for (uint k = 0; k < el->props_len && p; k++) {
+            const ply_property *prop = &el->props[k];
+            if (prop->count == PLY_NONE) {
+                p = skip_space(p, eol);
+                if (prop->role >= PLY_X && prop->role <= PLY_Z)
+                    p = parse_float(p, eol, &pos[prop->role - PLY_X]);
+                else
+                    p = p < eol ? skip_token(p, eol) : NULL;
+                continue;
+            }
+
+            int64_t n;
+            p = parse_int(skip_space(p, eol), eol, &n);
+            if (!p || n < 0) {
+                p = NULL;
+                break;
+            }
+            if (prop->role == PLY_INDICES && n < 3) {
+                c->fault = "face with fewer than three corners";
+                break;
+            }
+            uint first = 0, prev = 0;
+            for (int64_t i = 0; i < n && p; i++) {
+                p = skip_space(p, eol);
+                if (prop->role != PLY_INDICES) {
+                    p = p < eol ? skip_token(p, eol) : NULL;
+                    continue;
+                }
+
+                int64_t v;
+                if (!(p = parse_int(p, eol, &v)))
+                    break;
+                if (v < 0 || v > 0xFFFFFFFEll) {
+                    c->fault = "invalid face";
+                    break;
+                }
+                if (i >= 2) {
+                    chunk_corner(c, first, 0);
+                    chunk_corner(c, prev, 0);
+                    chunk_corner(c, v, 0);
+                }
+                if (!i)
+                    first = v;
+                prev = v;
+            }
+        }
+        if (!c->fault && !p)
+            c->fault = "invalid record";
+        if (!c->fault && el->kind == PLY_VERTICES)
+            memcpy(chunk_position(c), pos, sizeof(pos));
+        p = eol < e ? eol + 1 : e;
+    }
+}
+
+/// @brief Parse a chunk of the records of a binary PLY element
+static void parse_ply_binary(import_chunk *c) {
+    const ply_element *el = c->element;
+    const char *p = c->begin;
+    for (uint r = 0; r < c->records && !c->fault; r++) {
+        float pos[3] = {0.0f, 0.0f, 0.0f};
+        for (uint k = 0; k < el->props_len; k++) {
+            const ply_property *prop = &el->props[k];
+            const uint size = PLY_TYPE_SIZES[prop->type];
+            if (prop->count == PLY_NONE) {
+                if (prop->role >= PLY_X && prop->role <= PLY_Z)
+                    pos[prop->role - PLY_X] = ply_value(p, prop->type);
+                p += size;
+                continue;
+            }
+
+            // the lengths were checked while splitting the file
+            const uint64_t n = ply_value(p, prop->count);
+            p += PLY_TYPE_SIZES[prop->count];
+            if (prop->role != PLY_INDICES) {
+                p += n * size;
+                continue;
+            }
+            if (n < 3) {
+                c->fault = "face with fewer than three corners";
+                break;
+            }
+            uint first = 0, prev = 0;
+            for (uint64_t i = 0; i < n; i++, p += size) {
+                const double d = ply_value(p, prop->type);
+                if (d < 0.0 || d > 4294967294.0) {
+                    c->fault = "invalid face";
+                    break;
+                }
+                const uint v = d;
+                if (i >= 2) {
+                    chunk_corner(c, first, 0);
+                    chunk_corner(c, prev, 0);
+                    chunk_corner(c, v, 0);
+                }
+                if (!i)
+                    first = v;
+                prev = v;
+            }
+            if (c->fault)
+                break;
+        }
+        if (!c->fault && el->kind == PLY_VERTICES)
+            memcpy(chunk_position(c), pos, sizeof(pos));
+    }
+}
+
+/// @brief Parse the chunks of the current wave (on the pool)
+static void import_parse(void *ctx, const uint first, const uint count) {
+    importer *im = ctx;
+    for (uint i = first; i < first + count; i++) {
+        import_chunk *c = &im->slots[(im->wave_first + i) % im->slots_len];
+        if (!c->element)
+            parse_obj(c);
+        else if (im->binary)
+            parse_ply_binary(c);
+        else
+            parse_ply_ascii(c);
+        if (!c->fault)
+            c->fault_line = 0;
+    }
+}
+
+/// @brief Move the cursor over the records of the current PLY element, up to a number of records or bytes
+/// @return the number of records moved over (0, with `split_fault` set, when the file ends first)
+static uint64_t ply_advance(importer *im, const ply_element *el, const uint64_t max, const size_t bytes) {
+    const char *start = im->cursor, *p = start, *e = im->end;
+    uint64_t r = 0;
+    if (!im->binary)
+        for (; r < max && (size_t)(p - start) < bytes; r++) {
+            if (p >= e) {
+                im->split_fault = "file ends before its last record";
+                return 0;
+            }
+            const char *eol = memchr(p, '\n', e - p);
+            p = eol ? eol + 1 : e;
+            im->line++;
+        }
+    else if (el->stride) {
+        r = bytes / el->stride ? bytes / el->stride : 1;
+        if (r > max)
+            r = max;
+        if ((uint64_t)(e - p) / el->stride < r) {
+            im->split_fault = "file ends before its last record";
+            return 0;
+        }
+        p += r * el->stride;
+    } else
+        // records with lists are walked one at a time
+        for (; r < max && (size_t)(p - start) < bytes; r++)
+            for (uint k = 0; k < el->props_len; k++) {
+                const ply_property *prop = &el->props[k];
+                uint64_t len = PLY_TYPE_SIZES[prop->type];
+                if (prop->count != PLY_NONE) {
+                    if (e - p < PLY_TYPE_SIZES[prop->count]) {
+                        im->split_fault = "file ends before its last record";
+                        return 0;
+                    }
+                    const double n = ply_value(p, prop->count);
+                    if (n < 0.0) {
+                        im->split_fault = "list of a negative length";
+                        return 0;
+                    }
+                    p += PLY_TYPE_SIZES[prop->count];
+                    len *= (uint64_t)n;
+                }
+                if ((uint64_t)(e - p) < len) {
+                    im->split_fault = "file ends before its last record";
+                    return 0;
+                }
+                p += len;
+            }
+
+    im->cursor = p;
+    im->remaining -= r;
+    return r;
+}
+
+/// @brief Describe the next chunk of the file (on the producer)
+/// @return 0 once the whole file was split (or at fault)
+static int import_split(importer *im, import_chunk *c) {
+    c->element = NULL;
+    c->records = c->line = c->lines = 0;
+    c->positions_len = c->corners_len = c->relative_len = c->groups_len = 0;
+    c->fault = NULL;
+    c->fault_line = 0;
+
+    if (!im->ply) {
+        // a chunk's worth of bytes, up to the end of the line
+        if (im->cursor >= im->end)
+            return 0;
+        const size_t left = im->end - im->cursor;
+        const char *e = left > IMPORT_CHUNK ? memchr(im->cursor + IMPORT_CHUNK, '\n', left - IMPORT_CHUNK) : NULL;
+        c->begin = im->cursor;
+        c->end = im->cursor = e ? e + 1 : im->end;
+        return 1;
+    }
+
+    // elements without geometry are skipped whole
+    for (;;) {
+        if (im->element == im->elements_len)
+            return 0;
+        const ply_element *el = &im->elements[im->element];
+        if (!im->remaining) {
+            if (++im->element < im->elements_len)
+                im->remaining = im->elements[im->element].count;
+            continue;
+        }
+        if (el->kind != PLY_SKIP)
+            break;
+        if (!ply_advance(im, el, im->remaining, (size_t) -1))
+            return 0;
+    }
+
+    const ply_element *el = &im->elements[im->element];
+    c->begin = im->cursor;
+    c->element = el;
+    c->line = im->binary ? 0 : im->line + 1;
+    c->records = ply_advance(im, el, im->remaining, IMPORT_CHUNK);
+    c->end = im->cursor;
+    return c->records != 0;
+}
+
+/// @brief Producer: split the file into waves of chunks, and parse every wave on the pool
+static void *import_produce(void *arg) {
+    importer *im = arg;
+    uint tail = 0;
+    for (;;) {
+        // the slots of the wave must all have been taken
+        pthread_mutex_lock(&im->lock);
+        while (!im->stop && tail + im->wave - im->head > im->slots_len)
+            pthread_cond_wait(&im->room, &im->lock);
+        const int stop = im->stop;
+        pthread_mutex_unlock(&im->lock);
+        if (stop)
+            break;
+
+        uint k = 0;
+        while (k < im->wave && import_split(im, &im->slots[(tail + k) % im->slots_len]))
+            k++;
+        im->wave_first = tail % im->slots_len;
+        jobs_run(&im->pool, import_parse, im, k, 1);
+
+        pthread_mutex_lock(&im->lock);
+        im->tail = tail += k;
+        pthread_cond_signal(&im->ready);
+        pthread_mutex_unlock(&im->lock);
+        if (k < im->wave)
+            break;
+    }
+
+    pthread_mutex_lock(&im->lock);
+    im->done = 1;
+    pthread_cond_signal(&im->ready);
+    pthread_mutex_unlock(&im->lock);
+    return NULL;
+}
+
+static inline uint weld_hash(const uint32_t *bits) {
+    const uint h = bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u;
+    return h ^ h >> 16;
+}
+
+/// @brief Weld the vertices of a mesh and hand it on: its vertices are numbered in the order the corners
+/// first use them, and vertices at the very same position (as in files that repeat them) become one
+static void import_emit(importer *im, const char *name, const uint *corners, const uint m) {
+    const uint bound = m < im->positions_len / 3 ? m : im->positions_len / 3;
+    im->vertices = import_grow(im->vertices, &im->vertices_cap, 3ull * bound, sizeof(float));
+    im->indices = import_grow(im->indices, &im->indices_cap, m, sizeof(uint));
+
+    // open addressing, at most half full
+    uint cap = 16;
+    while (cap < 2 * bound)
+        cap *= 2;
+    if (cap > im->weld_cap) {
+        free(im->weld);
+        im->weld = malloc(cap * sizeof(uint));
+        if (!im->weld) {
+            error("Failed to allocate the weld of an imported mesh.");
+            exit(EXIT_FAILURE);
+        }
+        im->weld_cap = cap;
+    }
+    memset(im->weld, 0xFF, cap * sizeof(uint));
+
+    uint n = 0;
+    for (uint i = 0; i < m; i++) {
+        const uint v = corners[i];
+        if (im->local[v] == IMPORT_NONE) {
+            // -0 and 0 weld together
+            float pos[3];
+            uint32_t bits[3];
+            for (uint l = 0; l < 3; l++)
+                pos[l] = im->positions[3 * v + l] + 0.0f;
+            memcpy(bits, pos, sizeof(bits));
+
+            uint h = weld_hash(bits) & (cap - 1);
+            while (im->weld[h] != IMPORT_NONE && memcmp(im->vertices + 3 * im->weld[h], pos, sizeof(pos)))
+                h = (h + 1) & (cap - 1);
+            if (im->weld[h] == IMPORT_NONE) {
+                memcpy(im->vertices + 3 * n, pos, sizeof(pos));
+                im->weld[h] = n++;
+            }
+            im->local[v] = im->weld[h];
+        }
+        im->indices[i] = im->local[v];
+    }
+    for (uint i = 0; i < m; i++)
+        im->local[corners[i]] = IMPORT_NONE;
+
+    im->fn(im->ctx, name, 3 * n, m, im->vertices, im->indices);
+    im->stats.meshes++;
+    im->stats.vertices += n;
+    im->stats.triangles += m / 3;
+}
+
+/// @brief Close the current mesh: hand it on, or keep it for the end when it refers to vertices not read yet
+static void import_close(importer *im) {
+    if (!im->corners_len)
+        return;
+
+    if (im->corners_max < im->positions_len / 3)
+        import_emit(im, im->name, im->corners, im->corners_len);
+    else {
+        im->pending = import_grow(im->pending, &im->pending_cap, im->pending_len + 1, sizeof(import_pending));
+        import_pending *pm = &im->pending[im->pending_len++];
+        memcpy(pm->name, im->name, MESH_NAME_LEN);
+        pm->corners = malloc(im->corners_len * sizeof(uint));
+        if (!pm->corners) {
+            error("Failed to allocate an imported mesh.");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(pm->corners, im->corners, im->corners_len * sizeof(uint));
+        pm->len = im->corners_len;
+    }
+    im->corners_len = im->corners_max = 0;
+}
+
+/// @brief Take a parsed chunk (on the calling thread): append its vertices, and its corners to the meshes
+static void import_take(importer *im, import_chunk *c) {
+    const uint line = im->ply ? c->line : im->lines + 1;
+    im->lines += c->lines;
+    if (c->fault) {
+        im->fault = c->fault;
+        im->fault_line = line && c->fault_line ? line + c->fault_line - 1 : 0;
+        return;
+    }
+
+    // the vertices, none of them used by a mesh yet
+    const uint base = im->positions_len / 3;
+    const uint64_t len = (uint64_t)im->positions_len + c->positions_len;
+    if (len > im->positions_cap) {
+        const uint old = im->positions_cap / 3;
+        im->positions = import_grow(im->positions, &im->positions_cap, len, sizeof(float));
+        im->positions_cap -= im->positions_cap % 3;
+        im->local = realloc(im->local, im->positions_cap / 3 * sizeof(uint));
+        if (!im->local) {
+            error("Failed to grow the contents of an imported file.");
+            exit(EXIT_FAILURE);
+        }
+        memset(im->local + old, 0xFF, (im->positions_cap / 3 - old) * sizeof(uint));
+    }
+    if (c->positions_len)
+        memcpy(im->positions + im->positions_len, c->positions, c->positions_len * sizeof(float));
+    im->positions_len = len;
+
+    // negative OBJ indices, once the vertices before the chunk are known
+    for (uint r = 0; r < c->relative_len; r += 2) {
+        const int64_t v = (int64_t)base + (int32_t)c->corners[c->relative[r]];
+        if (v < 0) {
+            im->fault = "face refers to a missing vertex";
+            im->fault_line = line + c->relative[r + 1] - 1;
+            return;
+        }
+        c->corners[c->relative[r]] = v;
+    }
+
+    // the corners up to each object's start go to the previous object
+    im->corners = import_grow(im->corners, &im->corners_cap, (uint64_t)im->corners_len + c->corners_len, sizeof(uint));
+    uint from = 0;
+    for (uint g = 0; g <= c->groups_len; g++) {
+        const uint to = g < c->groups_len ? c->groups[g].corner : c->corners_len;
+        for (uint k = from; k < to; k++) {
+            const uint v = c->corners[k];
+            im->corners[im->corners_len++] = v;
+            if (v > im->corners_max)
+                im->corners_max = v;
+        }
+        if (g < c->groups_len) {
+            import_close(im);
+            memcpy(im->name, c->groups[g].name, MESH_NAME_LEN);
+        }
+        from = to;
+    }
+}
+
+/// @brief Read the header of a PLY file, up to the first record
+/// @return what is wrong with the header, or `NULL`
+static const char *ply_header(importer *im) {
+    const char *p = im->map, *e = im->end;
+    for (im->line = 1;; im->line++) {
+        if (p >= e)
+            return "header without `end_header`";
+        const char *eol = memchr(p, '\n', e - p);
+        if (!eol)
+            eol = e;
+
+        // header lines are short, and easier to read terminated
+        char buf[256], a[32], b[32], c[32];
+        size_t len = eol - p;
+        if (len >= sizeof(buf))
+            len = sizeof(buf) - 1;
+        memcpy(buf, p, len);
+        while (len && isspace((unsigned char)buf[len - 1]))
+            len--;
+        buf[len] = '\0';
+        p = eol < e ? eol + 1 : e;
+
+        unsigned long long count;
+        if (im->line == 1) {
+            if (strcmp(buf, "ply"))
+                return "not a PLY file";
+        } else if (!strncmp(buf, "comment", 7) || !strncmp(buf, "obj_info", 8))
+            continue;
+        else if (sscanf(buf, "format %31s %31s", a, b) == 2) {
+            if (!strcmp(a, "ascii"))
+                im->binary = 0;
+            else if (!strcmp(a, "binary_little_endian"))
+                im->binary = 1;
+            else
+                return "unsupported format";
+        } else if (sscanf(buf, "element %31s %llu", a, &count) == 2) {
+            if (im->elements_len == PLY_ELEMENTS)
+                return "too many elements";
+            ply_element *el = &im->elements[im->elements_len++];
+            memset(el, 0, sizeof(*el));
+            el->count = count;
+            el->kind = !strcmp(a, "vertex") ? PLY_VERTICES : !strcmp(a, "face") ? PLY_FACES : PLY_SKIP;
+        } else if (!strncmp(buf, "property", 8)) {
+            if (!im->elements_len)
+                return "property outside of an element";
+            ply_element *el = &im->elements[im->elements_len - 1];
+            if (el->props_len == PLY_PROPERTIES)
+                return "too many properties";
+            ply_property *prop = &el->props[el->props_len++];
+            memset(prop, 0, sizeof(*prop));
+
+            const char *type = a, *name = b;
+            const char *count_type = NULL;
+            if (sscanf(buf, "property list %31s %31s %31s", a, b, c) == 3)
+                count_type = a, type = b, name = c;
+            else if (sscanf(buf, "property %31s %31s", a, b) != 2)
+                return "invalid property";
+            for (uint t = 1; t < PLY_TYPES; t++) {
+                if (!strcmp(type, PLY_TYPE_NAMES[t][0]) || !strcmp(type, PLY_TYPE_NAMES[t][1]))
+                    prop->type = t;
+                if (count_type && (!strcmp(count_type, PLY_TYPE_NAMES[t][0]) || !strcmp(count_type, PLY_TYPE_NAMES[t][1])))
+                    prop->count = t;
+            }
+            if (!prop->type || (count_type && !prop->count))
+                return "unknown property type";
+
+            if (el->kind == PLY_VERTICES && !count_type && strlen(name) == 1 && name[0] >= 'x' && name[0] <= 'z')
+                prop->role = PLY_X + (name[0] - 'x');
+            else if (el->kind == PLY_FACES && count_type && (!strcmp(name, "vertex_indices") || !strcmp(name, "vertex_index")))
+                prop->role = PLY_INDICES;
+        } else if (!strcmp(buf, "end_header"))
+            break;
+        else
+            return "invalid header";
+    }
+    im->cursor = p;
+
+    // what is needed of the vertices and faces, and the size of fixed records
+    for (uint i = 0; i < im->elements_len; i++) {
+        ply_element *el = &im->elements[i];
+        uint roles = 0, lists = 0;
+        for (uint k = 0; k < el->props_len; k++) {
+            roles |= 1u << el->props[k].role;
+            lists += el->props[k].count != PLY_NONE;
+            el->stride += PLY_TYPE_SIZES[el->props[k].type];
+        }
+        if (lists || !im->binary)
+            el->stride = 0;
+        if (el->kind == PLY_VERTICES && (roles & 0xE) != 0xE)
+            return "vertices without x, y and z";
+        if (el->kind == PLY_FACES && !(roles & 1u << PLY_INDICES))
+            return "faces without vertex indices";
+        if (im->binary && !el->props_len && el->count)
+            return "records without properties";
+    }
+    im->remaining = im->elements_len ? im->elements[0].count : 0;
+    return NULL;
+}
+
+int import_supports(const char *path) {
+    const char *dot = strrchr(path, '.');
+    return dot && (!strcasecmp(dot, ".obj") || !strcasecmp(dot, ".ply"));
+}
+
+int import_file(const char *path, const uint threads, import_fn fn, void *ctx, import_stats *stats) {
+    const uint64_t start = prof_now();
+    const int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st)) {
+        fprintf(stderr, "Error: can't read '%s'\n", path);
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+
+    // the file is read once, front to back, by the threads parsing it
+    static importer zero;
+    importer *im = malloc(sizeof(importer));
+    if (!im) {
+        error("Failed to allocate the importer.");
+        exit(EXIT_FAILURE);
+    }
+    *im = zero;
+    im->path = path;
+    im->fn = fn;
+    im->ctx = ctx;
+    im->stats.bytes = st.st_size;
+    memcpy(im->name, "mesh", 5);
+
+    void *map = st.st_size ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: can't map '%s'\n", path);
+        free(im);
+        return 0;
+    }
+    if (map) {
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        madvise(map, st.st_size, MADV_WILLNEED);
+    }
+    im->map = im->cursor = map;
+    im->end = im->map + st.st_size;
+
+    // PLY files say so on their first line
+    im->ply = st.st_size >= 4 && !memcmp(im->map, "ply", 3) && (im->map[3] == '\n' || im->map[3] == '\r');
+    if (im->ply && (im->fault = ply_header(im)))
+        im->fault_line = im->line;
+
+    if (!im->fault) {
+        jobs_init(&im->pool, threads);
+        im->wave = IMPORT_WAVE * (im->pool.threads_len + 1);
+        im->slots_len = 2 * im->wave;
+        im->slots = calloc(im->slots_len, sizeof(import_chunk));
+        if (!im->slots) {
+            error("Failed to allocate the chunks of an import.");
+            exit(EXIT_FAILURE);
+        }
+        pthread_mutex_init(&im->lock, NULL);
+        pthread_cond_init(&im->ready, NULL);
+        pthread_cond_init(&im->room, NULL);
+        if (pthread_create(&im->producer, NULL, import_produce, im)) {
+            error("Failed to start the importer's thread.");
+            exit(EXIT_FAILURE);
+        }
+
+        // take the chunks in order, as they're parsed (after a fault, only to let the producer finish)
+        for (;;) {
+            pthread_mutex_lock(&im->lock);
+            while (im->head == im->tail && !im->done)
+                pthread_cond_wait(&im->ready, &im->lock);
+            const int empty = im->head == im->tail;
+            pthread_mutex_unlock(&im->lock);
+            if (empty)
+                break;
+
+            if (!im->fault)
+                import_take(im, &im->slots[im->head % im->slots_len]);
+
+            pthread_mutex_lock(&im->lock);
+            im->head++;
+            im->stop |= im->fault != NULL;
+            pthread_cond_signal(&im->room);
+            pthread_mutex_unlock(&im->lock);
+        }
+        pthread_join(im->producer, NULL);
+        jobs_free(&im->pool);
+
+        if (!im->fault && im->split_fault)
+            im->fault = im->split_fault, im->fault_line = im->split_line;
+        if (!im->fault)
+            import_close(im);
+
+        // meshes that referred to vertices further down the file
+        for (uint i = 0; i < im->pending_len; i++) {
+            const import_pending *pm = &im->pending[i];
+            for (uint k = 0; k < pm->len && !im->fault; k++)
+                if (pm->corners[k] >= im->positions_len / 3) {
+                    im->fault = "face refers to a missing vertex";
+                    im->fault_line = 0;
+                }
+            if (!im->fault)
+                import_emit(im, pm->name, pm->corners, pm->len);
+            free(pm->corners);
+        }
+
+        for (uint i = 0; i < im->slots_len; i++) {
+            free(im->slots[i].positions);
+            free(im->slots[i].corners);
+            free(im->slots[i].relative);
+            free(im->slots[i].groups);
+        }
+        free(im->slots);
+        pthread_mutex_destroy(&im->lock);
+        pthread_cond_destroy(&im->ready);
+        pthread_cond_destroy(&im->room);
+    }
+
+    if (im->fault && im->fault_line)
+        fprintf(stderr, "Error: %s:%u: %s\n", path, im->fault_line, im->fault);
+    else if (im->fault)
+        fprintf(stderr, "Error: %s: %s\n", path, im->fault);
+
+    im->stats.vertices_read = im->positions_len / 3;
+    im->stats.ms = (prof_now() - start) / 1e6;
+    im->stats.mb_s = im->stats.ms > 0.0 ? im->stats.bytes / im->stats.ms / 1e3 : 0.0;
+    im->stats.triangles_s = im->stats.ms > 0.0 ? im->stats.triangles / im->stats.ms * 1e3 : 0.0;
+    if (stats)
+        *stats = im->stats;
+
+    const int ok = !im->fault;
+    if (map)
+        munmap(map, st.st_size);
+    free(im->positions);
+    free(im->local);
+    free(im->corners);
+    free(im->pending);
+    free(im->weld);
+    free(im->vertices);
+    free(im->indices);
+    free(im);
+    return ok;
+}
+
+
+/// @brief World the imported meshes go into
+/// @param wd world pointer
+/// @param program program used by every object
+/// @param info information on the imported scene
+typedef struct ImportWorld {
+    world *wd;
+    uint program;
+    scene_info *info;
+} import_world;
+
+/// @brief Upload a mesh as it is handed on, as an object of its own
+static void import_object(void *ctx, const char *name, const uint n, const uint m, const float *vertices,
+                          const uint *indices) {
+    import_world *iw = ctx;
+    create_object(iw->wd, iw->program, n, m, vertices, indices, GL_STATIC_DRAW, GL_TRIANGLES);
+
+    const mesh *msh = &iw->wd->meshes.meshes[iw->wd->meshes.len - 1];
+    const float r = vec3_len(msh->sphere) + msh->sphere[3];
+    iw->info->triangles += m / 3;
+    if (r > iw->info->radius)
+        iw->info->radius = r;
+}
+
+int import_load(world *wd, const uint program, const char *path, const uint threads, scene_info *info,
+                import_stats *stats) {
+    memset(info, 0, sizeof(*info));
+    import_world iw = {wd, program, info};
+    return import_file(path, threads, import_object, &iw, stats);
+}
+
+void import_report(const import_stats *st, const char *path, FILE *out) {
+    fprintf(out, "import %s | %.1f MB in %.1f ms, %.1f MB/s | %lu triangles, %.2f M/s | %u meshes, %lu of %lu vertices once welded\n",
+            path, st->bytes / 1e6, st->ms, st->mb_s, (unsigned long)st->triangles, st->triangles_s / 1e6,
+            st->meshes, (unsigned long)st->vertices, (unsigned long)st->vertices_read);
+}
@@ -0,0 +1,112 @@
+/// Pool of worker threads that split loops over large arrays between the cores.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "jobs.h"
+#include <string.h>
+#include <unistd.h>
+
+
+/// @brief Take ranges of the current loop until none is left
+static void jobs_work(job_pool *p) {
+    uint first;
+    while ((first = atomic_fetch_add(&p->next, p->grain)) < p->len)
+        p->fn(p->ctx, first, p->len - first < p->grain ? p->len - first : p->grain);
+}
+
+/// @brief Worker thread: wait for a loop, work on it, repeat
+static void *jobs_worker(void *arg) {
+    job_pool *p = arg;
+    uint seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&p->lock);
+        while (p->generation == seen && !p->quit)
+            pthread_cond_wait(&p->start, &p->lock);
+        if (p->quit) {
+            pthread_mutex_unlock(&p->lock);
+            return NULL;
+        }
+        seen = p->generation;
+        pthread_mutex_unlock(&p->lock);
+
+        jobs_work(p);
+
+        pthread_mutex_lock(&p->lock);
+        if (!--p->active)
+            pthread_cond_signal(&p->done);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+void jobs_init(job_pool *p, uint threads) {
+    memset(p, 0, sizeof(*p));
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->start, NULL);
+    pthread_cond_init(&p->done, NULL);
+
+    if (!threads) {
+        const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? cores : 1;
+    }
+    p->threads_len = threads - 1 < JOBS_MAX_THREADS ? threads - 1 : JOBS_MAX_THREADS;
+    if (!p->threads_len)
+        return;
+
+    p->threads = malloc(p->threads_len * sizeof(pthread_t));
+    if (!p->threads) {
+        error("Failed to allocate the worker threads.");
+        exit(EXIT_FAILURE);
+    }
+    for (uint i = 0; i < p->threads_len; i++)
+        if (pthread_create(&p->threads[i], NULL, jobs_worker, p)) {
+            error("Failed to start a worker thread.");
+            exit(EXIT_FAILURE);
+        }
+}
+
+void jobs_run(job_pool *p, job_fn fn, void *ctx, const uint len, const uint grain) {
+    if (!len)
+        return;
+
+    // waking the workers up costs more than a single range
+    if (!p->threads_len || len <= grain) {
+        fn(ctx, 0, len);
+        return;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    p->fn = fn;
+    p->ctx = ctx;
+    p->len = len;
+    p->grain = grain ? grain : 1;
+    atomic_store(&p->next, 0);
+    p->active = p->threads_len;
+    p->generation++;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+
+    jobs_work(p);
+
+    // the loop's data may be gone once this returns, so every worker has to be done with it
+    pthread_mutex_lock(&p->lock);
+    while (p->active)
+        pthread_cond_wait(&p->done, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+void jobs_free(job_pool *p) {
+    pthread_mutex_lock(&p->lock);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+
+    for (uint i = 0; i < p->threads_len; i++)
+        pthread_join(p->threads[i], NULL);
+    free(p->threads);
+
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->start);
+    pthread_cond_destroy(&p->done);
+    memset(p, 0, sizeof(*p));
+}
@@ -0,0 +1,364 @@
+/// Levels of detail: simplified versions of a mesh, made by quadric error edge collapses (Garland and Heckbert)
+/// that move a vertex onto a neighbour, so every version indexes the mesh's own vertices and only needs indices
+/// of its own. A version is drawn once its error, projected onto the screen, is small enough.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "lod.h"
+#include "meshopt.h"
+#include "normals.h"
+#include <string.h>
+
+
+// bits of the costs sorted on at a time
+#define LOD_RADIX_BITS 11
+
+
+/// @brief Collapse of a vertex onto a neighbour
+/// @param cost error of the collapse (mean squared distance to the planes of the triangles merged into the
+/// neighbour, weighed by their areas)
+/// @param from vertex that goes
+/// @param to vertex it moves onto
+typedef struct LodCollapse {
+    float cost;
+    uint from, to;
+} lod_collapse;
+
+/// @brief Triangles around every vertex
+/// @param offsets first entry of every vertex in `adjacent` (one more than there are vertices)
+/// @param adjacent triangles around each vertex, one vertex after the other
+typedef struct LodAdjacency {
+    uint *offsets, *adjacent;
+} lod_adjacency;
+
+/// @brief Collapses looked for by the worker threads
+/// @param s simplifier
+/// @param adj triangles around every vertex
+/// @param collapses cheapest collapse of every vertex (onto itself when it can't move)
+typedef struct LodJob {
+    const lod_simplifier *s;
+    const lod_adjacency *adj;
+    lod_collapse *collapses;
+} lod_job;
+
+
+static void *lod_alloc(const size_t bytes) {
+    void *p = malloc(bytes ? bytes : 1);
+    if (!p) {
+        error("Failed to allocate the mesh simplification.");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/// @brief Triangles around every vertex, in a prefix sum of the corners
+static void lod_adjacent(lod_adjacency *adj, const uint count, const uint m, const uint *indices) {
+    memset(adj->offsets, 0, (count + 1) * sizeof(uint));
+    for (uint c = 0; c < m; c++)
+        adj->offsets[indices[c] + 1]++;
+    for (uint v = 0; v < count; v++)
+        adj->offsets[v + 1] += adj->offsets[v];
+    for (uint c = 0; c < m; c++)
+        adj->adjacent[adj->offsets[indices[c]]++] = c / 3;
+    for (uint v = count; v > 0; v--)
+        adj->offsets[v] = adj->offsets[v - 1];
+    adj->offsets[0] = 0;
+}
+
+/// @brief Add the quadric of a plane (`n . p + d = 0`, with `n` of unit length), weighed by an area, to another
+static void quadric_add_plane(double q[LOD_QUADRIC], vec3 const n, const double d, const double area) {
+    q[0] += area * n[0] * n[0], q[1] += area * n[0] * n[1], q[2] += area * n[0] * n[2], q[3] += area * n[0] * d;
+    q[4] += area * n[1] * n[1], q[5] += area * n[1] * n[2], q[6] += area * n[1] * d;
+    q[7] += area * n[2] * n[2], q[8] += area * n[2] * d;
+    q[9] += area * d * d;
+    q[10] += area;
+}
+
+/// @brief Mean squared distance of a point to the planes of two quadrics, weighed by their areas
+static double quadric_error(const double a[LOD_QUADRIC], const double b[LOD_QUADRIC], vec3 const p) {
+    double q[LOD_QUADRIC];
+    for (uint k = 0; k < LOD_QUADRIC; k++)
+        q[k] = a[k] + b[k];
+    const double x = p[0], y = p[1], z = p[2];
+    const double e = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+                     + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+                     + q[7] * z * z + 2 * q[8] * z
+                     + q[9];
+    return e > 0.0 && q[10] > 0.0 ? e / q[10] : 0.0;
+}
+
+/// @brief Lock the vertices on a border or a non-manifold edge (an edge that isn't shared by exactly two
+/// triangles), since moving them would open the mesh up
+static void lod_lock_borders(lod_simplifier *s, const lod_adjacency *adj) {
+    for (uint v = 0; v < s->count; v++) {
+        const uint first = adj->offsets[v], end = adj->offsets[v + 1];
+        for (uint a = first; a < end && !s->locked[v]; a++) {
+            const uint *tri = s->indices + 3 * adj->adjacent[a];
+            for (uint l = 0; l < 3 && !s->locked[v]; l++) {
+                const uint w = tri[l];
+                if (w == v)
+                    continue;
+
+                uint shared = 0;
+                for (uint b = first; b < end; b++) {
+                    const uint *other = s->indices + 3 * adj->adjacent[b];
+                    shared += other[0] == w || other[1] == w || other[2] == w;
+                }
+                if (shared != 2)
+                    s->locked[v] = 1;
+            }
+        }
+    }
+}
+
+void lod_init(lod_simplifier *s, job_pool *jobs, const uint count, const vec3 *positions, const uint m,
+              const uint *indices) {
+    s->jobs = jobs;
+    s->count = count;
+    s->positions = positions;
+    s->quadrics = lod_alloc(count * sizeof(*s->quadrics));
+    s->locked = lod_alloc(count);
+    s->indices = lod_alloc(m * sizeof(uint));
+    s->m = 0;
+    s->error = 0.0f;
+    memset(s->quadrics, 0, count * sizeof(*s->quadrics));
+    memset(s->locked, 0, count);
+
+    // degenerate triangles are dropped, and the others' planes summed at their corners
+    for (uint c = 0; c + 2 < m; c += 3) {
+        const uint *tri = indices + c;
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+            continue;
+
+        vec3 e1, e2, n;
+        vec3_sub(e1, positions[tri[1]], positions[tri[0]]);
+        vec3_sub(e2, positions[tri[2]], positions[tri[0]]);
+        vec3_mul_cross(n, e1, e2);
+        const float len = vec3_len(n);
+        if (len > 0.0f) {
+            vec3_scale(n, n, 1.0f / len);
+            const double d = -vec3_mul_inner(n, positions[tri[0]]);
+            for (uint l = 0; l < 3; l++)
+                quadric_add_plane(s->quadrics[tri[l]], n, d, 0.5 * len);
+        }
+        memcpy(s->indices + s->m, tri, 3 * sizeof(uint));
+        s->m += 3;
+    }
+
+    // vertices sharing their position (seams) stay, or the copies would come apart
+    uint *remap = lod_alloc(count * sizeof(uint));
+    normals_weld(count, positions, remap);
+    for (uint v = 0; v < count; v++)
+        if (remap[v] != v)
+            s->locked[v] = s->locked[remap[v]] = 1;
+    free(remap);
+
+    lod_adjacency adj = {lod_alloc((count + 1) * sizeof(uint)), lod_alloc((s->m ? s->m : 1) * sizeof(uint))};
+    lod_adjacent(&adj, count, s->m, s->indices);
+    lod_lock_borders(s, &adj);
+    free(adj.offsets);
+    free(adj.adjacent);
+}
+
+/// @brief Sort collapses, the cheapest first (a cost is never negative, so its bits sort as an integer), with a radix
+/// sort that keeps collapses of the same cost in order
+/// @param collapses collapses to sort
+/// @param scratch room for as many collapses
+/// @param len number of collapses
+static void lod_sort(lod_collapse *collapses, lod_collapse *scratch, const uint len) {
+    lod_collapse *from = collapses, *to = scratch;
+    for (uint shift = 0; shift < 32; shift += LOD_RADIX_BITS) {
+        uint first[1u << LOD_RADIX_BITS] = {0};
+        for (uint k = 0; k < len; k++) {
+            uint32_t bits;
+            memcpy(&bits, &from[k].cost, sizeof(bits));
+            first[(bits >> shift) & ((1u << LOD_RADIX_BITS) - 1)]++;
+        }
+        for (uint d = 0, sum = 0; d < 1u << LOD_RADIX_BITS; d++) {
+            const uint n = first[d];
+            first[d] = sum, sum += n;
+        }
+        for (uint k = 0; k < len; k++) {
+            uint32_t bits;
+            memcpy(&bits, &from[k].cost, sizeof(bits));
+            to[first[(bits >> shift) & ((1u << LOD_RADIX_BITS) - 1)]++] = from[k];
+        }
+        lod_collapse *t = from;
+        from = to, to = t;
+    }
+    if (from != collapses)
+        memcpy(collapses, from, len * sizeof(lod_collapse));
+}
+
+/// @brief Cheapest collapse of every vertex of a range that may move, onto one of its neighbours (a vertex that
+/// isn't locked is surrounded by a closed fan, so each neighbour follows it in exactly one triangle)
+static void collapse_range(void *ctx, const uint first, const uint count) {
+    const lod_job *job = ctx;
+    const lod_simplifier *s = job->s;
+    const lod_adjacency *adj = job->adj;
+
+    for (uint v = first; v < first + count; v++) {
+        lod_collapse best = {0.0f, v, v};
+        double best_cost = 0.0;
+        for (uint a = adj->offsets[v]; a < adj->offsets[v + 1] && !s->locked[v]; a++) {
+            const uint *tri = s->indices + 3 * adj->adjacent[a];
+            const uint w = tri[0] == v ? tri[1] : tri[1] == v ? tri[2] : tri[0];
+            const double cost = quadric_error(s->quadrics[v], s->quadrics[w], s->positions[w]);
+            if (best.to == v || cost < best_cost)
+                best.to = w, best_cost = cost;
+        }
+        best.cost = (float)best_cost;
+        job->collapses[v] = best;
+    }
+}
+
+/// @brief Whether moving a vertex onto another turns any triangle around it over (those around both collapse)
+static int lod_flips(const lod_simplifier *s, const lod_adjacency *adj, const uint from, const uint to) {
+    for (uint a = adj->offsets[from]; a < adj->offsets[from + 1]; a++) {
+        const uint *tri = s->indices + 3 * adj->adjacent[a];
+        if (tri[0] == to || tri[1] == to || tri[2] == to)
+            continue;
+
+        vec3 before, after, e1, e2;
+        const float *p[3] = {s->positions[tri[0]], s->positions[tri[1]], s->positions[tri[2]]};
+        vec3_sub(e1, p[1], p[0]);
+        vec3_sub(e2, p[2], p[0]);
+        vec3_mul_cross(before, e1, e2);
+        for (uint l = 0; l < 3; l++)
+            if (tri[l] == from)
+                p[l] = s->positions[to];
+        vec3_sub(e1, p[1], p[0]);
+        vec3_sub(e2, p[2], p[0]);
+        vec3_mul_cross(after, e1, e2);
+        if (vec3_mul_inner(before, after) <= 0.0f)
+            return 1;
+    }
+    return 0;
+}
+
+uint lod_reduce(lod_simplifier *s, const uint triangles) {
+    lod_adjacency adj = {lod_alloc((s->count + 1) * sizeof(uint)), lod_alloc((s->m ? s->m : 1) * sizeof(uint))};
+    lod_collapse *collapses = lod_alloc(s->count * sizeof(lod_collapse));
+    lod_collapse *scratch = lod_alloc(s->count * sizeof(lod_collapse));
+    uint *target = lod_alloc(s->count * sizeof(uint));
+    uint8_t *touched = lod_alloc(s->count);
+
+    while (s->m / 3 > triangles) {
+        lod_adjacent(&adj, s->count, s->m, s->indices);
+
+        // the vertices that may move, with their cheapest collapse
+        lod_job job = {s, &adj, collapses};
+        if (s->jobs)
+            jobs_run(s->jobs, collapse_range, &job, s->count, LOD_GRAIN);
+        else
+            collapse_range(&job, 0, s->count);
+        uint len = 0;
+        for (uint v = 0; v < s->count; v++) {
+            target[v] = v;
+            if (collapses[v].to != v)
+                collapses[len++] = collapses[v];
+        }
+        lod_sort(collapses, scratch, len);
+
+        // independent collapses, the cheapest first: a collapse leaves the triangles around the vertex
+        // that went alone for the rest of the pass, so every check sees them as they are
+        memset(touched, 0, s->count);
+        const uint excess = s->m / 3 - triangles;
+        uint removed = 0, applied = 0;
+        for (uint k = 0; k < len && removed < excess; k++) {
+            const lod_collapse *c = &collapses[k];
+            if (touched[c->from] || touched[c->to] || lod_flips(s, &adj, c->from, c->to))
+                continue;
+
+            for (uint a = adj.offsets[c->from]; a < adj.offsets[c->from + 1]; a++) {
+                const uint *tri = s->indices + 3 * adj.adjacent[a];
+                removed += tri[0] == c->to || tri[1] == c->to || tri[2] == c->to;
+                touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+            }
+            for (uint q = 0; q < LOD_QUADRIC; q++)
+                s->quadrics[c->to][q] += s->quadrics[c->from][q];
+            target[c->from] = c->to;
+            s->error = fmaxf(s->error, sqrtf(c->cost));
+            applied++;
+        }
+        if (!applied)
+            break;
+
+        // the vertices that went are replaced, and the triangles that collapsed dropped
+        uint m = 0;
+        for (uint c = 0; c < s->m; c += 3) {
+            const uint a = target[s->indices[c]], b = target[s->indices[c + 1]], d = target[s->indices[c + 2]];
+            if (a == b || b == d || a == d)
+                continue;
+            s->indices[m++] = a, s->indices[m++] = b, s->indices[m++] = d;
+        }
+        s->m = m;
+    }
+
+    free(adj.offsets);
+    free(adj.adjacent);
+    free(collapses);
+    free(scratch);
+    free(target);
+    free(touched);
+    return s->m;
+}
+
+void lod_free(lod_simplifier *s) {
+    free(s->quadrics);
+    free(s->locked);
+    free(s->indices);
+}
+
+uint lod_build(job_pool *jobs, const uint count, const void *vertices, const size_t stride, const uint m,
+               const uint *indices, const uint levels, lod_level *out, uint **out_indices) {
+    *out_indices = NULL;
+    if (!levels || m / 3 < LOD_MIN_TRIANGLES || !meshopt_in_range(count, m, indices))
+        return 0;
+
+    vec3 *positions = lod_alloc(count * sizeof(vec3));
+    for (uint v = 0; v < count; v++)
+        memcpy(positions[v], (const char *)vertices + v * stride, sizeof(vec3));
+
+    // every version carries on from the one before, until one would barely be simpler
+    lod_simplifier s;
+    lod_init(&s, jobs, count, positions, m, indices);
+    uint n = 0, len = 0, triangles = s.m / 3;
+    uint *all = NULL;
+    for (uint l = 0; l < levels && l < LOD_MAX; l++) {
+        const uint k = lod_reduce(&s, (uint)(triangles * LOD_RATIO));
+        if (!k || k / 3 > triangles * (1.0f - LOD_MIN_GAIN))
+            break;
+        triangles = k / 3;
+
+        all = realloc(all, (size_t)(len + k) * sizeof(uint));
+        if (!all) {
+            error("Failed to allocate the mesh simplification.");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(all + len, s.indices, k * sizeof(uint));
+        out[n++] = (lod_level) {
+            len, k, s.error, NULL, 0
+        };
+        len += k;
+    }
+
+    lod_free(&s);
+    free(positions);
+    *out_indices = all;
+    return n;
+}
+
+uint lod_select(const lod_level *levels, const uint len, const uint current, const float pixels) {
+    if (pixels <= 0.0f || len < 2)
+        return 0;
+
+    // finer versions as long as the current one is off by too much, coarser ones while the next is well within
+    uint l = current < len ? current : len - 1;
+    while (l > 0 && levels[l].error * pixels > LOD_PIXELS * (1.0f + LOD_HYSTERESIS))
+        l--;
+    if (l == current)
+        while (l + 1 < len && levels[l + 1].error * pixels <= LOD_PIXELS * (1.0f - LOD_HYSTERESIS))
+            l++;
+    return l;
+}
@@ -1,30 +1,63 @@
 #include "fpsdbg.h"
+#include "gputimer.h"
+#include "headless.h"
+#include "import.h"
+#include "opts.h"
+#include "render.h"
+#include "scene.h"
+#include "scenefile.h"
+#include "simd.h"
 
 
-const shader SHADER_VERT = {"                             \n\
-#version 460                                              \n\
-                                                          \n\
-layout(location = 0) in vec3 a_pos;                       \n\
-layout(location = 1) in vec3 a_norm;                      \n\
-                                                          \n\
-out vec3 b_pos; // modified position                      \n\
-out vec3 b_norm; // modified normals                      \n\
-                                                          \n\
-layout(location = 0) uniform mat4 modelview;              \n\
-layout(location = 1) uniform mat4 projection;             \n\
-                                                          \n\
-void main() {                                             \n\
-    vec4 pos = vec4(a_pos, 1.0);                          \n\
-    b_pos = (modelview * pos).xyz;                        \n\
-    mat3 norm_mat = transpose(inverse(mat3(modelview)));  \n\
-    b_norm = normalize(norm_mat * a_norm);                \n\
-    gl_Position = projection * modelview * pos;           \n\
-}                                                         \n\
+const shader SHADER_VERT = {"                                   \n\
+#version 450                                                    \n\
+#extension GL_ARB_shader_draw_parameters : require              \n\
+                                                                \n\
+layout(location = 0) in vec3 a_pos;                             \n\
+layout(location = 1) in vec3 a_norm;                            \n\
+                                                                \n\
+layout(location = 0) uniform bool octahedral; // packed normals \n\
+                                                                \n\
+out vec3 b_pos; // modified position                            \n\
+out vec3 b_norm; // modified normals                            \n\
+                                                                \n\
+layout(std140, binding = 0) uniform Frame {                     \n\
+    mat4 projection;                                            \n\
+    mat4 view;                                                  \n\
+};                                                              \n\
+                                                                \n\
+struct Object {                                                 \n\
+    mat4 modelview;                                             \n\
+    mat3 normal; // precomputed on the CPU                      \n\
+    vec4 dequant; // center and scale of the mesh's positions   \n\
+};                                                              \n\
+                                                                \n\
+layout(std430, binding = 0) readonly buffer Objects {           \n\
+    Object objects[];                                           \n\
+};                                                              \n\
+                                                                \n\
+// unfold a normal packed on an octahedron (see `vformat_oct`)  \n\
+vec3 unpack_normal(vec2 e) {                                    \n\
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));                \n\
+    if (n.z < 0.0)                                              \n\
+        n.xy = (1.0 - abs(n.yx)) * (step(0.0, e) * 2.0 - 1.0);  \n\
+    return n;                                                   \n\
+}                                                               \n\
+                                                                \n\
+void main() {                                                   \n\
+    Object o = objects[gl_BaseInstanceARB + gl_InstanceID];     \n\
+    vec3 p = o.dequant.xyz + o.dequant.w * a_pos;               \n\
+    vec3 n = octahedral ? unpack_normal(a_norm.xy) : a_norm;    \n\
+    vec4 pos = o.modelview * vec4(p, 1.0);                      \n\
+    b_pos = pos.xyz;                                            \n\
+    b_norm = normalize(o.normal * n);                           \n\
+    gl_Position = projection * pos;                             \n\
+}                                                               \n\
 ", GL_VERTEX_SHADER
                            };
 
 const shader SHADER_FRAG = {"                          \n\
-#version 460                                           \n\
+#version 450                                           \n\
                                                        \n\
 in vec3 b_pos;                                         \n\
 in vec3 b_norm;                                        \n\
@@ -42,6 +75,44 @@ void main() {                                          \n\
 ", GL_FRAGMENT_SHADER
                            };
 
+// what a click picks from (set once the scene is drawn)
+static renderer *pick_renderer;
+static world *pick_world;
+
+/// Write a string as a JSON string (quoted, with quotes, backslashes and control characters escaped)
+static void json_string(const char *s, FILE *out) {
+    fputc('"', out);
+    for (; *s; s++) {
+        const unsigned char c = *s;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+/// Mouse button callback (a left click prints the object under the cursor)
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
+    if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS || !pick_renderer)
+        return;
+
+    // window coordinates to normalized device coordinates (window y points down)
+    double x, y;
+    int w, h;
+    glfwGetCursorPos(window, &x, &y);
+    glfwGetWindowSize(window, &w, &h);
+    const handle hit = render_pick(pick_renderer, pick_world, 2.0 * x / w - 1.0, 1.0 - 2.0 * y / h);
+
+    if (hit == HANDLE_NULL)
+        printf("pick: nothing\n");
+    else
+        printf("pick: object %u (handle 0x%08x, mesh %u)\n", world_index(pick_world, hit), hit,
+               pick_world->mesh[world_index(pick_world, hit)]);
+}
+
 /// Key callback
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
     // ignore key releases
@@ -58,6 +129,21 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         case GLFW_KEY_RIGHT:
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
             break;
+        case GLFW_KEY_UP:
+            // a finer level of the depth pyramid (when it is shown)
+            if (pick_renderer && pick_renderer->occlusion.level > 0)
+                pick_renderer->occlusion.level--;
+            break;
+        case GLFW_KEY_DOWN:
+            if (pick_renderer && pick_renderer->occlusion.level + 1 < pick_renderer->occlusion.levels)
+                pick_renderer->occlusion.level++;
+            break;
+        case GLFW_KEY_G:
+            // start or stop tracing the GL calls (in profiling builds)
+#ifdef GLTRACE
+            gltrace_enable(!gl_trace.enabled);
+#endif
+            break;
         case GLFW_KEY_W:
             cam.pos[2] -= 0.2;
             break;
@@ -81,56 +167,37 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     upt_cam();
 }
 
-/// Handle drawing everything to the window
-void display(GLFWwindow *window, world w) {
-    // clear the screen
-    glClearColor(0.4, 0.4, 0.4, 1.0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // draw each object
-    for (uint i = 0; i < w.objects_len; i++) {
-        const obj o = w.objects[i]; // the current object
-
-        // init rotation matrix
-        mat4x4_identity(cam.r);
-        mat4x4_rotate_Y(cam.r, cam.r, glfwGetTime());
-
-        // Instead of calling `upt_cam` to fully update the camera,
-        // clone only the camera's modelview matrix as it's the
-        // only matrix being modified; everything else stays the
-        // same, so there's no need to recalculate their values
-        mat4x4 m;
-        mat4x4_dup(m, cam.m);
-
-        // multiply modelview with rotation matrix
-        mat4x4_mul(m, m, cam.r);
-
-        // use the correct program
-        glUseProgram(o.program);
-
-        // init uniforms
-        glUniformMatrix4fv(0, 1, GL_FALSE, (float *)m); // modelview
-        glUniformMatrix4fv(1, 1, GL_FALSE, (float *)cam.p); // projection
+int main(int argc, char **argv) {
+    // parse the command line
+    const options opts = parse_opts(argc, argv);
 
-        // bind and draw object
-        glBindVertexArray(o.vao);
+    // worker threads, for the loops over every object
+    job_pool jobs;
+    jobs_init(&jobs, opts.threads);
 
-        // draw the object
-        if (o.has_ebo)
-            glDrawElements(o.mode, o.indices_len, GL_UNSIGNED_INT, 0);
-        else
-            glDrawArrays(o.mode, 0, o.vertices_len);
+    // the fastest matrix kernels the CPU supports (which the kernel benchmark checks against the scalar ones)
+    if (opts.bench_kernels) {
+        const uint failures = simd_bench(&jobs, stdout);
+        jobs_free(&jobs);
+        return failures ? EXIT_FAILURE : EXIT_SUCCESS;
     }
-}
+    simd_init();
 
-int main(int argc, char **argv) {
-    // init GLFW and GLEW and window
-    GLFWwindow *window = init();
+    // init GLFW and GLEW and window (or an offscreen framebuffer)
+    GLFWwindow *window = NULL;
+    headless hl;
+    if (opts.headless)
+        init_headless(&hl, opts.width, opts.height, opts.samples);
+    else
+        window = init(opts.width, opts.height, opts.samples);
 
     // shader files (vertex and fragment)
     uint vs, fs;
     if (!(compile_shader(&vs, SHADER_VERT) && compile_shader(&fs, SHADER_FRAG))) {
-        glfwDestroyWindow(window);
+        if (opts.headless)
+            headless_free(&hl);
+        else
+            glfwDestroyWindow(window);
         glfwTerminate();
         return 1;
     }
@@ -143,31 +210,215 @@ int main(int argc, char **argv) {
     glDeleteShader(vs); // no longer needed
     glDeleteShader(fs); // no longer needed
 
+    // packed vertex formats keep two components of each normal
+    glProgramUniform1i(program, 0, VFORMAT_LAYOUTS[opts.vertex].norm_size == 2);
+
     // assign callbacks
-    glfwSetKeyCallback(window, key_callback);
+    if (window) {
+        glfwSetKeyCallback(window, key_callback);
+        glfwSetMouseButtonCallback(window, mouse_button_callback);
+    }
 
     // init world container (for managing all objects)
-    world wd = (world) {
-        .objects = (obj *)malloc(sizeof(obj)),
-        .objects_len = 0
-    };
-
-    create_rect(&wd, program, (vec3) {
-        -0.5, -0.5, -0.5
-    }, (vec3) {
-        1, 1, 1
-    });
-
-    while (!glfwWindowShouldClose(window)) {
-        display(window, wd);
+    world wd;
+    world_init(&wd, opts.scene.objects);
+    wd.meshes.jobs = &jobs;
+    wd.meshes.optimize = opts.optimize;
+    wd.meshes.format = opts.vertex;
+    wd.meshes.lods = opts.lods;
+    wd.meshes.clusters = opts.clusters;
+
+    // populate the world from an OBJ or PLY file, or a scene file, or generate it (a single cube by default)
+    scene_info scene;
+    import_stats imported = {0};
+    const uint64_t load_start = prof_now();
+    int loaded = 1;
+    if (opts.file && import_supports(opts.file)) {
+        if ((loaded = import_load(&wd, program, opts.file, opts.threads, &scene, &imported)))
+            import_report(&imported, opts.file, stderr);
+    } else if (opts.file) {
+        scene_file sf;
+        if ((loaded = scenefile_open(&sf, opts.file))) {
+            scene = scenefile_load(&sf, &wd, program);
+            scenefile_close(&sf);
+        }
+    } else
+        scene = generate_scene(&wd, program, &opts.scene);
+    const double load_ms = (prof_now() - load_start) / 1e6;
+    if (!loaded) {
+        world_free(&wd);
+        jobs_free(&jobs);
+        if (opts.headless)
+            headless_free(&hl);
+        else
+            glfwDestroyWindow(window);
+        glfwTerminate();
+        return 1;
+    }
+
+    // back the camera up until the whole scene fits into the (0.8 rad) field of view
+    if (opts.file || opts.scene.objects > 1) {
+        const float d = scene.radius / sinf(0.4f) - 2.0f;
+        cam.pos[2] = d > 0.0f ? d : 0.0f;
+        upt_cam();
+    }
+
+    // time the hierarchy over the generated scene instead of rendering it
+    if (opts.bench_bvh) {
+        bvh_bench(&wd, cam.p, cam.m, stdout);
+        world_free(&wd);
+        jobs_free(&jobs);
+        if (opts.headless)
+            headless_free(&hl);
+        else
+            glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
+
+    // renderer (one draw per object, or one per mesh)
+    renderer rd;
+    render_init(&rd, opts.draw, opts.order, opts.cull, opts.hiz, &jobs);
+    pick_renderer = &rd, pick_world = &wd;
+
+    // frame-time profiler (static, as the sample ring is fairly large)
+    static profiler prof;
+    prof_init(&prof, opts.report);
+
+    // GPU timer (results arrive a few frames late, and go into the profiler)
+    gpu_timer gpu;
+    gpu_timer_init(&gpu);
+
+    // GL calls are traced from the first frame on (in profiling builds)
+    gltrace_enable(opts.gl_trace);
+
+    // periodic reports would mix with the JSON summary
+    FILE *report = opts.frames ? stderr : stdout;
+
+    for (uint frame = 0; opts.frames ? frame < opts.frames : !glfwWindowShouldClose(window); frame++) {
+        prof_begin(&prof);
+        gpu_timer_begin(&gpu, &prof);
+
+        // offscreen runs advance at a fixed 60 Hz step so every run draws the same frames
+        display(&rd, &wd, &gpu, window ? glfwGetTime() : frame / 60.0);
+        gpu_timer_end(&gpu);
+        prof_mark(&prof, PHASE_DISPLAY);
+
         // update other events like input handling
-        glfwPollEvents();
+        if (window)
+            glfwPollEvents();
+        prof_mark(&prof, PHASE_POLL);
+
         // put the stuff we've been drawing onto the display
-        glfwSwapBuffers(window);
+        if (window)
+            glfwSwapBuffers(window);
+        else
+            headless_swap(&hl);
+        prof_mark(&prof, PHASE_SWAP);
+
+        prof_end(&prof);
+        prof_report(&prof, report);
+        gltrace_frame();
+
+        // closing the window ends a fixed-length run early
+        if (window && glfwWindowShouldClose(window))
+            break;
+    }
+
+    // machine-readable summary of fixed-length runs
+    if (opts.frames) {
+        printf("{\"mode\": \"%s\", \"size\": [%u, %u], \"samples\": %u, \"renderer\": ",
+               opts.headless ? "headless" : "window", WIDTH, HEIGHT, opts.samples);
+        json_string((const char *)glGetString(GL_RENDERER), stdout);
+        printf(", \"scene\": {");
+        if (opts.file) {
+            printf("\"file\": ");
+            json_string(opts.file, stdout);
+            printf(", ");
+        }
+        if (imported.bytes)
+            printf("\"import\": {\"bytes\": %lu, \"vertices_read\": %lu, \"vertices\": %lu, \"mb_s\": %.1f, \"triangles_s\": %.0f}, ",
+                   (unsigned long)imported.bytes, (unsigned long)imported.vertices_read,
+                   (unsigned long)imported.vertices, imported.mb_s, imported.triangles_s);
+        printf("\"objects\": %u, \"triangles\": %lu, \"layout\": \"%s\", \"mesh\": \"%s\", \"detail\": %u, \"seed\": %u, \"meshes\": %u, \"mesh_bytes\": %lu, \"vertex_format\": \"%s\", \"load_ms\": %.3f, ",
+               wd.len, (unsigned long)scene.triangles, LAYOUT_NAMES[opts.scene.layout],
+               MESH_NAMES[opts.scene.mesh], opts.scene.detail, opts.scene.seed,
+               wd.meshes.len, (unsigned long)mesh_bytes(&wd.meshes), VFORMAT_NAMES[wd.meshes.format], load_ms);
+        printf("\"arena\": {\"vertices\": ");
+        arena_json(&wd.meshes.vertices, stdout);
+        printf(", \"indices\": ");
+        arena_json(&wd.meshes.indices, stdout);
+        printf("}, \"optimize\": ");
+        meshopt_json(wd.meshes.optimize, &wd.meshes.opt, stdout);
+        printf("}, ");
+        printf("\"draw\": {\"mode\": \"%s\", \"calls\": %u, \"commands\": %u, \"order\": \"%s\", \"binds\": %u, \"state_changes\": %u}, ",
+               DRAW_MODE_NAMES[rd.mode], rd.draws, rd.mode == DRAW_MDI ? rd.commands_len : rd.draws,
+               ORDER_NAMES[rd.order], rd.state.binds, rd.state.changes);
+
+        // versions made at load time, and how the last frame drew them
+        uint versioned = 0, versions = 0;
+        for (uint me = 0; me < wd.meshes.len; me++)
+            if (wd.meshes.meshes[me].lods > 1)
+                versioned++, versions += wd.meshes.meshes[me].lods - 1;
+        printf("\"lod\": {\"max\": %u, \"meshes\": %u, \"versions\": %u, \"switches\": %lu, \"objects\": [",
+               wd.meshes.lods, versioned, versions, (unsigned long)rd.switches);
+        for (uint l = 0; l <= LOD_MAX; l++)
+            printf("%s%u", l ? ", " : "", rd.level_objects[l]);
+        printf("], \"triangles\": %lu}, ", (unsigned long)rd.level_triangles);
+
+        // meshlets made at load time (of every version), and how many the last frame kept
+        uint split = 0, meshlets = 0;
+        for (uint me = 0; me < wd.meshes.len; me++) {
+            const mesh *msh = &wd.meshes.meshes[me];
+            split += msh->lods && msh->lod[0].meshlets_len;
+            for (uint l = 0; l < msh->lods; l++)
+                meshlets += msh->lod[l].meshlets_len;
+        }
+        printf("\"clusters\": {\"meshes\": %u, \"meshlets\": %u, \"objects\": %u, \"tested\": %u, \"visible\": %u, \"triangles\": %lu}, ",
+               split, meshlets, rd.clustered, rd.cluster_tested, rd.cluster_commands_len,
+               (unsigned long)rd.cluster_triangles);
+
+        // visible counts arrive a few frames late, so the last one read back is reported
+        const culler *cl = &rd.culling;
+
+        printf("\"cull\": {\"mode\": \"%s\", \"objects\": %u", CULL_MODE_NAMES[rd.cull], wd.len);
+        if (rd.cull == CULL_GPU)
+            printf(", \"visible\": %u, \"culled\": %u, \"visible_mean\": %.1f, \"compact\": %s, \"hiz\": \"%s\", \"occluded\": %u, \"occluded_mean\": %.1f",
+                   cl->visible, cl->objects - cl->visible,
+                   cl->resolved ? (double)cl->visible_sum / cl->resolved : 0.0, cl->compact ? "true" : "false",
+                   HIZ_MODE_NAMES[rd.occlusion.mode], cl->occluded,
+                   cl->resolved ? (double)cl->occluded_sum / cl->resolved : 0.0);
+        else if (rd.cull == CULL_CPU)
+            printf(", \"visible\": %u, \"culled\": %u, \"nodes\": %u", rd.list_len + rd.clustered,
+                   wd.len - rd.list_len - rd.clustered, rd.tree.nodes_len);
+        printf("}, \"stats\": ");
+        prof_json(&prof, stdout);
+        printf(", \"gpu_dropped\": %lu, ", (unsigned long)gpu.dropped);
+#ifdef GLTRACE
+        printf("\"gl\": ");
+        gltrace_json(stdout);
+        printf(", ");
+#endif
+
+        // time the CPU spent blocked on the GPU before it could write a frame's data
+        const stream_buffer *streams[] = {&rd.frame, &rd.objects};
+        printf("\"stream\": {");
+        for (uint i = 0; i < 2; i++)
+            printf("%s\"%s\": {\"waits\": %lu, \"wait_ms\": %.3f, \"resizes\": %lu, \"bytes\": %lu}",
+                   i ? ", " : "", i ? "objects" : "frame", (unsigned long)streams[i]->waits,
+                   streams[i]->wait_ns / 1e6, (unsigned long)streams[i]->resizes,
+                   (unsigned long)(STREAM_REGIONS * streams[i]->region));
+        printf("}}\n");
     }
 
     // clean up
-    free(wd.objects);
-    glfwDestroyWindow(window);
+    gpu_timer_free(&gpu);
+    render_free(&rd);
+    world_free(&wd);
+    jobs_free(&jobs);
+    if (opts.headless)
+        headless_free(&hl);
+    else
+        glfwDestroyWindow(window);
     glfwTerminate();
-}
\ No newline at end of file
+}
@@ -0,0 +1,340 @@
+/// Mesh registry, so objects with the same geometry share a single set of buffers.
+/// Every mesh lives at an offset in one vertex arena and one index arena, read through a single VAO.
+/// Normals are generated as meshes are created, and stored next to their positions in the registry's vertex format.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "mesh.h"
+#include <string.h>
+
+
+/// @brief Create the arenas and the shared VAO
+static void mesh_registry_init(mesh_registry *mr) {
+    arena_init(&mr->vertices, VFORMAT_LAYOUTS[mr->format].size, MESH_ARENA_VERTICES);
+    arena_init(&mr->indices, sizeof(uint), MESH_ARENA_INDICES);
+
+    glGenVertexArrays(1, &mr->vao);
+    glBindVertexArray(mr->vao);
+
+    // `a_pos` and `a_norm` are interleaved in binding 0
+    vformat_attribs(mr->format);
+
+    glBindVertexArray(0);
+}
+
+/// @brief Elements of the index arena taken by a mesh's indices (two 16-bit indices share an element)
+static uint mesh_index_slots(const GLenum type, const uint m) {
+    return type == GL_UNSIGNED_SHORT ? (m + 1) / 2 : m;
+}
+
+/// @brief Point the VAO at the arenas' buffers (which are new whenever an arena grew)
+static void mesh_bind(const mesh_registry *mr) {
+    glBindVertexArray(mr->vao);
+    glBindVertexBuffer(0, mr->vertices.buffer, 0, mr->vertices.stride);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mr->indices.buffer);
+    glBindVertexArray(0);
+}
+
+void mesh_bounds(aabb *box, vec4 sphere, const uint n, const float *vertices) {
+    vec3 lo = {0.0f, 0.0f, 0.0f}, hi = {0.0f, 0.0f, 0.0f};
+    for (uint i = 0; i + 2 < n; i += 3)
+        for (uint l = 0; l < 3; l++) {
+            const float x = vertices[i + l];
+            if (!i || x < lo[l])
+                lo[l] = x;
+            if (!i || x > hi[l])
+                hi[l] = x;
+        }
+    vec3_dup(box->lo, lo);
+    vec3_dup(box->hi, hi);
+
+    vec3 center;
+    vec3_add(center, lo, hi);
+    vec3_scale(center, center, 0.5f);
+
+    float r = 0.0f;
+    for (uint i = 0; i + 2 < n; i += 3) {
+        vec3 d;
+        vec3_sub(d, &vertices[i], center);
+        const float len = vec3_len(d);
+        if (len > r)
+            r = len;
+    }
+
+    sphere[0] = center[0], sphere[1] = center[1], sphere[2] = center[2], sphere[3] = r;
+}
+
+vertex *mesh_vertices(job_pool *jobs, uint *count, uint *m, const float *vertices, const uint *indices,
+                      const GLenum mode, const normal_mode normals) {
+    const vec3 *positions = (const vec3 *)vertices;
+    const vec3 *corners = positions;
+    vec3 *pos = NULL, *norm = NULL;
+
+    // lines and points have no faces, so their normals point away from the origin
+    if (mode != GL_TRIANGLES)
+        corners = NULL;
+    else if (normals == NORMALS_FLAT && *m) {
+        // every corner becomes a vertex of its own
+        pos = malloc(*m * sizeof(vec3));
+        norm = malloc(*m * sizeof(vec3));
+        if (pos && norm)
+            normals_flat(jobs, *m, positions, indices, pos, norm);
+        corners = pos;
+        *count = *m, *m = 0;
+    } else if (normals == NORMALS_FLAT) {
+        norm = malloc(*count * sizeof(vec3));
+        if (norm)
+            normals_flat(jobs, *count, positions, NULL, NULL, norm);
+    } else {
+        norm = malloc(*count * sizeof(vec3));
+        if (norm)
+            normals_smooth(jobs, normals, *count, positions, *m ? *m : *count, *m ? indices : NULL, norm);
+    }
+
+    vertex *data = malloc(*count * sizeof(vertex));
+    if (!data || (mode == GL_TRIANGLES && (!corners || !norm))) {
+        error("Failed to allocate the vertices of a mesh.");
+        exit(EXIT_FAILURE);
+    }
+    for (uint v = 0; v < *count; v++) {
+        vec3_dup(data[v].pos, corners ? corners[v] : positions[v]);
+        vec3_dup(data[v].norm, norm ? norm[v] : positions[v]);
+    }
+
+    free(pos);
+    free(norm);
+    return data;
+}
+
+uint mesh_create(mesh_registry *mr, const char *name, const uint n, const uint m, const float *vertices, const uint *indices,
+                 const GLenum mode, const normal_mode normals) {
+    uint count = n / 3, len = m;
+    vertex *data = mesh_vertices(mr->jobs, &count, &len, vertices, indices, mode, normals);
+
+    aabb box;
+    vec4 sphere;
+    mesh_bounds(&box, sphere, n, vertices);
+
+    // the normals don't depend on the order, so the triangles and vertices are reordered once they're in
+    uint *reordered = NULL;
+    if (len && mode == GL_TRIANGLES && mr->optimize != MESHOPT_NONE) {
+        reordered = malloc(len * sizeof(uint));
+        if (!reordered) {
+            error("Failed to allocate the indices of a mesh.");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(reordered, indices, len * sizeof(uint));
+        meshopt_optimize(mr->optimize, count, data, sizeof(vertex), len, reordered, &mr->opt);
+    }
+
+    const uint *uploaded = !len ? NULL : reordered ? reordered : indices;
+    const uint me = mesh_upload(mr, name, count, len, data, uploaded, mode, &box, sphere);
+    if (len)
+        mesh_lods(mr, me, data, uploaded);
+    free(reordered);
+    free(data);
+    return me;
+}
+
+/// @brief Put indices in the index arena, in a type
+/// @return first index, counted in indices of the type
+static uint mesh_indices(mesh_registry *mr, const GLenum type, const uint m, const uint *indices) {
+    // 16-bit indices are narrowed, halving what is read of them (padded to a whole element)
+    uint16_t *narrow = NULL;
+    if (type == GL_UNSIGNED_SHORT) {
+        narrow = malloc(2 * mesh_index_slots(type, m) * sizeof(uint16_t));
+        if (!narrow) {
+            error("Failed to allocate the indices of a mesh.");
+            exit(EXIT_FAILURE);
+        }
+        for (uint c = 0; c < m; c++)
+            narrow[c] = indices[c];
+        if (m % 2)
+            narrow[m] = 0;
+    }
+
+    uint first_index = arena_alloc(&mr->indices, mesh_index_slots(type, m), narrow ? (void *)narrow : indices);
+    if (type == GL_UNSIGNED_SHORT)
+        first_index *= 2;
+    free(narrow);
+    return first_index;
+}
+
+/// @brief Return a range of indices to the index arena
+static void mesh_release_indices(mesh_registry *mr, const GLenum type, const uint first_index, const uint m) {
+    arena_release(&mr->indices, type == GL_UNSIGNED_SHORT ? first_index / 2 : first_index, mesh_index_slots(type, m));
+}
+
+/// @brief Split large triangle meshes (or versions of them) into meshlets, their triangles grouped by meshlet
+/// @return the indices reordered meshlet by meshlet, on the heap, or `NULL` to upload the caller's as they are
+static uint *mesh_clusters(const mesh_registry *mr, const uint count, const vertex *vertices, const GLenum mode,
+                           const uint m, const uint *indices, meshlet **meshlets, uint *meshlets_len) {
+    *meshlets = NULL, *meshlets_len = 0;
+    if (!mr->clusters || mode != GL_TRIANGLES || m / 3 < MESHLET_MIN_TRIANGLES)
+        return NULL;
+
+    uint *clustered = malloc(m * sizeof(uint));
+    if (!clustered) {
+        error("Failed to allocate the indices of a mesh.");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(clustered, indices, m * sizeof(uint));
+    *meshlets = meshlet_build(count, vertices->pos, sizeof(vertex), m, clustered, meshlets_len);
+    return clustered;
+}
+
+uint mesh_upload(mesh_registry *mr, const char *name, const uint count, const uint m, const vertex *vertices,
+                 const uint *indices, const GLenum mode, const aabb *box, vec4 const sphere) {
+    if (!mr->vao)
+        mesh_registry_init(mr);
+
+    // indices of small meshes are narrowed
+    const GLenum type = !m ? 0 : count <= MESH_SHORT_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    if (type == GL_UNSIGNED_SHORT)
+        mr->opt.short_meshes++;
+
+    // packed vertices are quantized relative to the mesh's bounds
+    vec4 dequant;
+    vformat_dequant(mr->format, dequant, box->lo, box->hi);
+    void *packed = NULL;
+    if (mr->format != VFORMAT_F32) {
+        packed = malloc((size_t)count * mr->vertices.stride);
+        if (!packed && count) {
+            error("Failed to allocate the vertices of a mesh.");
+            exit(EXIT_FAILURE);
+        }
+        vformat_encode(mr->format, packed, count, vertices->pos, vertices->norm, sizeof(vertex), dequant);
+    }
+
+    meshlet *meshlets;
+    uint meshlets_len;
+    uint *clustered = mesh_clusters(mr, count, vertices, mode, m, indices, &meshlets, &meshlets_len);
+
+    // offsets are in whole vertices and indices, as `baseVertex` and `firstIndex` expect
+    const uint base_vertex = arena_alloc(&mr->vertices, count, packed ? packed : vertices);
+    free(packed);
+    const uint first_index = mesh_indices(mr, type, m, clustered ? clustered : indices);
+    free(clustered);
+
+    // an arena that grew has a new buffer
+    mesh_bind(mr);
+
+    // grow the registry
+    if (mr->len == mr->cap) {
+        mr->cap = mr->cap ? mr->cap * 2 : 16;
+        mr->meshes = realloc(mr->meshes, mr->cap * sizeof(mesh));
+        if (!mr->meshes) {
+            error("Failed to grow the mesh registry.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    mesh *me = &mr->meshes[mr->len];
+    *me = (mesh) {
+        base_vertex, first_index, 3 * count, m, mode, m > 0, type,
+        .bytes = count * mr->vertices.stride + mesh_index_slots(type, m) * sizeof(uint)
+    };
+    me->box = *box;
+    vec4_dup(me->sphere, sphere);
+    vec4_dup(me->dequant, dequant);
+    me->lods = 1;
+    me->lod[0] = (lod_level) {
+        first_index, m, 0.0f, meshlets, meshlets_len
+    };
+    if (name)
+        snprintf(me->name, MESH_NAME_LEN, "%s", name);
+
+    return mr->len++;
+}
+
+void mesh_lods(mesh_registry *mr, const uint me, const vertex *vertices, const uint *indices) {
+    const mesh *msh = &mr->meshes[me];
+    if (msh->mode != GL_TRIANGLES)
+        return;
+
+    lod_level levels[LOD_MAX];
+    uint *reordered;
+    const uint count = msh->vertices_len / 3;
+    const uint n = lod_build(mr->jobs, count, vertices->pos, sizeof(vertex), msh->indices_len, indices, mr->lods,
+                             levels, &reordered);
+    for (uint l = 0; l < n; l++) {
+        // the version's triangles are reordered too, though its vertices stay the mesh's
+        uint *lod = reordered + levels[l].first_index;
+        meshopt_triangles(mr->optimize, count, vertices, sizeof(vertex), levels[l].indices_len, lod);
+        mesh_lod(mr, me, vertices, levels[l].indices_len, lod, levels[l].error);
+    }
+    free(reordered);
+}
+
+void mesh_lod(mesh_registry *mr, const uint me, const vertex *vertices, const uint m, const uint *indices,
+              const float error) {
+    mesh *msh = &mr->meshes[me];
+    if (msh->lods > LOD_MAX)
+        return;
+
+    // versions large enough are split into meshlets as well, so close objects drawn simplified are still culled
+    meshlet *meshlets;
+    uint meshlets_len;
+    uint *clustered = mesh_clusters(mr, msh->vertices_len / 3, vertices, msh->mode, m, indices, &meshlets,
+                                    &meshlets_len);
+    msh->lod[msh->lods++] = (lod_level) {
+        mesh_indices(mr, msh->index_type, m, clustered ? clustered : indices), m, error, meshlets, meshlets_len
+    };
+    free(clustered);
+    msh->bytes += mesh_index_slots(msh->index_type, m) * sizeof(uint);
+
+    // an arena that grew has a new buffer
+    mesh_bind(mr);
+}
+
+void mesh_reserve(mesh_registry *mr, const uint vertices, const uint indices) {
+    if (!mr->vao)
+        mesh_registry_init(mr);
+
+    arena_reserve(&mr->vertices, vertices);
+    arena_reserve(&mr->indices, indices);
+    mesh_bind(mr);
+}
+
+void mesh_destroy(mesh_registry *mr, const uint me) {
+    mesh *msh = &mr->meshes[me];
+    arena_release(&mr->vertices, msh->base_vertex, msh->vertices_len / 3);
+    for (uint l = 0; l < msh->lods; l++) {
+        mesh_release_indices(mr, msh->index_type, msh->lod[l].first_index, msh->lod[l].indices_len);
+        free(msh->lod[l].meshlets);
+    }
+
+    // an empty mesh draws nothing and can't be found
+    *msh = (mesh) {
+        0
+    };
+}
+
+uint mesh_find(const mesh_registry *mr, const char *name) {
+    for (uint i = 0; i < mr->len; i++)
+        if (mr->meshes[i].name[0] && !strcmp(mr->meshes[i].name, name))
+            return i;
+    return MESH_NONE;
+}
+
+size_t mesh_bytes(const mesh_registry *mr) {
+    size_t bytes = 0;
+    for (uint i = 0; i < mr->len; i++)
+        bytes += mr->meshes[i].bytes;
+    return bytes;
+}
+
+void mesh_registry_free(mesh_registry *mr) {
+    if (mr->vao) {
+        glDeleteVertexArrays(1, &mr->vao);
+        arena_free(&mr->vertices);
+        arena_free(&mr->indices);
+    }
+
+    for (uint i = 0; i < mr->len; i++)
+        for (uint l = 0; l < mr->meshes[i].lods; l++)
+            free(mr->meshes[i].lod[l].meshlets);
+
+    free(mr->meshes);
+    memset(mr, 0, sizeof(*mr));
+}
@@ -0,0 +1,303 @@
+/// Meshlets: clusters of neighbouring triangles, each with a bounding sphere and a cone around its normals,
+/// so parts of a large mesh that are off the screen or facing away are skipped before their indices are drawn.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "meshlet.h"
+#include "meshopt.h"
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+
+/// @brief Meshlets being grown over a mesh
+/// @param indices indices of the mesh
+/// @param offsets first entry of every vertex in `adjacent` (one past the last vertex is the end)
+/// @param adjacent triangles around every vertex
+/// @param centroids center of every triangle
+/// @param used whether every triangle is in a meshlet already
+/// @param mark last meshlet every vertex was taken into
+/// @param queued last meshlet every triangle was a candidate of
+/// @param candidates triangles around the current meshlet (some of them taken since)
+/// @param candidates_len number of candidates
+/// @param candidates_cap number of candidates there is room for
+/// @param sorted triangles of the meshlets, in order
+/// @param sorted_len size of sorted array
+typedef struct MeshletBuilder {
+    const uint *indices;
+    uint *offsets, *adjacent;
+    vec3 *centroids;
+    uint8_t *used;
+    uint *mark, *queued;
+    uint *candidates;
+    uint candidates_len, candidates_cap;
+    uint *sorted;
+    uint sorted_len;
+} meshlet_builder;
+
+
+/// @brief Position of vertex `v`
+static const float *position(const void *vertices, const size_t stride, const uint v) {
+    return (const float *)((const char *)vertices + (size_t)v * stride);
+}
+
+/// @brief Add triangle `t` to meshlet `id`, and its neighbours to the candidates
+/// @return number of vertices the meshlet gained
+static uint meshlet_take(meshlet_builder *b, const uint t, const uint id) {
+    b->used[t] = 1;
+    memcpy(b->sorted + b->sorted_len, b->indices + 3 * t, 3 * sizeof(uint));
+    b->sorted_len += 3;
+
+    uint gained = 0;
+    for (uint c = 0; c < 3; c++) {
+        const uint v = b->indices[3 * t + c];
+        if (b->mark[v] != id)
+            b->mark[v] = id, gained++;
+
+        for (uint a = b->offsets[v]; a < b->offsets[v + 1]; a++) {
+            if (b->used[b->adjacent[a]] || b->queued[b->adjacent[a]] == id)
+                continue;
+            b->queued[b->adjacent[a]] = id;
+            if (b->candidates_len == b->candidates_cap) {
+                b->candidates_cap *= 2;
+                b->candidates = realloc(b->candidates, b->candidates_cap * sizeof(uint));
+                if (!b->candidates) {
+                    error("Failed to allocate the meshlets of a mesh.");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            b->candidates[b->candidates_len++] = b->adjacent[a];
+        }
+    }
+    return gained;
+}
+
+/// @brief Candidate that brings the fewest new vertices to meshlet `id` without going over `room`, then the one
+/// nearest to `center` (taken candidates are dropped along the way)
+/// @return the triangle, or `~0u` if none fits
+static uint meshlet_next(meshlet_builder *b, const uint id, const uint room, vec3 const center) {
+    uint best = ~0u, best_new = 4;
+    float best_d = FLT_MAX;
+
+    uint kept = 0;
+    for (uint k = 0; k < b->candidates_len; k++) {
+        const uint t = b->candidates[k];
+        if (b->used[t])
+            continue;
+        b->candidates[kept++] = t;
+
+        uint added = 0;
+        for (uint c = 0; c < 3; c++)
+            added += b->mark[b->indices[3 * t + c]] != id;
+        if (added > room || added > best_new)
+            continue;
+
+        vec3 d;
+        vec3_sub(d, b->centroids[t], center);
+        const float d2 = vec3_mul_inner(d, d);
+        if (added < best_new || d2 < best_d)
+            best = t, best_new = added, best_d = d2;
+    }
+    b->candidates_len = kept;
+    return best;
+}
+
+/// @brief Bounding sphere and normal cone of a meshlet's triangles
+static void meshlet_bounds(meshlet *ml, const void *vertices, const size_t stride, const uint *indices) {
+    vec3 lo, hi;
+    for (uint c = 0; c < ml->indices_len; c++) {
+        const float *p = position(vertices, stride, indices[c]);
+        for (uint l = 0; l < 3; l++) {
+            lo[l] = !c || p[l] < lo[l] ? p[l] : lo[l];
+            hi[l] = !c || p[l] > hi[l] ? p[l] : hi[l];
+        }
+    }
+
+    vec3 center;
+    vec3_add(center, lo, hi);
+    vec3_scale(center, center, 0.5f);
+    float r = 0.0f;
+    for (uint c = 0; c < ml->indices_len; c++) {
+        vec3 d;
+        vec3_sub(d, position(vertices, stride, indices[c]), center);
+        r = fmaxf(r, vec3_len(d));
+    }
+    ml->sphere[0] = center[0], ml->sphere[1] = center[1], ml->sphere[2] = center[2], ml->sphere[3] = r;
+
+    // the axis is the mean of the unit normals (degenerate triangles face nowhere, so they're left out)
+    vec3 normals[MESHLET_TRIANGLES], axis = {0.0f, 0.0f, 0.0f};
+    uint faces = 0;
+    for (uint c = 0; c < ml->indices_len; c += 3) {
+        const float *a = position(vertices, stride, indices[c]);
+        vec3 e1, e2, n;
+        vec3_sub(e1, position(vertices, stride, indices[c + 1]), a);
+        vec3_sub(e2, position(vertices, stride, indices[c + 2]), a);
+        vec3_mul_cross(n, e1, e2);
+        const float len = vec3_len(n);
+        if (len <= 0.0f)
+            continue;
+        vec3_scale(normals[faces], n, 1.0f / len);
+        vec3_add(axis, axis, normals[faces++]);
+    }
+
+    const float len = vec3_len(axis);
+    float spread = -1.0f;
+    if (faces && len > 0.0f) {
+        vec3_scale(axis, axis, 1.0f / len);
+        spread = 1.0f;
+        for (uint f = 0; f < faces; f++)
+            spread = fminf(spread, vec3_mul_inner(axis, normals[f]));
+    }
+
+    // normals more than a right angle apart can't all face away at once
+    ml->cone[0] = axis[0], ml->cone[1] = axis[1], ml->cone[2] = axis[2];
+    ml->cone[3] = spread <= 0.0f ? 1.0f : sqrtf(1.0f - spread * spread);
+}
+
+meshlet *meshlet_build(const uint count, const void *vertices, const size_t stride, const uint m, uint *indices,
+                       uint *len) {
+    *len = 0;
+    if (!meshopt_in_range(count, m, indices))
+        return NULL;
+
+    const uint triangles = m / 3;
+    meshlet_builder b = {
+        .indices = indices,
+        .offsets = calloc(count + 1, sizeof(uint)),
+        .adjacent = malloc((triangles ? 3 * triangles : 1) * sizeof(uint)),
+        .centroids = malloc((triangles ? triangles : 1) * sizeof(vec3)),
+        .used = calloc(triangles ? triangles : 1, 1),
+        .mark = malloc((count ? count : 1) * sizeof(uint)),
+        .queued = malloc((triangles ? triangles : 1) * sizeof(uint)),
+        .candidates = malloc(256 * sizeof(uint)),
+        .candidates_cap = 256,
+        .sorted = malloc((triangles ? 3 * triangles : 1) * sizeof(uint))
+    };
+    uint cap = triangles / MESHLET_TRIANGLES + 16;
+    meshlet *out = malloc(cap * sizeof(meshlet));
+    if (!b.offsets || !b.adjacent || !b.centroids || !b.used || !b.mark || !b.queued || !b.candidates || !b.sorted || !out) {
+        error("Failed to allocate the meshlets of a mesh.");
+        exit(EXIT_FAILURE);
+    }
+
+    // triangles around every vertex (`mark` counts them out first)
+    for (uint c = 0; c < 3 * triangles; c++)
+        b.offsets[indices[c] + 1]++;
+    for (uint v = 0; v < count; v++)
+        b.offsets[v + 1] += b.offsets[v];
+    memcpy(b.mark, b.offsets, count * sizeof(uint));
+    for (uint t = 0; t < triangles; t++) {
+        vec3 sum = {0.0f, 0.0f, 0.0f};
+        for (uint c = 0; c < 3; c++) {
+            b.adjacent[b.mark[indices[3 * t + c]]++] = t;
+            vec3_add(sum, sum, position(vertices, stride, indices[3 * t + c]));
+        }
+        vec3_scale(b.centroids[t], sum, 1.0f / 3.0f);
+    }
+    memset(b.mark, 0xFF, count * sizeof(uint));
+    memset(b.queued, 0xFF, triangles * sizeof(uint));
+
+    // every meshlet starts from the first triangle left, which the vertex cache order keeps near the last one
+    uint n = 0, seed = 0;
+    for (;;) {
+        while (seed < triangles && b.used[seed])
+            seed++;
+        if (seed == triangles)
+            break;
+
+        if (n == cap) {
+            cap *= 2;
+            out = realloc(out, cap * sizeof(meshlet));
+            if (!out) {
+                error("Failed to allocate the meshlets of a mesh.");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        const uint first = b.sorted_len;
+        b.candidates_len = 0;
+        uint verts = meshlet_take(&b, seed, n), tris = 1;
+        vec3 sum;
+        vec3_dup(sum, b.centroids[seed]);
+
+        while (tris < MESHLET_TRIANGLES) {
+            vec3 center;
+            vec3_scale(center, sum, 1.0f / tris);
+            const uint t = meshlet_next(&b, n, MESHLET_VERTICES - verts, center);
+            if (t == ~0u)
+                break;
+            verts += meshlet_take(&b, t, n);
+            vec3_add(sum, sum, b.centroids[t]);
+            tris++;
+        }
+
+        meshlet *ml = &out[n++];
+        ml->first = first;
+        ml->indices_len = b.sorted_len - first;
+        meshlet_bounds(ml, vertices, stride, b.sorted + first);
+    }
+
+    memcpy(indices, b.sorted, 3 * triangles * sizeof(uint));
+    free(b.offsets);
+    free(b.adjacent);
+    free(b.centroids);
+    free(b.used);
+    free(b.mark);
+    free(b.queued);
+    free(b.candidates);
+    free(b.sorted);
+
+    *len = n;
+    return out;
+}
+
+/// @brief Whether a sphere is at least partly on the inner side of every plane
+static int sphere_inside(const vec4 planes[6], const float lens[6], vec4 const sphere) {
+    for (uint p = 0; p < 6; p++)
+        if (vec3_mul_inner(planes[p], sphere) + planes[p][3] < -sphere[3] * lens[p])
+            return 0;
+    return 1;
+}
+
+uint meshlet_cull(const meshlet *meshlets, const uint len, vec4 const sphere, mat4x4 const modelview,
+                  mat4x4 const clip, uint *visible) {
+    // frustum planes from the rows of the clip matrix (Gribb and Hartmann), in object space, so
+    // the spheres are tested as they are even under a non-uniform scale
+    vec4 planes[6];
+    float lens[6];
+    for (uint i = 0; i < 3; i++)
+        for (uint l = 0; l < 4; l++) {
+            planes[2 * i][l] = clip[l][3] + clip[l][i];
+            planes[2 * i + 1][l] = clip[l][3] - clip[l][i];
+        }
+    for (uint p = 0; p < 6; p++)
+        lens[p] = vec3_len(planes[p]);
+
+    if (!sphere_inside(planes, lens, sphere))
+        return 0;
+
+    // the camera in object space (facing is kept by any transform that doesn't mirror, which turns
+    // back faces into front faces instead)
+    mat4x4 inv;
+    mat4x4_invert(inv, (vec4 *)modelview);
+    vec3 c12;
+    vec3_mul_cross(c12, modelview[1], modelview[2]);
+    const int facing = vec3_mul_inner(modelview[0], c12) > 0.0f;
+
+    uint n = 0;
+    for (uint j = 0; j < len; j++) {
+        const meshlet *ml = &meshlets[j];
+        if (!sphere_inside(planes, lens, ml->sphere))
+            continue;
+
+        // every direction from the camera to the sphere is within a right angle of every normal of the cone
+        if (facing && ml->cone[3] < 1.0f) {
+            vec3 d;
+            vec3_sub(d, ml->sphere, inv[3]);
+            if (vec3_mul_inner(d, ml->cone) >= ml->cone[3] * vec3_len(d) + ml->sphere[3])
+                continue;
+        }
+        visible[n++] = j;
+    }
+    return n;
+}
@@ -0,0 +1,387 @@
+/// Index buffer optimization: triangles reordered for the post-transform vertex cache (Tipsify), clusters of
+/// them sorted so the outward-facing ones are drawn first (less overdraw), and vertices renumbered in the
+/// order they are first used (fetch locality), with the cache simulated before and after to measure the gain.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "meshopt.h"
+#include <string.h>
+
+
+// no vertex (an empty dead-end stack, or a vertex not yet renumbered)
+#define MESHOPT_NONE_VERTEX (~0u)
+
+
+const char *MESHOPT_MODE_NAMES[MESHOPT_MODE_COUNT] = {"none", "cache", "overdraw"};
+
+
+/// @brief Triangles around every vertex, and what Tipsify knows of them
+/// @param offsets first entry of every vertex in `adjacent` (one more than there are vertices)
+/// @param adjacent triangles around each vertex, one vertex after the other
+/// @param live triangles around every vertex not yet emitted
+/// @param stamps time every vertex last entered the cache
+/// @param emitted whether every triangle was emitted
+/// @param dead vertices of the emitted triangles, the most recent last (the dead-end stack)
+/// @param candidates vertices of the triangles emitted around the current fan
+typedef struct Tipsify {
+    uint *offsets, *adjacent, *live, *stamps;
+    uint8_t *emitted;
+    uint *dead, *candidates;
+} tipsify;
+
+/// @brief Cluster of triangles, and where it goes in the draw order
+/// @param key how much the cluster faces away from the mesh's center
+/// @param first first triangle of the cluster
+/// @param len number of triangles
+typedef struct MeshoptCluster {
+    float key;
+    uint first, len;
+} meshopt_cluster;
+
+
+static void *meshopt_alloc(const size_t bytes) {
+    void *p = malloc(bytes ? bytes : 1);
+    if (!p) {
+        error("Failed to allocate the mesh optimization.");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/// @brief Whether a vertex misses the cache at time `*t` (the count of misses so far, plus the cache size),
+/// putting it in if so (a FIFO cache only ages on misses, so entries older than the cache size are gone)
+static uint cache_miss(uint *stamps, uint *t, const uint v) {
+    if (*t - stamps[v] < MESHOPT_CACHE)
+        return 0;
+    stamps[v] = (*t)++;
+    return 1;
+}
+
+uint meshopt_misses(const uint count, const uint m, const uint *indices) {
+    uint *stamps = meshopt_alloc(count * sizeof(uint));
+    memset(stamps, 0, count * sizeof(uint));
+
+    uint t = MESHOPT_CACHE, misses = 0;
+    for (uint c = 0; c < m; c++)
+        misses += cache_miss(stamps, &t, indices[c]);
+
+    free(stamps);
+    return misses;
+}
+
+/// @brief Next vertex to fan around: the candidate that entered the cache last and will still be in it once its
+/// remaining triangles are emitted, or any candidate with triangles left, or else the last dead end with
+/// triangles left, or else the next such vertex in order
+/// @return the vertex, or `MESHOPT_NONE_VERTEX` when every triangle was emitted (`*jumped` tells whether
+/// the vertex came from the dead-end stack or the cursor, so the cache is cold there)
+static uint tipsify_next(tipsify *ts, const uint candidates, uint *dead, uint *cursor, const uint count, const uint s,
+                         int *jumped) {
+    uint best = MESHOPT_NONE_VERTEX;
+    int best_priority = -1;
+    for (uint i = 0; i < candidates; i++) {
+        const uint v = ts->candidates[i];
+        if (!ts->live[v])
+            continue;
+
+        int priority = 0;
+        if (s - ts->stamps[v] + 2 * ts->live[v] <= MESHOPT_CACHE)
+            priority = s - ts->stamps[v];
+        if (priority > best_priority)
+            best = v, best_priority = priority;
+    }
+    *jumped = best == MESHOPT_NONE_VERTEX;
+    if (best != MESHOPT_NONE_VERTEX)
+        return best;
+
+    while (*dead) {
+        const uint v = ts->dead[--*dead];
+        if (ts->live[v])
+            return v;
+    }
+    for (; *cursor < count; (*cursor)++)
+        if (ts->live[*cursor])
+            return (*cursor)++;
+    return MESHOPT_NONE_VERTEX;
+}
+
+/// @brief Reorder the triangles for a FIFO cache of `MESHOPT_CACHE` entries (Sander, Nehab and Barczak, "Fast
+/// Triangle Reordering for Vertex Locality and Reduced Overdraw"): fan around a vertex, then move on to
+/// the vertex of the fan that is still in the cache, jumping back to a dead end only when there is none
+/// @param count number of vertices
+/// @param m size of indices array
+/// @param indices indices array
+/// @param out reordered indices
+/// @param starts first triangle of every cluster that starts with a cold cache
+/// @return number of clusters
+static uint tipsify_run(const uint count, const uint m, const uint *indices, uint *out, uint *starts) {
+    const uint t = m / 3;
+    tipsify ts = {
+        meshopt_alloc((count + 1) * sizeof(uint)), meshopt_alloc(m * sizeof(uint)),
+        meshopt_alloc(count * sizeof(uint)), meshopt_alloc(count * sizeof(uint)),
+        meshopt_alloc(t), meshopt_alloc(m * sizeof(uint)), meshopt_alloc(m * sizeof(uint))
+    };
+    memset(ts.live, 0, count * sizeof(uint));
+    memset(ts.stamps, 0, count * sizeof(uint));
+    memset(ts.emitted, 0, t);
+
+    // triangles around every vertex, in a prefix sum of the corners
+    for (uint c = 0; c < m; c++)
+        ts.live[indices[c]]++;
+    ts.offsets[0] = 0;
+    for (uint v = 0; v < count; v++)
+        ts.offsets[v + 1] = ts.offsets[v] + ts.live[v];
+    for (uint c = 0; c < m; c++)
+        ts.adjacent[ts.offsets[indices[c]]++] = c / 3;
+    for (uint v = count; v > 0; v--)
+        ts.offsets[v] = ts.offsets[v - 1];
+    ts.offsets[0] = 0;
+
+    uint s = MESHOPT_CACHE + 1, dead = 0, cursor = 0, emitted = 0, clusters = 0;
+    int jumped = 1;
+    for (uint f = 0; f != MESHOPT_NONE_VERTEX && emitted < t;) {
+        // the first vertex may have had no triangles, which leaves the cluster it started empty
+        if (jumped && (!clusters || starts[clusters - 1] != emitted))
+            starts[clusters++] = emitted;
+
+        // emit every triangle left around the fan's vertex
+        uint candidates = 0;
+        for (uint a = ts.offsets[f]; a < ts.offsets[f + 1]; a++) {
+            const uint tri = ts.adjacent[a];
+            if (ts.emitted[tri])
+                continue;
+
+            for (uint l = 0; l < 3; l++) {
+                const uint v = indices[3 * tri + l];
+                ts.dead[dead++] = v;
+                ts.candidates[candidates++] = v;
+                ts.live[v]--;
+                if (s - ts.stamps[v] > MESHOPT_CACHE)
+                    ts.stamps[v] = s++;
+            }
+            memcpy(out + 3 * emitted++, indices + 3 * tri, 3 * sizeof(uint));
+            ts.emitted[tri] = 1;
+        }
+
+        f = tipsify_next(&ts, candidates, &dead, &cursor, count, s, &jumped);
+    }
+
+    free(ts.offsets);
+    free(ts.adjacent);
+    free(ts.live);
+    free(ts.stamps);
+    free(ts.emitted);
+    free(ts.dead);
+    free(ts.candidates);
+    return clusters;
+}
+
+/// @brief Split clusters where the misses per triangle so far come within `MESHOPT_THRESHOLD` of the whole
+/// cluster's, so there are more of them to sort without losing much of the cache's gain
+/// @param count number of vertices
+/// @param indices indices array
+/// @param t number of triangles
+/// @param starts first triangle of every cluster (room for one per triangle)
+/// @param clusters number of clusters
+/// @return number of clusters once split
+static uint meshopt_split(const uint count, const uint *indices, const uint t, uint *starts, const uint clusters) {
+    uint *stamps = meshopt_alloc(count * sizeof(uint));
+    uint *hard = meshopt_alloc(clusters * sizeof(uint));
+    memset(stamps, 0, count * sizeof(uint));
+    memcpy(hard, starts, clusters * sizeof(uint));
+
+    uint time = MESHOPT_CACHE, len = 0;
+    for (uint k = 0; k < clusters; k++) {
+        const uint first = hard[k], end = k + 1 < clusters ? hard[k + 1] : t;
+
+        // the cluster's own misses, from a cold cache (as each cluster may come after any other)
+        time += MESHOPT_CACHE;
+        uint misses = 0;
+        for (uint c = 3 * first; c < 3 * end; c++)
+            misses += cache_miss(stamps, &time, indices[c]);
+        const float threshold = MESHOPT_THRESHOLD * misses / (end - first);
+
+        // every split starts from a cold cache too, so each cluster reaches the threshold on its own
+        time += MESHOPT_CACHE;
+        starts[len++] = first;
+        uint run_misses = 0, run = 0;
+        for (uint tri = first; tri < end; tri++) {
+            for (uint l = 0; l < 3; l++)
+                run_misses += cache_miss(stamps, &time, indices[3 * tri + l]);
+            run++;
+            if (tri + 1 < end && run_misses <= threshold * run) {
+                starts[len++] = tri + 1;
+                time += MESHOPT_CACHE;
+                run_misses = run = 0;
+            }
+        }
+    }
+
+    free(stamps);
+    free(hard);
+    return len;
+}
+
+/// @brief Clusters facing outward first, then in their own order
+static int cmp_cluster(const void *a, const void *b) {
+    const meshopt_cluster *x = a, *y = b;
+    if (x->key != y->key)
+        return x->key > y->key ? -1 : 1;
+    return x->first < y->first ? -1 : x->first > y->first;
+}
+
+/// @brief Sort the clusters so the ones facing away from the mesh's center are drawn first, as they are
+/// the most likely to hide the others
+/// @param vertices vertices array, whose first three floats are the position
+/// @param stride size of a vertex, in bytes
+/// @param indices indices array, rewritten in the order of the clusters
+/// @param t number of triangles
+/// @param starts first triangle of every cluster
+/// @param clusters number of clusters
+static void meshopt_sort(const void *vertices, const size_t stride, uint *indices, const uint t, const uint *starts,
+                         const uint clusters) {
+#define POSITION(v) ((const float *)((const char *)vertices + (size_t)(v) * stride))
+    meshopt_cluster *order = meshopt_alloc(clusters * sizeof(meshopt_cluster));
+
+    // the center of the mesh weighs every corner alike
+    vec3 center = {0.0f, 0.0f, 0.0f};
+    for (uint c = 0; c < 3 * t; c++)
+        vec3_add(center, center, POSITION(indices[c]));
+    vec3_scale(center, center, 1.0f / (3 * t));
+
+    for (uint k = 0; k < clusters; k++) {
+        const uint end = k + 1 < clusters ? starts[k + 1] : t;
+
+        // centroids weighed by area, and the sum of the (area-scaled) face normals
+        vec3 centroid = {0.0f, 0.0f, 0.0f}, normal = {0.0f, 0.0f, 0.0f};
+        float area = 0.0f;
+        for (uint tri = starts[k]; tri < end; tri++) {
+            const float *p0 = POSITION(indices[3 * tri]), *p1 = POSITION(indices[3 * tri + 1]);
+            const float *p2 = POSITION(indices[3 * tri + 2]);
+            vec3 e1, e2, n, mid;
+            vec3_sub(e1, p1, p0);
+            vec3_sub(e2, p2, p0);
+            vec3_mul_cross(n, e1, e2);
+            const float a = vec3_len(n);
+
+            vec3_add(mid, p0, p1);
+            vec3_add(mid, mid, p2);
+            vec3_scale(mid, mid, a / 3.0f);
+            vec3_add(centroid, centroid, mid);
+            vec3_add(normal, normal, n);
+            area += a;
+        }
+
+        const float len = vec3_len(normal);
+        vec3 d;
+        vec3_scale(centroid, centroid, area > 0.0f ? 1.0f / area : 0.0f);
+        vec3_sub(d, centroid, center);
+        order[k] = (meshopt_cluster) {
+            len > 0.0f ? vec3_mul_inner(d, normal) / len : 0.0f, starts[k], end - starts[k]
+        };
+    }
+#undef POSITION
+
+    qsort(order, clusters, sizeof(meshopt_cluster), cmp_cluster);
+
+    uint *copy = meshopt_alloc(3 * (size_t)t * sizeof(uint));
+    memcpy(copy, indices, 3 * (size_t)t * sizeof(uint));
+    uint *out = indices;
+    for (uint k = 0; k < clusters; k++) {
+        memcpy(out, copy + 3 * (size_t)order[k].first, 3 * (size_t)order[k].len * sizeof(uint));
+        out += 3 * order[k].len;
+    }
+
+    free(copy);
+    free(order);
+}
+
+/// @brief Renumber the vertices in the order the indices first use them (those never used go last), so
+/// vertices are fetched front to back
+static void meshopt_fetch(const uint count, void *vertices, const size_t stride, const uint m, uint *indices) {
+    uint *remap = meshopt_alloc(count * sizeof(uint));
+    memset(remap, 0xFF, count * sizeof(uint));
+
+    uint next = 0;
+    for (uint c = 0; c < m; c++) {
+        if (remap[indices[c]] == MESHOPT_NONE_VERTEX)
+            remap[indices[c]] = next++;
+        indices[c] = remap[indices[c]];
+    }
+    for (uint v = 0; v < count; v++)
+        if (remap[v] == MESHOPT_NONE_VERTEX)
+            remap[v] = next++;
+
+    char *copy = meshopt_alloc(count * stride);
+    memcpy(copy, vertices, count * stride);
+    for (uint v = 0; v < count; v++)
+        memcpy((char *)vertices + remap[v] * stride, copy + v * stride, stride);
+
+    free(copy);
+    free(remap);
+}
+
+int meshopt_in_range(const uint count, const uint m, const uint *indices) {
+    for (uint c = 0; c < m; c++)
+        if (indices[c] >= count)
+            return 0;
+    return 1;
+}
+
+/// @brief Whether the indices make triangles that all index within the vertices (indices out of range are
+/// left for GL to reject, rather than read out of the arrays here)
+static int meshopt_valid(const meshopt_mode mode, const uint count, const uint m, const uint *indices) {
+    return mode != MESHOPT_NONE && m >= 3 && !(m % 3) && meshopt_in_range(count, m, indices);
+}
+
+/// @brief Reorder the triangles
+/// @return number of clusters
+static uint meshopt_reorder(const meshopt_mode mode, const uint count, const void *vertices, const size_t stride,
+                            const uint m, uint *indices) {
+    const uint t = m / 3;
+    uint *out = meshopt_alloc(m * sizeof(uint));
+    uint *starts = meshopt_alloc(t * sizeof(uint));
+    uint clusters = tipsify_run(count, m, indices, out, starts);
+    memcpy(indices, out, m * sizeof(uint));
+    if (mode == MESHOPT_OVERDRAW) {
+        clusters = meshopt_split(count, indices, t, starts, clusters);
+        meshopt_sort(vertices, stride, indices, t, starts, clusters);
+    }
+    free(out);
+    free(starts);
+    return clusters;
+}
+
+uint meshopt_triangles(const meshopt_mode mode, const uint count, const void *vertices, const size_t stride,
+                       const uint m, uint *indices) {
+    if (!meshopt_valid(mode, count, m, indices))
+        return 0;
+    return meshopt_reorder(mode, count, vertices, stride, m, indices);
+}
+
+void meshopt_optimize(const meshopt_mode mode, const uint count, void *vertices, const size_t stride, const uint m,
+                      uint *indices, meshopt_stats *stats) {
+    if (!meshopt_valid(mode, count, m, indices))
+        return;
+
+    const uint t = m / 3;
+    const uint before = stats ? meshopt_misses(count, m, indices) : 0;
+    const uint clusters = meshopt_reorder(mode, count, vertices, stride, m, indices);
+    meshopt_fetch(count, vertices, stride, m, indices);
+
+    if (stats) {
+        stats->meshes++;
+        stats->triangles += t;
+        stats->vertices += count;
+        stats->misses_before += before;
+        stats->misses_after += meshopt_misses(count, m, indices);
+        stats->clusters += mode == MESHOPT_OVERDRAW ? clusters : 0;
+    }
+}
+
+void meshopt_json(const meshopt_mode mode, const meshopt_stats *st, FILE *out) {
+    const double t = st->triangles ? st->triangles : 1, v = st->vertices ? st->vertices : 1;
+    fprintf(out, "{\"mode\": \"%s\", \"meshes\": %u, \"triangles\": %lu, \"clusters\": %lu, \"short_meshes\": %u, "
+            "\"acmr\": [%.3f, %.3f], \"atvr\": [%.3f, %.3f]}",
+            MESHOPT_MODE_NAMES[mode], st->meshes, (unsigned long)st->triangles, (unsigned long)st->clusters,
+            st->short_meshes, st->misses_before / t, st->misses_after / t, st->misses_before / v, st->misses_after / v);
+}
@@ -0,0 +1,286 @@
+/// Normal generation for indexed meshes: flat normals, or smooth ones weighted by the area or the
+/// corner angle of every triangle around a vertex, shared across vertices welded by position.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "normals.h"
+#include "simd.h"
+#include <stdint.h>
+#include <string.h>
+
+
+// free slot of the weld's hash map
+#define WELD_EMPTY (~0u)
+
+// triangles whose face normals are kept on the stack while flat normals are spread to their corners
+#define NORMALS_BLOCK 256
+
+
+const char *NORMAL_MODE_NAMES[NORMALS_MODE_COUNT] = {"flat", "area", "angle"};
+
+
+/// @brief Slot of the weld's hash map
+/// @param cell grid cell of the vertex (counted from the smallest corner of the mesh's bounding box)
+/// @param vertex first vertex seen at its position (`WELD_EMPTY` for a free slot)
+typedef struct WeldSlot {
+    int32_t cell[3];
+    uint vertex;
+} weld_slot;
+
+/// @brief Normals split between threads
+/// @param positions vertex positions
+/// @param indices indices array (`NULL` when every three vertices form a triangle)
+/// @param corners position of every corner of flat normals
+/// @param normals normal of every vertex (or corner, for flat normals)
+/// @param faces normal of every triangle (scaled by its area, or unit length when weighed by angle)
+/// @param weights angle of every corner (`NULL` when weighed by area)
+/// @param remap welded vertex of every vertex
+/// @param welded welded vertex of every corner
+/// @param offsets first corner of every welded vertex in `adjacent`
+/// @param adjacent corners around each welded vertex, one vertex after the other
+typedef struct NormalsJob {
+    const vec3 *positions;
+    const uint *indices;
+    vec3 *corners, *normals, *faces;
+    float *weights;
+    const uint *remap;
+    uint *welded;
+    const uint *offsets, *adjacent;
+} normals_job;
+
+
+static void *normals_alloc(const size_t bytes) {
+    void *p = malloc(bytes ? bytes : 1);
+    if (!p) {
+        error("Failed to allocate the normals.");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/// @brief Run a loop on the pool, or on the calling thread without one
+static void normals_run(job_pool *jobs, job_fn fn, normals_job *job, const uint len) {
+    if (jobs)
+        jobs_run(jobs, fn, job, len, NORMALS_GRAIN);
+    else if (len)
+        fn(job, 0, len);
+}
+
+static inline uint weld_hash(const int32_t *cell) {
+    const uint h = (uint)cell[0] * 73856093u ^ (uint)cell[1] * 19349663u ^ (uint)cell[2] * 83492791u;
+    return h ^ h >> 16;
+}
+
+/// @brief Look a position up in one cell of the map
+/// @return the vertex welded to, or `WELD_EMPTY`
+static uint weld_find(const weld_slot *slots, const uint mask, const int32_t *cell, const vec3 *positions,
+                      const float *p, const float eps2) {
+    for (uint h = weld_hash(cell) & mask; slots[h].vertex != WELD_EMPTY; h = (h + 1) & mask) {
+        if (memcmp(slots[h].cell, cell, sizeof(slots[h].cell)))
+            continue;
+        vec3 d;
+        vec3_sub(d, positions[slots[h].vertex], p);
+        if (vec3_mul_inner(d, d) <= eps2)
+            return slots[h].vertex;
+    }
+    return WELD_EMPTY;
+}
+
+uint normals_weld(const uint n, const vec3 *positions, uint *remap) {
+    if (!n)
+        return 0;
+
+    // the tolerance follows the size of the mesh
+    vec3 lo, hi;
+    vec3_dup(lo, positions[0]);
+    vec3_dup(hi, positions[0]);
+    for (uint v = 1; v < n; v++) {
+        vec3_min(lo, lo, positions[v]);
+        vec3_max(hi, hi, positions[v]);
+    }
+    float extent = 0.0f;
+    for (uint l = 0; l < 3; l++)
+        extent = fmaxf(extent, hi[l] - lo[l]);
+    const float eps = NORMALS_WELD_TOLERANCE * extent;
+
+    // cells four times the tolerance wide, so a close position is at most one cell away (and only
+    // when the position is within a quarter of a cell of the side), and a mesh is at most 25000 cells wide
+    const float cell_len = eps > 0.0f ? 4.0f * eps : 1.0f;
+
+    // open addressing, at most half full
+    uint cap = 16;
+    while (cap < 2 * n)
+        cap *= 2;
+    weld_slot *slots = normals_alloc(cap * sizeof(weld_slot));
+    for (uint h = 0; h < cap; h++)
+        slots[h].vertex = WELD_EMPTY;
+
+    uint distinct = 0;
+    for (uint v = 0; v < n; v++) {
+        const float *p = positions[v];
+        int32_t cell[3];
+        int from[3], to[3];
+        for (uint l = 0; l < 3; l++) {
+            const float q = (p[l] - lo[l]) / cell_len, c = floorf(q);
+            cell[l] = (int32_t)c;
+            from[l] = q - c < 0.25f ? -1 : 0;
+            to[l] = q - c > 0.75f ? 1 : 0;
+        }
+
+        // the cell itself, then the neighbours the position is close to
+        uint match = weld_find(slots, cap - 1, cell, positions, p, eps * eps);
+        for (int x = from[0]; x <= to[0] && match == WELD_EMPTY; x++)
+            for (int y = from[1]; y <= to[1] && match == WELD_EMPTY; y++)
+                for (int z = from[2]; z <= to[2] && match == WELD_EMPTY; z++)
+                    if (x || y || z) {
+                        const int32_t near[3] = {cell[0] + x, cell[1] + y, cell[2] + z};
+                        match = weld_find(slots, cap - 1, near, positions, p, eps * eps);
+                    }
+
+        if (match != WELD_EMPTY) {
+            remap[v] = match;
+            continue;
+        }
+
+        // a new position
+        uint h = weld_hash(cell) & (cap - 1);
+        while (slots[h].vertex != WELD_EMPTY)
+            h = (h + 1) & (cap - 1);
+        memcpy(slots[h].cell, cell, sizeof(cell));
+        slots[h].vertex = v;
+        remap[v] = v;
+        distinct++;
+    }
+
+    free(slots);
+    return distinct;
+}
+
+static void flat_range(void *ctx, const uint first, const uint count) {
+    const normals_job *job = ctx;
+    const vec3 *positions = job->positions;
+    const uint *indices = job->indices;
+    vec3 *corners = job->corners, *normals = job->normals;
+
+    // a block of face normals at a time, spread to the three corners of each
+    vec3 faces[NORMALS_BLOCK];
+    for (uint b = 0; b < count; b += NORMALS_BLOCK) {
+        const uint t = first + b, len = count - b < NORMALS_BLOCK ? count - b : NORMALS_BLOCK;
+        if (indices)
+            simd.tri_normals(faces, positions, indices + 3 * t, len, 1);
+        else
+            simd.tri_normals(faces, positions + 3 * t, NULL, len, 1);
+
+        for (uint i = 0; i < len; i++) {
+            const uint c = 3 * (t + i);
+            vec3_dup(normals[c], faces[i]);
+            vec3_dup(normals[c + 1], faces[i]);
+            vec3_dup(normals[c + 2], faces[i]);
+        }
+        if (corners)
+            for (uint c = 3 * t; c < 3 * (t + len); c++)
+                vec3_dup(corners[c], positions[indices[c]]);
+    }
+}
+
+void normals_flat(job_pool *jobs, const uint m, const vec3 *positions, const uint *indices, vec3 *corners, vec3 *normals) {
+    normals_job job = {positions, indices, indices ? corners : NULL, normals};
+    normals_run(jobs, flat_range, &job, m / 3);
+}
+
+static void weld_range(void *ctx, const uint first, const uint count) {
+    const normals_job *job = ctx;
+    for (uint c = first; c < first + count; c++)
+        job->welded[c] = job->remap[job->indices ? job->indices[c] : c];
+}
+
+static void face_range(void *ctx, const uint first, const uint count) {
+    const normals_job *job = ctx;
+    const uint *welded = job->welded;
+    simd.tri_normals(job->faces + first, job->positions, welded + 3 * first, count, job->weights != NULL);
+
+    if (!job->weights)
+        return;
+
+    // the angle of every corner, between the sides to the other two
+    for (uint c = 3 * first; c < 3 * (first + count); c++) {
+        const uint t = c - c % 3;
+        const float *p = job->positions[welded[c]];
+        vec3 u, v;
+        vec3_sub(u, job->positions[welded[t + (c + 1) % 3]], p);
+        vec3_sub(v, job->positions[welded[t + (c + 2) % 3]], p);
+
+        const float len = vec3_len(u) * vec3_len(v);
+        const float cosine = len > 0.0f ? vec3_mul_inner(u, v) / len : 1.0f;
+        job->weights[c] = acosf(fminf(fmaxf(cosine, -1.0f), 1.0f));
+    }
+}
+
+static void gather_range(void *ctx, const uint first, const uint count) {
+    const normals_job *job = ctx;
+    for (uint v = first; v < first + count; v++) {
+        if (job->remap[v] != v)
+            continue;
+
+        // every corner at the position, in the order of the triangles (so the sums don't depend on the threads)
+        vec3 sum = {0.0f, 0.0f, 0.0f};
+        for (uint a = job->offsets[v]; a < job->offsets[v + 1]; a++) {
+            const uint c = job->adjacent[a];
+            vec3 w;
+            vec3_scale(w, job->faces[c / 3], job->weights ? job->weights[c] : 1.0f);
+            vec3_add(sum, sum, w);
+        }
+
+        const float len = vec3_len(sum);
+        vec3_scale(job->normals[v], sum, len > 0.0f ? 1.0f / len : 0.0f);
+    }
+}
+
+static void copy_range(void *ctx, const uint first, const uint count) {
+    const normals_job *job = ctx;
+    for (uint v = first; v < first + count; v++)
+        if (job->remap[v] != v)
+            vec3_dup(job->normals[v], job->normals[job->remap[v]]);
+}
+
+void normals_smooth(job_pool *jobs, const normal_mode mode, const uint n, const vec3 *positions, const uint m,
+                    const uint *indices, vec3 *normals) {
+    const uint t = m / 3;
+    uint *remap = normals_alloc(n * sizeof(uint));
+    uint *offsets = normals_alloc((n + 1) * sizeof(uint));
+    uint *adjacent = normals_alloc(3 * t * sizeof(uint));
+    normals_job job = {
+        positions, indices, NULL, normals, normals_alloc(t * sizeof(vec3)),
+        mode == NORMALS_ANGLE ? normals_alloc(3 * t * sizeof(float)) : NULL,
+        remap, normals_alloc(3 * t * sizeof(uint)), offsets, adjacent
+    };
+
+    // hashing positions into the map is the only part left on the calling thread
+    normals_weld(n, positions, remap);
+    normals_run(jobs, weld_range, &job, 3 * t);
+
+    // triangles read their welded corners, so slivers between positions welded together count for nothing
+    normals_run(jobs, face_range, &job, t);
+
+    // the corners around every welded vertex, counted, then placed in order of their triangles
+    memset(offsets, 0, (n + 1) * sizeof(uint));
+    for (uint c = 0; c < 3 * t; c++)
+        offsets[job.welded[c] + 1]++;
+    for (uint v = 0; v < n; v++)
+        offsets[v + 1] += offsets[v];
+    for (uint c = 0; c < 3 * t; c++)
+        adjacent[offsets[job.welded[c]]++] = c;
+    memmove(offsets + 1, offsets, n * sizeof(uint));
+    offsets[0] = 0;
+
+    // welded vertices read the normal of the vertex they're welded to, once that one is done
+    normals_run(jobs, gather_range, &job, n);
+    normals_run(jobs, copy_range, &job, n);
+
+    free(job.faces);
+    free(job.weights);
+    free(job.welded);
+    free(remap);
+    free(offsets);
+    free(adjacent);
+}
@@ -0,0 +1,266 @@
+/// Command-line options.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "opts.h"
+#include <ctype.h>
+#include <getopt.h>
+#include <string.h>
+
+
+/// @brief Print usage information
+static void usage(FILE *out, const char *name) {
+    fprintf(out,
+            "Usage: %s [options]\n"
+            "\n"
+            "Options:\n"
+            "  -r, --report SECONDS   interval between frame-time reports (default 1, 0 disables)\n"
+            "  -H, --headless         render offscreen (EGL surfaceless) without vsync, then print a JSON summary\n"
+            "  -n, --frames N         render N frames, then exit (default 0 = until closed, 1000 when headless)\n"
+            "  -s, --size WxH         framebuffer size (default half the monitor, 1280x720 when headless)\n"
+            "  -m, --samples N        number of MSAA samples (default 8)\n"
+            "  -T, --threads N        threads working on the loops over every object (default 0 = one per core)\n"
+            "  -h, --help             show this message\n"
+            "\n"
+            "Scene:\n"
+            "  -o, --objects N        number of objects, 1 to 1000000 (default 1)\n"
+            "  -l, --layout LAYOUT    grid, random or clustered (default grid)\n"
+            "  -g, --mesh MESH        cube, sphere or mixed (default cube)\n"
+            "  -d, --detail N         segments around the largest spheres (default 16)\n"
+            "  -S, --seed N           seed of the random layouts and meshes (default 1)\n"
+            "  -f, --file PATH        load a scene file (see `objconv`), or import an OBJ or PLY file, instead of generating a scene\n"
+            "  -O, --optimize MODE    none, cache (triangles reordered for the vertex cache, vertices for fetching)\n"
+            "                         or overdraw (then outward-facing clusters first) (default overdraw)\n"
+            "  -V, --vertex FORMAT    f32, f16-oct16, s16-oct16 or s16-oct8 (positions, then octahedral normals;\n"
+            "                         24, 12, 12 and 8 bytes per vertex) (default f32)\n"
+            "  -L, --lods N           simplified versions of meshes of %u triangles or more, each with a quarter\n"
+            "                         of the triangles of the one before, 0 to %u (default %u)\n"
+            "\n"
+            "Rendering:\n"
+            "  -D, --draw MODE        loop (one draw per object), instanced (one per mesh)\n"
+            "                         or mdi (one multi-draw-indirect per program and mode) (default loop)\n"
+            "  -Q, --order ORDER      state (objects of a program sorted by mode and mesh, into runs) or front\n"
+            "                         (nearest first, for early depth rejection, sorted every frame) (default state)\n"
+            "  -C, --cull MODE        none, gpu (frustum culling in a compute pass, needs --draw mdi)\n"
+            "                         or cpu (bounding-volume hierarchy on the CPU) (default none)\n"
+            "  -z, --hiz MODE         off, on (also skip objects hidden behind the last frame's depth, needs\n"
+            "                         --cull gpu) or show (and draw the depth pyramid, up and down pick the level)\n"
+            "                         (default off)\n"
+            "  -c, --clusters         split meshes (and simplified versions) of %u triangles or more into meshlets of\n"
+            "                         up to %u vertices and %u triangles, and skip those out of the view or facing\n"
+            "                         away on the CPU\n"
+            "  -G, --gl-trace         count the GL calls, the bytes they upload and the time spent in them per frame\n"
+            "                         (needs a profiling build, `make profile`; G switches it in the window)\n"
+            "  -B, --bench-bvh        time building, refitting and querying the hierarchy, print JSON, then exit\n"
+            "  -K, --bench-kernels    time and check the SIMD matrix kernels against the scalar ones, print JSON,\n"
+            "                         then exit (with an error if any is outside of the tolerance)\n",
+            name, LOD_MIN_TRIANGLES, LOD_MAX, LOD_DEFAULT, MESHLET_MIN_TRIANGLES, MESHLET_VERTICES, MESHLET_TRIANGLES);
+}
+
+/// @brief Parse a non-negative floating-point argument, exiting on failure
+static double parse_double(const char *opt, const char *arg) {
+    char *end;
+    const double v = strtod(arg, &end);
+    if (end == arg || *end || v < 0.0) {
+        fprintf(stderr, "Error: invalid value for %s: '%s'\n", opt, arg);
+        exit(EXIT_FAILURE);
+    }
+    return v;
+}
+
+/// @brief Parse an unsigned integer argument, exiting on failure
+static uint parse_uint(const char *opt, const char *arg) {
+    char *end;
+    const unsigned long v = strtoul(arg, &end, 10);
+    if (end == arg || *end || *arg == '-' || v > 0xFFFFFFFFul) {
+        fprintf(stderr, "Error: invalid value for %s: '%s'\n", opt, arg);
+        exit(EXIT_FAILURE);
+    }
+    return v;
+}
+
+/// @brief Parse a `WxH` size argument, exiting on failure
+static void parse_size(const char *arg, uint *w, uint *h) {
+    // digits only on either side of the `x` (strtoul would take signs and spaces)
+    char *x, *end;
+    const unsigned long width = strtoul(arg, &x, 10);
+    const unsigned long height = *x == 'x' ? strtoul(x + 1, &end, 10) : 0;
+    if (!isdigit((unsigned char)*arg) || *x != 'x' || !isdigit((unsigned char)x[1]) || *end || !width ||
+        !height || width > 0xFFFFFFFFul || height > 0xFFFFFFFFul) {
+        fprintf(stderr, "Error: invalid value for --size: '%s'\n", arg);
+        exit(EXIT_FAILURE);
+    }
+    *w = width, *h = height;
+}
+
+/// @brief Look an argument up in a list of names, exiting on failure
+static uint parse_name(const char *opt, const char *arg, const char **names, const uint n) {
+    for (uint i = 0; i < n; i++)
+        if (!strcmp(arg, names[i]))
+            return i;
+
+    fprintf(stderr, "Error: invalid value for %s: '%s'\n", opt, arg);
+    exit(EXIT_FAILURE);
+}
+
+options parse_opts(int argc, char **argv) {
+    options o = {
+        .report = 1.0,
+        .samples = 8,
+        .optimize = MESHOPT_OVERDRAW,
+        .lods = LOD_DEFAULT,
+        .scene = {
+            .objects = 1,
+            .layout = LAYOUT_GRID,
+            .mesh = MESH_CUBE,
+            .detail = 16,
+            .seed = 1
+        }
+    };
+
+    const struct option long_opts[] = {
+        {"report", required_argument, NULL, 'r'},
+        {"headless", no_argument, NULL, 'H'},
+        {"frames", required_argument, NULL, 'n'},
+        {"size", required_argument, NULL, 's'},
+        {"samples", required_argument, NULL, 'm'},
+        {"threads", required_argument, NULL, 'T'},
+        {"objects", required_argument, NULL, 'o'},
+        {"layout", required_argument, NULL, 'l'},
+        {"mesh", required_argument, NULL, 'g'},
+        {"detail", required_argument, NULL, 'd'},
+        {"seed", required_argument, NULL, 'S'},
+        {"file", required_argument, NULL, 'f'},
+        {"optimize", required_argument, NULL, 'O'},
+        {"vertex", required_argument, NULL, 'V'},
+        {"lods", required_argument, NULL, 'L'},
+        {"draw", required_argument, NULL, 'D'},
+        {"order", required_argument, NULL, 'Q'},
+        {"cull", required_argument, NULL, 'C'},
+        {"hiz", required_argument, NULL, 'z'},
+        {"clusters", no_argument, NULL, 'c'},
+        {"gl-trace", no_argument, NULL, 'G'},
+        {"bench-bvh", no_argument, NULL, 'B'},
+        {"bench-kernels", no_argument, NULL, 'K'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "r:Hn:s:m:T:o:l:g:d:S:f:O:V:L:D:Q:C:z:cGBKh", long_opts, NULL)) != -1) {
+        switch (c) {
+            case 'r':
+                o.report = parse_double("--report", optarg);
+                break;
+            case 'H':
+                o.headless = 1;
+                break;
+            case 'n':
+                o.frames = parse_uint("--frames", optarg);
+                break;
+            case 's':
+                parse_size(optarg, &o.width, &o.height);
+                break;
+            case 'm':
+                o.samples = parse_uint("--samples", optarg);
+                break;
+            case 'T':
+                o.threads = parse_uint("--threads", optarg);
+                break;
+            case 'o':
+                o.scene.objects = parse_uint("--objects", optarg);
+                if (!o.scene.objects || o.scene.objects > SCENE_MAX_OBJECTS) {
+                    fprintf(stderr, "Error: --objects must be between 1 and %u\n", SCENE_MAX_OBJECTS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'l':
+                o.scene.layout = parse_name("--layout", optarg, LAYOUT_NAMES, 3);
+                break;
+            case 'g':
+                o.scene.mesh = parse_name("--mesh", optarg, MESH_NAMES, 3);
+                break;
+            case 'd':
+                o.scene.detail = parse_uint("--detail", optarg);
+                break;
+            case 'S':
+                o.scene.seed = parse_uint("--seed", optarg);
+                break;
+            case 'f':
+                o.file = optarg;
+                break;
+            case 'O':
+                o.optimize = parse_name("--optimize", optarg, MESHOPT_MODE_NAMES, MESHOPT_MODE_COUNT);
+                break;
+            case 'V':
+                o.vertex = parse_name("--vertex", optarg, VFORMAT_NAMES, VFORMAT_COUNT);
+                break;
+            case 'L':
+                o.lods = parse_uint("--lods", optarg);
+                if (o.lods > LOD_MAX) {
+                    fprintf(stderr, "Error: --lods must be between 0 and %u\n", LOD_MAX);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'D':
+                o.draw = parse_name("--draw", optarg, DRAW_MODE_NAMES, DRAW_MODE_COUNT);
+                break;
+            case 'Q':
+                o.order = parse_name("--order", optarg, ORDER_NAMES, ORDER_COUNT);
+                break;
+            case 'C':
+                o.cull = parse_name("--cull", optarg, CULL_MODE_NAMES, CULL_MODE_COUNT);
+                break;
+            case 'z':
+                o.hiz = parse_name("--hiz", optarg, HIZ_MODE_NAMES, HIZ_MODE_COUNT);
+                break;
+            case 'c':
+                o.clusters = 1;
+                break;
+            case 'G':
+                o.gl_trace = 1;
+                break;
+            case 'B':
+                o.bench_bvh = 1;
+                break;
+            case 'K':
+                o.bench_kernels = 1;
+                break;
+            case 'h':
+                usage(stdout, argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                usage(stderr, argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    // the culling pass writes indirect commands
+    if (o.cull == CULL_GPU && o.draw != DRAW_MDI) {
+        fprintf(stderr, "Error: --cull gpu needs --draw mdi\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // the depth pyramid is only read by the culling pass
+    if (o.hiz != HIZ_OFF && o.cull != CULL_GPU) {
+        fprintf(stderr, "Error: --hiz needs --cull gpu\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // release builds keep no tracing wrappers
+#ifndef GLTRACE
+    if (o.gl_trace) {
+        fprintf(stderr, "Error: --gl-trace needs a profiling build (make profile)\n");
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+    // a benchmark run always ends, and needs a known size
+    if (o.headless) {
+        if (!o.frames)
+            o.frames = 1000;
+        if (!o.width)
+            o.width = 1280, o.height = 720;
+    }
+    return o;
+}
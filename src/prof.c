@@ -0,0 +1,216 @@
+/// Frame-time profiler, recording per-phase CPU time into a fixed-size ring and a log-linear (HDR-style) histogram.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "prof.h"
+#include <string.h>
+#include <time.h>
+
+
+/// @brief Names of each phase, as printed in the reports
+static const char *PHASE_NAMES[PHASE_COUNT] = {"display", "poll", "swap"};
+static const char *GPU_PHASE_NAMES[GPU_PHASE_COUNT] = {"clear", "cull", "draw", "hiz"};
+
+
+uint64_t prof_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/// @brief Bucket index of a value
+static uint hist_index(uint64_t v) {
+    if (v < PROF_SUB)
+        return v;
+
+    // clamp to the largest representable value
+    if (v >> PROF_MAX_BITS)
+        v = (1ull << PROF_MAX_BITS) - 1;
+
+    // position of the most significant bit decides the bucket,
+    // the next `PROF_SUB_BITS - 1` bits decide the sub-bucket
+    const uint shift = (63 - __builtin_clzll(v)) - (PROF_SUB_BITS - 1);
+    return PROF_SUB + (shift - 1) * PROF_HALF + (uint)((v >> shift) - PROF_HALF);
+}
+
+/// @brief Highest value that maps into the bucket
+static uint64_t hist_value(const uint i) {
+    if (i < PROF_SUB)
+        return i;
+
+    const uint shift = (i - PROF_SUB) / PROF_HALF + 1;
+    const uint64_t m = (i - PROF_SUB) % PROF_HALF + PROF_HALF;
+    return ((m + 1) << shift) - 1;
+}
+
+void hist_record(histogram *h, const uint64_t us) {
+    h->counts[hist_index(us)]++;
+    h->total++;
+    h->sum += us;
+    if (us > h->max)
+        h->max = us;
+}
+
+uint64_t hist_percentile(const histogram *h, const double pct) {
+    if (!h->total)
+        return 0;
+
+    // rank of the requested value (1-based)
+    uint64_t rank = (uint64_t)(pct / 100.0 * h->total + 0.5);
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (uint i = 0; i < PROF_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            // never report more than what was actually recorded
+            const uint64_t v = hist_value(i);
+            return v < h->max ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+void prof_init(profiler *p, const double interval) {
+    memset(p, 0, sizeof(*p));
+    p->interval_ns = (uint64_t)(interval * 1e9);
+    p->t_start = p->t_report = prof_now();
+}
+
+void prof_begin(profiler *p) {
+    p->t_begin = p->t_mark = prof_now();
+}
+
+void prof_mark(profiler *p, const prof_phase ph) {
+    const uint64_t t = prof_now();
+    p->cur.phase_ns[ph] = t - p->t_mark;
+    p->t_mark = t;
+}
+
+void prof_end(profiler *p) {
+    const uint64_t t = prof_now();
+
+    // frame time is measured from the end of one frame to the next, so everything in between
+    // (including waiting on vsync) is accounted for, and belongs to the frame whose phases are stored;
+    // the very first frame has no predecessor and counts from its own beginning
+    p->cur.frame_ns = t - (p->t_end ? p->t_end : p->t_begin);
+    p->t_end = t;
+
+    p->ring[p->head % PROF_RING] = p->cur;
+    p->head++;
+
+    for (uint k = 0; k < PHASE_COUNT; k++)
+        p->phase_all_ns[k] += p->cur.phase_ns[k];
+
+    const uint64_t us = p->cur.frame_ns / 1000;
+    hist_record(&p->window, us);
+    hist_record(&p->all, us);
+
+    memset(&p->cur, 0, sizeof(p->cur));
+}
+
+void prof_gpu(profiler *p, const uint64_t phase_ns[GPU_PHASE_COUNT]) {
+    uint64_t total = 0;
+    for (uint k = 0; k < GPU_PHASE_COUNT; k++) {
+        p->gpu_phase_ns[k] += phase_ns[k];
+        p->gpu_phase_all_ns[k] += phase_ns[k];
+        total += phase_ns[k];
+    }
+
+    hist_record(&p->gpu_window, total / 1000);
+    hist_record(&p->gpu_all, total / 1000);
+}
+
+prof_stats prof_summary(const histogram *h, const double seconds) {
+    return (prof_stats) {
+        .frames = h->total,
+        .p50 = hist_percentile(h, 50.0) / 1000.0,
+        .p95 = hist_percentile(h, 95.0) / 1000.0,
+        .p99 = hist_percentile(h, 99.0) / 1000.0,
+        .max = h->max / 1000.0,
+        .mean = h->total ? (double)h->sum / h->total / 1000.0 : 0.0,
+        .fps = seconds > 0.0 ? h->total / seconds : 0.0
+    };
+}
+
+/// @brief Write a summary as a JSON object
+static void stats_json(const prof_stats s, FILE *out) {
+    fprintf(out, "{\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+            s.mean, s.p50, s.p95, s.p99, s.max);
+}
+
+void prof_json(const profiler *p, FILE *out) {
+    const double seconds = (p->t_mark - p->t_start) / 1e9;
+    const prof_stats s = prof_summary(&p->all, seconds);
+    const double n = s.frames ? s.frames : 1;
+
+    fprintf(out, "{\"frames\": %lu, \"seconds\": %.4f, \"fps\": %.2f, \"frame_ms\": ",
+            (unsigned long)s.frames, seconds, s.fps);
+    stats_json(s, out);
+
+    fprintf(out, ", \"phase_ms\": {");
+    for (uint k = 0; k < PHASE_COUNT; k++)
+        fprintf(out, "%s\"%s\": %.4f", k ? ", " : "", PHASE_NAMES[k], p->phase_all_ns[k] / n / 1e6);
+    fprintf(out, "}");
+
+    // GPU figures are left out entirely if no result ever arrived
+    if (p->gpu_all.total) {
+        const double g = p->gpu_all.total;
+
+        fprintf(out, ", \"gpu_frames\": %lu, \"gpu_ms\": ", (unsigned long)p->gpu_all.total);
+        stats_json(prof_summary(&p->gpu_all, 0.0), out);
+
+        fprintf(out, ", \"gpu_phase_ms\": {");
+        for (uint k = 0; k < GPU_PHASE_COUNT; k++)
+            fprintf(out, "%s\"%s\": %.4f", k ? ", " : "", GPU_PHASE_NAMES[k], p->gpu_phase_all_ns[k] / g / 1e6);
+        fprintf(out, "}");
+    }
+    fprintf(out, "}");
+}
+
+int prof_report(profiler *p, FILE *out) {
+    const uint64_t t = prof_now();
+    if (!p->interval_ns || t - p->t_report < p->interval_ns || !p->window.total)
+        return 0;
+
+    const prof_stats s = prof_summary(&p->window, (t - p->t_report) / 1e9);
+
+    // per-phase means over the window (limited to what the ring still holds)
+    uint64_t n = p->head - p->window_head;
+    if (n > PROF_RING)
+        n = PROF_RING;
+
+    double phase[PHASE_COUNT] = {0};
+    for (uint64_t i = p->head - n; i < p->head; i++)
+        for (uint k = 0; k < PHASE_COUNT; k++)
+            phase[k] += p->ring[i % PROF_RING].phase_ns[k];
+
+    fprintf(out, "fps %6.1f | frame ms p50 %6.2f p95 %6.2f p99 %6.2f max %6.2f |",
+            s.fps, s.p50, s.p95, s.p99, s.max);
+    for (uint k = 0; k < PHASE_COUNT; k++)
+        fprintf(out, " %s %.2f", PHASE_NAMES[k], phase[k] / n / 1e6);
+
+    // GPU results lag a few frames behind, so they are reported only once some arrived
+    if (p->gpu_window.total) {
+        const prof_stats g = prof_summary(&p->gpu_window, 0.0);
+        fprintf(out, " | gpu ms p50 %6.2f p95 %6.2f p99 %6.2f max %6.2f |",
+                g.p50, g.p95, g.p99, g.max);
+        for (uint k = 0; k < GPU_PHASE_COUNT; k++)
+            fprintf(out, " %s %.2f", GPU_PHASE_NAMES[k], p->gpu_phase_ns[k] / (double)p->gpu_window.total / 1e6);
+
+        // whichever side does more work per frame is the one limiting the frame rate
+        const double cpu = (phase[PHASE_DISPLAY] + phase[PHASE_POLL]) / n / 1e6;
+        fprintf(out, " | %s-bound", g.mean > cpu ? "gpu" : "cpu");
+    }
+    fprintf(out, "\n");
+    fflush(out);
+
+    // start a new window
+    memset(&p->window, 0, sizeof(p->window));
+    memset(&p->gpu_window, 0, sizeof(p->gpu_window));
+    memset(p->gpu_phase_ns, 0, sizeof(p->gpu_phase_ns));
+    p->window_head = p->head;
+    p->t_report = t;
+    return 1;
+}
@@ -0,0 +1,119 @@
+/// Render queue: every object submits a 64-bit sort key (program, VAO, mode and indexing, then its mesh and,
+/// front to back, how far it is), and the queue orders the objects by key with a radix sort. Draws then go through
+/// a state cache, so a program or a VAO is only bound when it changes.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "queue.h"
+#include <string.h>
+
+
+const char *ORDER_NAMES[ORDER_COUNT] = {"state", "front"};
+
+
+void queue_reserve(render_queue *q, const uint n) {
+    if (n <= q->cap)
+        return;
+
+    q->keys = realloc(q->keys, n * sizeof(uint64_t));
+    q->items = realloc(q->items, n * sizeof(uint));
+    q->keys_scratch = realloc(q->keys_scratch, n * sizeof(uint64_t));
+    q->items_scratch = realloc(q->items_scratch, n * sizeof(uint));
+    q->last = realloc(q->last, n * sizeof(uint));
+    if (!q->keys || !q->items || !q->keys_scratch || !q->items_scratch || !q->last) {
+        error("Failed to allocate the render queue.");
+        exit(EXIT_FAILURE);
+    }
+    q->cap = n;
+}
+
+/// @brief Append the low `bits` of `value` to a key
+static uint64_t key_field(const uint64_t key, const uint bits, const uint value) {
+    return key << bits | (value & ((1u << bits) - 1));
+}
+
+uint64_t queue_key(const queue_order order, const uint program, const uint vao, const GLenum mode,
+                   const GLboolean has_ebo, const GLenum index_type, const uint mesh, const float depth) {
+    // arrays come before elements, then bytes, shorts and ints
+    const uint index = has_ebo ? 1 + (index_type - GL_UNSIGNED_BYTE) / 2 : 0;
+    const uint bucket = (uint)(fminf(fmaxf(depth, 0.0f), 1.0f) * ((1u << QUEUE_DEPTH_BITS) - 1));
+
+    uint64_t key = key_field(0, QUEUE_PROGRAM_BITS, program);
+    key = key_field(key, QUEUE_VAO_BITS, vao);
+    key = key_field(key, QUEUE_MODE_BITS, mode);
+    key = key_field(key, QUEUE_INDEX_BITS, index);
+
+    // the nearest objects first, and runs of a mesh only within a depth bucket
+    if (order == ORDER_FRONT)
+        return key_field(key_field(key, QUEUE_DEPTH_BITS, bucket), QUEUE_MESH_BITS, mesh);
+    return key_field(key_field(key, QUEUE_MESH_BITS, mesh), QUEUE_DEPTH_BITS, 0);
+}
+
+void queue_sort(render_queue *q, const uint len) {
+    const uint digits = 1u << QUEUE_RADIX_BITS;
+    for (uint shift = 0; shift < 64; shift += QUEUE_RADIX_BITS) {
+        uint first[1u << QUEUE_RADIX_BITS] = {0};
+        for (uint k = 0; k < len; k++)
+            first[(q->keys[k] >> shift) & (digits - 1)]++;
+
+        // a digit every key shares leaves the order as it is
+        if (!len || first[(q->keys[0] >> shift) & (digits - 1)] == len)
+            continue;
+
+        for (uint d = 0, sum = 0; d < digits; d++) {
+            const uint n = first[d];
+            first[d] = sum, sum += n;
+        }
+        for (uint k = 0; k < len; k++) {
+            const uint at = first[(q->keys[k] >> shift) & (digits - 1)]++;
+            q->keys_scratch[at] = q->keys[k];
+            q->items_scratch[at] = q->items[k];
+        }
+
+        uint64_t *keys = q->keys;
+        q->keys = q->keys_scratch, q->keys_scratch = keys;
+        uint *items = q->items;
+        q->items = q->items_scratch, q->items_scratch = items;
+    }
+}
+
+int queue_changed(render_queue *q, const uint len) {
+    if (len == q->last_len && !memcmp(q->items, q->last, len * sizeof(uint)))
+        return 0;
+
+    memcpy(q->last, q->items, len * sizeof(uint));
+    q->last_len = len;
+    return 1;
+}
+
+void queue_free(render_queue *q) {
+    free(q->keys);
+    free(q->items);
+    free(q->keys_scratch);
+    free(q->items_scratch);
+    free(q->last);
+    memset(q, 0, sizeof(*q));
+}
+
+void state_reset(render_state *s) {
+    s->program = s->vao = ~0u;
+    s->binds = s->changes = 0;
+}
+
+void state_program(render_state *s, const uint program) {
+    s->binds++;
+    if (program == s->program)
+        return;
+    glUseProgram(program);
+    s->program = program;
+    s->changes++;
+}
+
+void state_vao(render_state *s, const uint vao) {
+    s->binds++;
+    if (vao == s->vao)
+        return;
+    glBindVertexArray(vao);
+    s->vao = vao;
+    s->changes++;
+}
@@ -0,0 +1,727 @@
+/// Draws the world with one draw call per object, one instanced draw call per mesh, or one multi-draw-indirect
+/// call per program, primitive mode and index type (whose commands a compute pass can cull against the view frustum,
+/// and against the depth the last frame left).
+/// Objects whose meshes are split into meshlets are culled meshlet by meshlet instead, and drawn with one
+/// multi-draw-indirect call per program and index type.
+/// Objects are ordered by the sort keys of a render queue, and the draws only bind the state that changed.
+/// Shaders read the projection from a per-frame uniform block, and the modelview and normal matrices
+/// from a per-object storage buffer indexed by `gl_BaseInstanceARB + gl_InstanceID`.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "fpsdbg.h"
+#include "render.h"
+#include "simd.h"
+#include <string.h>
+
+
+const char *DRAW_MODE_NAMES[DRAW_MODE_COUNT] = {"loop", "instanced", "mdi"};
+
+
+void render_init(renderer *r, const draw_mode mode, const queue_order order, const cull_mode cull,
+                 const hiz_mode occlusion, job_pool *jobs) {
+    memset(r, 0, sizeof(*r));
+    r->mode = mode;
+    r->order = order;
+    r->cull = cull;
+    r->jobs = jobs;
+    if (cull == CULL_GPU)
+        cull_init(&r->culling);
+    hiz_init(&r->occlusion, cull == CULL_GPU ? occlusion : HIZ_OFF);
+    bvh_init(&r->tree);
+
+    // never matches a world's version, so the first instanced frame builds the order (and the commands)
+    r->order_version = ~0u;
+    r->commands_version = ~0u;
+    r->levels_version = ~0u;
+    glGenBuffers(1, &r->commands_buffer);
+    glGenBuffers(1, &r->cluster_buffer);
+
+    // the objects' stream grows with the world
+    stream_init(&r->frame, GL_UNIFORM_BUFFER, sizeof(frame_data));
+    stream_init(&r->objects, GL_SHADER_STORAGE_BUFFER, 1024 * sizeof(object_data));
+}
+
+/// @brief Make sure the draw order, the commands, the batches and the culling results have room for `n` objects
+/// (there are never more runs than objects)
+static void render_reserve(renderer *r, const uint n) {
+    if (n <= r->order_cap)
+        return;
+
+    queue_reserve(&r->queue, n);
+    r->commands = realloc(r->commands, n * sizeof(draw_command));
+    r->batches = realloc(r->batches, n * sizeof(draw_batch));
+    r->visible = realloc(r->visible, n);
+    r->culled = realloc(r->culled, n * sizeof(uint));
+    r->levels = realloc(r->levels, n);
+    r->split = realloc(r->split, n * sizeof(uint));
+    r->partition = realloc(r->partition, n * sizeof(uint));
+    r->cluster_first = realloc(r->cluster_first, (n + 1) * sizeof(uint));
+    r->cluster_visible = realloc(r->cluster_visible, n * sizeof(uint));
+    r->cluster_batches = realloc(r->cluster_batches, n * sizeof(draw_batch));
+    if (!r->commands || !r->batches || !r->visible || !r->culled || !r->levels || !r->split ||
+            !r->partition || !r->cluster_first || !r->cluster_visible || !r->cluster_batches) {
+        error("Failed to allocate the draw order.");
+        exit(EXIT_FAILURE);
+    }
+    r->order_cap = r->commands_cap = r->batches_cap = n;
+}
+
+/// @brief Objects whose sort keys are built by the worker threads
+/// @param r renderer
+/// @param w world
+/// @param view view matrix
+/// @param near distance to the near plane
+/// @param range logarithm of the far plane's distance over the near plane's
+typedef struct KeyJob {
+    renderer *r;
+    const world *w;
+    vec4 *view;
+    float near, range;
+} key_job;
+
+/// @brief Build the sort keys of a range of objects (in their own order, which equal keys keep)
+static void key_range(void *ctx, const uint first, const uint count) {
+    const key_job *job = ctx;
+    const world *w = job->w;
+    render_queue *q = &job->r->queue;
+
+    for (uint i = first; i < first + count; i++) {
+        // the nearest point of the box's bounding sphere, on a logarithmic scale between the planes
+        float depth = 0.0f;
+        if (job->r->order == ORDER_FRONT) {
+            const aabb *b = &w->bounds[i];
+            vec3 center, half;
+            vec3_add(center, b->lo, b->hi);
+            vec3_scale(center, center, 0.5f);
+            vec3_sub(half, b->hi, center);
+            float d = -job->view[3][2];
+            for (uint l = 0; l < 3; l++)
+                d -= job->view[l][2] * center[l];
+            d -= vec3_len(half);
+            depth = d > job->near ? logf(d / job->near) / job->range : 0.0f;
+        }
+
+        q->items[i] = i;
+        q->keys[i] = queue_key(job->r->order, w->program[i], w->meshes.vao, w->mode[i], w->has_ebo[i],
+                               w->index_type[i], w->mesh[i], depth);
+    }
+}
+
+/// @brief Sort the objects by program, then by mode, indexing and index type (so multi-draw batches are
+/// contiguous), then into runs sharing a mesh, or nearest first (only when objects were added or removed,
+/// unless they are sorted by depth every frame, in which case the order only counts as changed when it did)
+static void render_sort(renderer *r, const world *w, mat4x4 const view) {
+    r->order_changed = 0;
+    if (r->order == ORDER_STATE && r->order_version == w->version)
+        return;
+
+    // the near and far planes' distances, from the third row of the projection
+    const float near = cam.p[3][2] / (cam.p[2][2] - 1.0f), far = cam.p[3][2] / (cam.p[2][2] + 1.0f);
+    key_job job = {r, w, (vec4 *)view, near, logf(far / near)};
+    jobs_run(r->jobs, key_range, &job, w->len, RENDER_JOB);
+    queue_sort(&r->queue, w->len);
+
+    r->order_changed = queue_changed(&r->queue, w->len) || r->order_version != w->version;
+    r->order_version = w->version;
+}
+
+/// @brief Object at position `k` of the frame's draw list
+static uint drawn(const renderer *r, const uint k) {
+    return r->list[k];
+}
+
+/// @brief Number of objects in the run starting at position `k` of the draw list
+static uint run_length(const renderer *r, const world *w, const uint k) {
+    const uint i = drawn(r, k);
+
+    uint n = 1;
+    while (k + n < r->list_len && w->program[drawn(r, k + n)] == w->program[i] && w->mesh[drawn(r, k + n)] == w->mesh[i]
+            && r->levels[drawn(r, k + n)] == r->levels[i])
+        n++;
+    return n;
+}
+
+/// @brief Version of its mesh object `i` is drawn with
+static const lod_level *drawn_level(const renderer *r, const world *w, const uint i) {
+    return &w->meshes.meshes[w->mesh[i]].lod[r->levels[i]];
+}
+
+/// @brief Build one indirect command per run, and group the commands into batches
+/// (only when objects were added or removed or switched versions or places in the order, unless the CPU culls the
+/// draw list every frame)
+static void render_commands(renderer *r, const world *w) {
+    if (r->cull != CULL_CPU && r->commands_version == w->version && !r->levels_changed && !r->order_changed)
+        return;
+
+    r->commands_len = r->batches_len = 0;
+    for (uint k = 0; k < r->list_len;) {
+        const uint i = drawn(r, k);
+        const uint n = run_length(r, w, k);
+        const lod_level *lod = drawn_level(r, w, i);
+
+        // an arrays command is {count, instance_count, first, base_instance}
+        const draw_command c = w->has_ebo[i]
+                               ? (draw_command) {lod->indices_len, n, lod->first_index, w->base_vertex[i], k}
+                               : (draw_command) {w->vertices_len[i] / 3, n, w->base_vertex[i], k, 0};
+
+        // start a new batch when the program, mode, indexing or index type changes
+        draw_batch *b = r->batches_len ? &r->batches[r->batches_len - 1] : NULL;
+        if (!b || b->program != w->program[i] || b->mode != w->mode[i] || b->has_ebo != w->has_ebo[i] ||
+                b->index_type != w->index_type[i]) {
+            b = &r->batches[r->batches_len++];
+            *b = (draw_batch) {
+                w->program[i], w->mode[i], w->has_ebo[i], w->index_type[i], r->commands_len, 0, k, 0
+            };
+        }
+
+        r->commands[r->commands_len++] = c;
+        b->count++;
+        b->objects += n;
+        k += n;
+    }
+
+    if (r->cull == CULL_GPU)
+        cull_build(&r->culling, w, r->list, r->levels, r->batches, r->batches_len);
+
+    // rebuilt every frame when the CPU culls, and whenever the order changes front to back
+    const GLenum usage = r->cull == CULL_CPU ? GL_STREAM_DRAW
+                         : r->order == ORDER_FRONT ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, r->commands_buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, r->commands_len * sizeof(draw_command), r->commands, usage);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    r->commands_version = w->version;
+}
+
+/// @brief Normal matrix of a modelview matrix, up to scale (the shader normalizes the result anyway)
+/// The columns of the inverse transpose of a 3x3 matrix are the cross products of its columns, divided
+/// by the determinant; only the sign of the determinant is kept, so mirrored objects keep facing out.
+static void normal_matrix(vec4 n[3], mat4x4 const m) {
+    vec3_mul_cross(n[0], m[1], m[2]);
+    vec3_mul_cross(n[1], m[2], m[0]);
+    vec3_mul_cross(n[2], m[0], m[1]);
+
+    const float s = vec3_mul_inner(m[0], n[0]) < 0.0f ? -1.0f : 1.0f;
+    for (uint i = 0; i < 3; i++) {
+        vec3_scale(n[i], n[i], s);
+        n[i][3] = 0.0f;
+    }
+}
+
+/// @brief Objects whose shader data is built by the worker threads
+/// @param r renderer
+/// @param w world
+/// @param view view matrix
+/// @param objects mapped storage, one entry per position in the draw list
+typedef struct UploadJob {
+    const renderer *r;
+    const world *w;
+    vec4 *view;
+    object_data *objects;
+} upload_job;
+
+/// @brief Build the shader data of a range of the draw list
+static void upload_range(void *ctx, const uint first, const uint count) {
+    const upload_job *job = ctx;
+    const uint *index = job->r->list + first;
+
+    // the modelviews come from one batched product into the stack, as the mapping may be uncached
+    // (each object is then written out once)
+    mat4x4 modelview[RENDER_BATCH];
+    for (uint b = 0; b < count; b += RENDER_BATCH) {
+        const uint n = count - b < RENDER_BATCH ? count - b : RENDER_BATCH;
+        simd.mat4x4_mul_batch(modelview, job->view, job->w->model, index + b, n);
+
+        for (uint k = 0; k < n; k++) {
+            object_data o;
+            mat4x4_dup(o.modelview, modelview[k]);
+            normal_matrix(o.normal, o.modelview);
+            const uint i = index[b + k];
+            vec4_dup(o.dequant, job->w->meshes.meshes[job->w->mesh[i]].dequant);
+            job->objects[first + b + k] = o;
+        }
+    }
+}
+
+/// @brief Upload the frame's uniform block, and the modelview and normal matrices of every object in the draw list
+/// and of the clustered objects after it (large lists are split between the worker threads)
+static void upload_frame(renderer *r, const world *w, mat4x4 const view) {
+    frame_data *f = stream_map(&r->frame, sizeof(frame_data));
+    mat4x4_dup(f->projection, cam.p);
+    mat4x4_dup(f->view, view);
+    stream_bind(&r->frame, UBO_FRAME, sizeof(frame_data));
+
+    const size_t size = (r->list_len + r->clustered) * sizeof(object_data);
+    upload_job job = {r, w, (vec4 *)view, stream_map(&r->objects, size)};
+    jobs_run(r->jobs, upload_range, &job, r->list_len + r->clustered, RENDER_JOB);
+    stream_bind(&r->objects, SSBO_OBJECTS, size);
+}
+
+/// @brief Objects whose versions are picked by the worker threads
+/// @param r renderer
+/// @param w world
+/// @param view view matrix
+/// @param pixels size on the screen of one unit one unit away, in pixels
+/// @param switches number of objects that switched versions
+/// @param objects objects drawn with each version
+/// @param triangles triangles drawn
+typedef struct LevelJob {
+    renderer *r;
+    const world *w;
+    vec4 *view;
+    float pixels;
+    atomic_uint switches;
+    atomic_uint objects[LOD_MAX + 1];
+    atomic_uint_fast64_t triangles;
+} level_job;
+
+/// @brief Pick the versions of a range of the draw list
+static void level_range(void *ctx, const uint first, const uint count) {
+    level_job *job = ctx;
+    const world *w = job->w;
+    uint8_t *levels = job->r->levels;
+
+    uint switches = 0, objects[LOD_MAX + 1] = {0};
+    uint64_t triangles = 0;
+    for (uint k = first; k < first + count; k++) {
+        const uint i = drawn(job->r, k);
+        const mesh *msh = &w->meshes.meshes[w->mesh[i]];
+
+        // the nearest point of the box's bounding sphere, in front of the camera, and the model's largest scale
+        const aabb *b = &w->bounds[i];
+        vec3 center, half;
+        vec3_add(center, b->lo, b->hi);
+        vec3_scale(center, center, 0.5f);
+        vec3_sub(half, b->hi, center);
+        float depth = -job->view[3][2];
+        for (uint l = 0; l < 3; l++)
+            depth -= job->view[l][2] * center[l];
+        depth -= vec3_len(half);
+
+        float scale = 0.0f;
+        for (uint l = 0; l < 3; l++)
+            scale = fmaxf(scale, vec3_len(w->model[i][l]));
+
+        const uint level = lod_select(msh->lod, msh->lods, levels[i], depth > 0.0f ? job->pixels * scale / depth : 0.0f);
+        switches += level != levels[i];
+        levels[i] = level;
+        objects[level]++;
+        triangles += (w->has_ebo[i] ? msh->lod[level].indices_len : w->vertices_len[i]) / 3;
+    }
+
+    atomic_fetch_add(&job->switches, switches);
+    for (uint l = 0; l <= LOD_MAX; l++)
+        atomic_fetch_add(&job->objects[l], objects[l]);
+    atomic_fetch_add(&job->triangles, triangles);
+}
+
+/// @brief Pick the version of its mesh every object in the draw list is drawn with, from its size on the screen
+/// (large lists are split between the worker threads), then split the runs of the list by version
+static void render_levels(renderer *r, const world *w, mat4x4 const view) {
+    if (r->levels_version != w->version) {
+        memset(r->levels, 0, w->len);
+        r->levels_version = w->version;
+    }
+    r->levels_changed = 0;
+
+    uint versioned = 0;
+    for (uint me = 0; me < w->meshes.len; me++)
+        versioned += w->meshes.meshes[me].lods > 1;
+    if (!versioned)
+        return;
+
+    // a unit one unit away spans half the viewport's height times the projection's vertical scale
+    // (or its width and horizontal scale, whichever is larger)
+    const float pixels = 0.5f * fmaxf(cam.p[0][0] * WIDTH, cam.p[1][1] * HEIGHT);
+    level_job job = {.r = r, .w = w, .view = (vec4 *)view, .pixels = pixels};
+    atomic_init(&job.switches, 0);
+    for (uint l = 0; l <= LOD_MAX; l++)
+        atomic_init(&job.objects[l], 0);
+    atomic_init(&job.triangles, 0);
+    jobs_run(r->jobs, level_range, &job, r->list_len, RENDER_JOB);
+
+    const uint switches = atomic_load(&job.switches);
+    r->levels_changed = switches > 0;
+    r->switches += switches;
+    for (uint l = 0; l <= LOD_MAX; l++)
+        r->level_objects[l] = atomic_load(&job.objects[l]);
+    r->level_triangles = atomic_load(&job.triangles);
+
+    // runs are sorted by mesh, so objects of each version are brought together (in their order)
+    for (uint k = 0; k < r->list_len;) {
+        const uint i = drawn(r, k);
+        uint n = 1;
+        while (k + n < r->list_len && w->program[drawn(r, k + n)] == w->program[i] && w->mesh[drawn(r, k + n)] == w->mesh[i])
+            n++;
+
+        uint first[LOD_MAX + 2] = {0};
+        for (uint j = k; j < k + n; j++)
+            first[r->levels[drawn(r, j)] + 1]++;
+        for (uint l = 0; l <= LOD_MAX; l++)
+            first[l + 1] += first[l];
+        for (uint j = k; j < k + n; j++)
+            r->split[k + first[r->levels[drawn(r, j)]]++] = drawn(r, j);
+        k += n;
+    }
+    r->list = r->split;
+}
+
+/// @brief Objects whose meshlets are culled by the worker threads
+/// @param r renderer
+/// @param w world
+/// @param view view matrix
+typedef struct ClusterJob {
+    renderer *r;
+    const world *w;
+    vec4 *view;
+} cluster_job;
+
+/// @brief Cull the meshlets of a range of the clustered objects
+static void cluster_range(void *ctx, const uint first, const uint count) {
+    const cluster_job *job = ctx;
+    renderer *r = job->r;
+    const world *w = job->w;
+
+    for (uint j = first; j < first + count; j++) {
+        const uint i = r->list[r->list_len + j];
+        const lod_level *lod = drawn_level(r, w, i);
+
+        mat4x4 modelview, clip;
+        simd.mat4x4_mul(modelview, job->view, w->model[i]);
+        simd.mat4x4_mul(clip, cam.p, modelview);
+        r->cluster_visible[j] = meshlet_cull(lod->meshlets, lod->meshlets_len, w->meshes.meshes[w->mesh[i]].sphere,
+                                             modelview, clip, r->cluster_ids + r->cluster_first[j]);
+    }
+}
+
+/// @brief Whether object `i` is drawn meshlet by meshlet (the version it is drawn with was split into meshlets)
+static int clustered(const renderer *r, const world *w, const uint i) {
+    return drawn_level(r, w, i)->meshlets_len > 0;
+}
+
+/// @brief Move the objects drawn meshlet by meshlet after the rest of the draw list, find the meshlets of each
+/// that may be seen (split between the worker threads), and build one command per meshlet
+static void render_clusters(renderer *r, const world *w, mat4x4 const view) {
+    r->clustered = r->cluster_commands_len = r->cluster_batches_len = r->cluster_tested = 0;
+    r->cluster_triangles = 0;
+
+    uint split = 0;
+    for (uint me = 0; me < w->meshes.len; me++)
+        split += w->meshes.meshes[me].lods && w->meshes.meshes[me].lod[0].meshlets_len > 0;
+    if (!split)
+        return;
+
+    // both parts keep their order, so runs stay together
+    uint n = 0, meshlets = 0;
+    for (uint k = 0; k < r->list_len; k++)
+        if (!clustered(r, w, drawn(r, k)))
+            r->partition[n++] = drawn(r, k);
+    const uint rest = n;
+    for (uint k = 0; k < r->list_len; k++) {
+        const uint i = drawn(r, k);
+        if (clustered(r, w, i)) {
+            r->cluster_first[n - rest] = meshlets;
+            meshlets += drawn_level(r, w, i)->meshlets_len;
+            r->partition[n++] = i;
+        }
+    }
+    if (n == rest)
+        return;
+    r->cluster_first[n - rest] = meshlets;
+    r->list = r->partition;
+    r->list_len = rest;
+    r->clustered = n - rest;
+
+    // every meshlet of every clustered object may need a command
+    if (meshlets > r->cluster_commands_cap) {
+        r->cluster_commands_cap = meshlets + meshlets / 2;
+        r->cluster_ids = realloc(r->cluster_ids, r->cluster_commands_cap * sizeof(uint));
+        r->cluster_commands = realloc(r->cluster_commands, r->cluster_commands_cap * sizeof(draw_command));
+        if (!r->cluster_ids || !r->cluster_commands) {
+            error("Failed to allocate the meshlets' commands.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    cluster_job job = {r, w, (vec4 *)view};
+    jobs_run(r->jobs, cluster_range, &job, r->clustered, RENDER_CLUSTER_JOB);
+
+    // the commands are packed, and batched by program and index type
+    for (uint j = 0; j < r->clustered; j++) {
+        const uint k = rest + j, i = r->list[k];
+        const lod_level *lod = drawn_level(r, w, i);
+        r->cluster_tested += lod->meshlets_len;
+        if (!r->cluster_visible[j])
+            continue;
+
+        draw_batch *b = r->cluster_batches_len ? &r->cluster_batches[r->cluster_batches_len - 1] : NULL;
+        if (!b || b->program != w->program[i] || b->index_type != w->index_type[i]) {
+            b = &r->cluster_batches[r->cluster_batches_len++];
+            *b = (draw_batch) {
+                w->program[i], GL_TRIANGLES, GL_TRUE, w->index_type[i], r->cluster_commands_len, 0, k, 0
+            };
+        }
+
+        for (uint v = 0; v < r->cluster_visible[j]; v++) {
+            const meshlet *ml = &lod->meshlets[r->cluster_ids[r->cluster_first[j] + v]];
+            r->cluster_commands[r->cluster_commands_len++] = (draw_command) {
+                ml->indices_len, 1, lod->first_index + ml->first, w->base_vertex[i], k
+            };
+            r->cluster_triangles += ml->indices_len / 3;
+        }
+        b->count += r->cluster_visible[j];
+        b->objects++;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, r->cluster_buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, r->cluster_commands_len * sizeof(draw_command), r->cluster_commands,
+                 GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/// @brief Draw `count` instances of object `i`, starting at instance `first`
+/// (its mesh is found through offsets into the arenas, so the shared VAO stays bound)
+static void draw_instances(const renderer *r, const world *w, const uint i, const uint count, const uint first) {
+    const lod_level *lod = drawn_level(r, w, i);
+    if (w->has_ebo[i])
+        glDrawElementsInstancedBaseVertexBaseInstance(w->mode[i], lod->indices_len, w->index_type[i],
+                (void *)(lod->first_index * MESH_INDEX_SIZE(w->index_type[i])), count, w->base_vertex[i], first);
+    else
+        glDrawArraysInstancedBaseInstance(w->mode[i], w->base_vertex[i], w->vertices_len[i] / 3, count, first);
+}
+
+/// @brief One draw call per object
+static void draw_loop(renderer *r, const world *w) {
+    for (uint k = 0; k < r->list_len; k++) {
+        const uint i = drawn(r, k);
+
+        // use the correct program (only bound when it changes)
+        state_program(&r->state, w->program[i]);
+        state_vao(&r->state, w->meshes.vao);
+
+        // draw object (its matrices are entry `k` of the storage buffer)
+        draw_instances(r, w, i, 1, k);
+    }
+    r->draws = r->list_len;
+}
+
+/// @brief One instanced draw call per run of objects sharing a program and a mesh
+static void draw_instanced(renderer *r, const world *w) {
+    r->draws = 0;
+
+    for (uint k = 0; k < r->list_len;) {
+        const uint i = drawn(r, k);
+        const uint n = run_length(r, w, k);
+
+        // runs are sorted by program, so it changes at most once per program
+        state_program(&r->state, w->program[i]);
+        state_vao(&r->state, w->meshes.vao);
+
+        draw_instances(r, w, i, n, k);
+
+        r->draws++;
+        k += n;
+    }
+}
+
+/// @brief One multi-draw-indirect call per batch of commands sharing a program, a mode and an index type
+/// (with culling, a batch has a command slot per object, filled in by the culling pass)
+static void draw_mdi(renderer *r, const world *w) {
+    const culler *c = &r->culling;
+    const int culled = r->cull == CULL_GPU;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culled ? c->commands : r->commands_buffer);
+    if (culled && c->compact)
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, c->counts);
+
+    for (uint b = 0; b < r->batches_len; b++) {
+        const draw_batch *batch = &r->batches[b];
+        state_program(&r->state, batch->program);
+        state_vao(&r->state, w->meshes.vao);
+
+        // arrays commands are read with the stride of the larger elements command
+        const void *offset = (void *)((culled ? batch->first_object : batch->first) * sizeof(draw_command));
+        const uint count = culled ? batch->objects : batch->count;
+
+        // the number of visible commands of batch `b` follows the overall visible and hidden counts
+        const GLintptr drawcount = (2 + b) * sizeof(uint);
+        if (culled && c->compact) {
+            if (batch->has_ebo)
+                glMultiDrawElementsIndirectCountARB(batch->mode, batch->index_type, offset, drawcount, count, sizeof(draw_command));
+            else
+                glMultiDrawArraysIndirectCountARB(batch->mode, offset, drawcount, count, sizeof(draw_command));
+        } else if (batch->has_ebo)
+            glMultiDrawElementsIndirect(batch->mode, batch->index_type, offset, count, sizeof(draw_command));
+        else
+            glMultiDrawArraysIndirect(batch->mode, offset, count, sizeof(draw_command));
+    }
+
+    if (culled && c->compact)
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    r->draws = r->batches_len;
+}
+
+/// @brief One multi-draw-indirect call per batch of meshlets sharing a program and an index type (with back faces
+/// culled, as they were in the meshlets facing away)
+static void draw_clusters(renderer *r, const world *w) {
+    if (!r->cluster_batches_len)
+        return;
+
+    glEnable(GL_CULL_FACE);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, r->cluster_buffer);
+    for (uint b = 0; b < r->cluster_batches_len; b++) {
+        const draw_batch *batch = &r->cluster_batches[b];
+        state_program(&r->state, batch->program);
+        state_vao(&r->state, w->meshes.vao);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, batch->index_type, (void *)(batch->first * sizeof(draw_command)),
+                                    batch->count, sizeof(draw_command));
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glDisable(GL_CULL_FACE);
+    r->draws += r->cluster_batches_len;
+}
+
+/// @brief Bring the hierarchy over the objects up to date: rebuilt when objects were added or removed, and refit
+/// over the objects that moved since
+static void render_tree(renderer *r, world *w) {
+    if (r->tree.version != w->version)
+        bvh_build(&r->tree, w);
+    else if (w->moved_len)
+        bvh_refit(&r->tree, w, w->moved, w->moved_len);
+    world_clear_moved(w);
+}
+
+void display(renderer *r, world *w, gpu_timer *gt, const double t) {
+    // clear the screen
+    glClearColor(0.4, 0.4, 0.4, 1.0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gpu_timer_mark(gt, GPU_CLEAR);
+
+    // init rotation matrix
+    mat4x4_identity(cam.r);
+    mat4x4_rotate_Y(cam.r, cam.r, t);
+
+    // Instead of calling `upt_cam` to fully update the camera,
+    // clone only the camera's modelview matrix as it's the
+    // only matrix being modified; everything else stays the
+    // same, so there's no need to recalculate their values
+    mat4x4 view;
+    mat4x4_dup(view, cam.m);
+
+    // multiply modelview with rotation matrix
+    simd.mat4x4_mul(view, view, cam.r);
+
+    render_reserve(r, w->len);
+
+    mat4x4_dup(r->view, view);
+
+    // objects are sorted by state (into runs, or nearest first)
+    render_sort(r, w, view);
+    r->list = r->queue.items;
+    r->list_len = w->len;
+
+    // keep only the objects whose box intersects the view frustum (in the same order)
+    if (r->cull == CULL_CPU) {
+        render_tree(r, w);
+
+        mat4x4 clip;
+        simd.mat4x4_mul(clip, cam.p, view);
+        bvh_frustum(&r->tree, w, clip, r->visible);
+
+        uint n = 0;
+        for (uint k = 0; k < w->len; k++)
+            if (r->visible[drawn(r, k)])
+                r->culled[n++] = drawn(r, k);
+        r->list = r->culled;
+        r->list_len = n;
+    }
+
+    // dense meshes are drawn simplified when they are small on the screen
+    render_levels(r, w, view);
+
+    // full meshes split into meshlets are culled meshlet by meshlet, after the rest of the draw list
+    render_clusters(r, w, view);
+
+    // draw each object
+    if (r->mode == DRAW_MDI) {
+        render_commands(r, w);
+        upload_frame(r, w, view);
+        if (r->cull == CULL_GPU)
+            cull_dispatch(&r->culling, cam.p, &r->occlusion, view);
+    } else
+        upload_frame(r, w, view);
+    gpu_timer_mark(gt, GPU_CULL);
+
+    // the draws only bind what changed since the first of them (the culling pass uses a program of its own),
+    // and every mesh is read through the same VAO
+    state_reset(&r->state);
+    state_vao(&r->state, w->meshes.vao);
+    if (r->mode == DRAW_MDI)
+        draw_mdi(r, w);
+    else if (r->mode == DRAW_INSTANCED)
+        draw_instanced(r, w);
+    else
+        draw_loop(r, w);
+    draw_clusters(r, w);
+    gpu_timer_mark(gt, GPU_DRAW);
+
+    // the depth this frame left is what the next one's objects are tested against
+    mat4x4 clip;
+    simd.mat4x4_mul(clip, cam.p, view);
+    hiz_build(&r->occlusion, clip, WIDTH, HEIGHT);
+    hiz_show(&r->occlusion, cam.p);
+    gpu_timer_mark(gt, GPU_HIZ);
+
+    // the GPU owns this frame's regions until the draws above complete
+    stream_fence(&r->frame);
+    stream_fence(&r->objects);
+}
+
+handle render_pick(renderer *r, world *w, const float x, const float y) {
+    render_tree(r, w);
+
+    // the points under the cursor on the near and far planes, in world space
+    mat4x4 clip, inv;
+    simd.mat4x4_mul(clip, cam.p, r->view);
+    simd.mat4x4_invert(inv, clip);
+
+    vec4 ends[2];
+    for (uint e = 0; e < 2; e++) {
+        const vec4 ndc = {x, y, e ? 1.0f : -1.0f, 1.0f};
+        simd.mat4x4_mul_vec4(ends[e], inv, ndc);
+        vec4_scale(ends[e], ends[e], 1.0f / ends[e][3]);
+    }
+
+    vec3 dir;
+    vec3_sub(dir, ends[1], ends[0]);
+
+    float t;
+    const uint i = bvh_raycast(&r->tree, w, ends[0], dir, &t);
+    return i == BVH_NONE ? HANDLE_NULL : world_handle(w, i);
+}
+
+void render_free(renderer *r) {
+    if (r->cull == CULL_GPU)
+        cull_free(&r->culling);
+    hiz_free(&r->occlusion);
+    bvh_free(&r->tree);
+    stream_free(&r->frame);
+    stream_free(&r->objects);
+    glDeleteBuffers(1, &r->commands_buffer);
+    glDeleteBuffers(1, &r->cluster_buffer);
+    queue_free(&r->queue);
+    free(r->commands);
+    free(r->batches);
+    free(r->visible);
+    free(r->culled);
+    free(r->levels);
+    free(r->split);
+    free(r->partition);
+    free(r->cluster_first);
+    free(r->cluster_visible);
+    free(r->cluster_ids);
+    free(r->cluster_commands);
+    free(r->cluster_batches);
+    memset(r, 0, sizeof(*r));
+}
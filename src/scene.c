@@ -0,0 +1,118 @@
+/// Scene generator, populating the world with many objects for scaling tests.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "fpsdbg.h"
+#include "scene.h"
+
+
+// distance between the centers of neighboring grid cells
+#define SCENE_SPACING 2.0f
+
+// number of objects per cluster of the clustered layout
+#define SCENE_CLUSTER_SIZE 1000
+
+const char *LAYOUT_NAMES[3] = {"grid", "random", "clustered"};
+const char *MESH_NAMES[3] = {"cube", "sphere", "mixed"};
+
+
+/// @brief Small deterministic PRNG (xorshift64*), so a seed always produces the same scene
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 2685821657736338717ull;
+}
+
+/// @brief Uniform float in [0, 1)
+static float rng_float(uint64_t *s) {
+    return (rng_next(s) >> 40) / 16777216.0f;
+}
+
+/// @brief Uniform float in [-l, l)
+static float rng_range(uint64_t *s, const float l) {
+    return (rng_float(s) * 2.0f - 1.0f) * l;
+}
+
+/// @brief Normally distributed float (Box-Muller)
+static float rng_gauss(uint64_t *s, const float sigma) {
+    const float u = rng_float(s) + 1e-7f, v = rng_float(s);
+    return sigma * sqrtf(-2.0f * logf(u)) * cosf(M_TAU * v);
+}
+
+scene_info generate_scene(world *wd, const uint program, const scene_desc *sd) {
+    scene_info info = {0};
+    world_reserve(wd, wd->len + sd->objects);
+    uint64_t rng = sd->seed * 0x9E3779B97F4A7C15ull + 1;
+
+    // the grid is a cube of `side` cells, and the other layouts fill a similar volume
+    uint side = cbrt(sd->objects);
+    while (side * side * side < sd->objects)
+        side++;
+    const float half = (side - 1) * SCENE_SPACING / 2.0f;
+    const float extent = side * SCENE_SPACING / 2.0f;
+
+    // cluster centers are drawn up front, so the objects can be spread over them evenly
+    const uint clusters = 1 + sd->objects / SCENE_CLUSTER_SIZE;
+    const float sigma = SCENE_SPACING * cbrtf((float)sd->objects / clusters) / 2.0f;
+    vec3 *centers = NULL;
+    if (sd->layout == LAYOUT_CLUSTERED) {
+        centers = malloc(clusters * sizeof(vec3));
+        if (!centers) {
+            error("Failed to allocate cluster centers.");
+            exit(EXIT_FAILURE);
+        }
+        for (uint k = 0; k < clusters; k++)
+            for (uint l = 0; l < 3; l++)
+                centers[k][l] = rng_range(&rng, extent - sigma > 0.0f ? extent - sigma : 0.0f);
+    }
+
+    // sphere resolutions of the mixed meshes (small to large)
+    const uint details[3] = {
+        sd->detail / 4 < 4 ? 4 : sd->detail / 4,
+        sd->detail / 2 < 4 ? 4 : sd->detail / 2,
+        sd->detail < 4 ? 4 : sd->detail
+    };
+
+    for (uint i = 0; i < sd->objects; i++) {
+        vec3 p;
+        switch (sd->layout) {
+            case LAYOUT_GRID:
+                p[0] = (i % side) * SCENE_SPACING - half;
+                p[1] = (i / side % side) * SCENE_SPACING - half;
+                p[2] = (i / side / side) * SCENE_SPACING - half;
+                break;
+            case LAYOUT_RANDOM:
+                for (uint l = 0; l < 3; l++)
+                    p[l] = rng_range(&rng, extent);
+                break;
+            case LAYOUT_CLUSTERED:
+                for (uint l = 0; l < 3; l++)
+                    p[l] = centers[i % clusters][l] + rng_gauss(&rng, sigma);
+                break;
+        }
+
+        // pick the mesh: cubes, detailed spheres, or a mix of both at several resolutions
+        const uint kind = sd->mesh == MESH_MIXED ? rng_next(&rng) % 4 : sd->mesh == MESH_SPHERE ? 3 : 0;
+        if (!kind) {
+            create_rect(wd, program, (vec3) {
+                p[0] - 0.5f, p[1] - 0.5f, p[2] - 0.5f
+            }, (vec3) {
+                1, 1, 1
+            });
+            info.triangles += 12;
+        } else {
+            const uint seg = details[kind - 1];
+            create_sphere(wd, program, p, 0.5f, seg);
+            info.triangles += (uint64_t)(seg / 2) * seg * 2;
+        }
+
+        // every mesh fits into a unit cube around `p`
+        const float r = vec3_len(p) + 0.87f;
+        if (r > info.radius)
+            info.radius = r;
+    }
+
+    free(centers);
+    return info;
+}
@@ -0,0 +1,204 @@
+/// Binary scene files: meshes with their normals, bounds and simplified versions, and the objects placing them, laid
+/// out so the file is mapped into memory and its blocks handed to GL as they are, without any parsing.
+/// A file is a header, then page-aligned blocks (vertices, indices, meshes and objects), all little-endian.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "fpsdbg.h"
+#include "scenefile.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/// @brief Size of an element of each block
+static const size_t BLOCK_STRIDES[SCENEFILE_BLOCKS] = {
+    sizeof(vertex), sizeof(uint32_t), sizeof(scenefile_mesh), sizeof(scenefile_object)
+};
+
+
+/// @brief Check the header, the blocks and the meshes, and point the file's arrays at the blocks
+/// @return what is wrong with the file, or `NULL`
+static const char *scenefile_check(scene_file *sf) {
+    const scenefile_header *h = sf->map;
+    if (memcmp(h->magic, SCENEFILE_MAGIC, sizeof(SCENEFILE_MAGIC)))
+        return "not a scene file";
+    if (h->version != SCENEFILE_VERSION)
+        return "unsupported version";
+    if (h->vertex_size != sizeof(vertex) || h->mesh_size != sizeof(scenefile_mesh) || h->object_size != sizeof(scenefile_object))
+        return "unsupported layout";
+
+    const void *blocks[SCENEFILE_BLOCKS];
+    uint lens[SCENEFILE_BLOCKS];
+    for (uint b = 0; b < SCENEFILE_BLOCKS; b++) {
+        const scenefile_range r = h->blocks[b];
+        if (r.offset % SCENEFILE_ALIGN || r.offset > sf->size || r.size > sf->size - r.offset)
+            return "block out of the file";
+        if (r.size % BLOCK_STRIDES[b] || r.size / BLOCK_STRIDES[b] > UINT_MAX)
+            return "block of a bad size";
+        blocks[b] = (const char *)sf->map + r.offset;
+        lens[b] = r.size / BLOCK_STRIDES[b];
+    }
+    sf->vertices = blocks[SCENEFILE_VERTICES], sf->vertices_len = lens[SCENEFILE_VERTICES];
+    sf->indices = blocks[SCENEFILE_INDICES], sf->indices_len = lens[SCENEFILE_INDICES];
+    sf->meshes = blocks[SCENEFILE_MESHES], sf->meshes_len = lens[SCENEFILE_MESHES];
+    sf->objects = blocks[SCENEFILE_OBJECTS], sf->objects_len = lens[SCENEFILE_OBJECTS];
+
+    for (uint i = 0; i < sf->meshes_len; i++) {
+        const scenefile_mesh *m = &sf->meshes[i];
+        if ((uint64_t)m->first_vertex + m->vertices_len > sf->vertices_len ||
+                (uint64_t)m->first_index + m->indices_len > sf->indices_len)
+            return "mesh out of its blocks";
+        if (m->lods > LOD_MAX || (m->lods && !m->indices_len))
+            return "bad simplified versions";
+        for (uint l = 0; l < m->lods; l++)
+            if ((uint64_t)m->lod[l].first_index + m->lod[l].indices_len > sf->indices_len)
+                return "mesh out of its blocks";
+        if (!memchr(m->name, '\0', MESH_NAME_LEN))
+            return "mesh name without a terminator";
+    }
+    for (uint i = 0; i < sf->objects_len; i++)
+        if (sf->objects[i].mesh >= sf->meshes_len)
+            return "object of a missing mesh";
+    return NULL;
+}
+
+int scenefile_open(scene_file *sf, const char *path) {
+    memset(sf, 0, sizeof(*sf));
+    const int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st)) {
+        fprintf(stderr, "Error: can't read '%s'\n", path);
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+
+    sf->size = st.st_size;
+    if (sf->size < sizeof(scenefile_header)) {
+        fprintf(stderr, "Error: %s: not a scene file\n", path);
+        close(fd);
+        return 0;
+    }
+
+    // the mapping outlives the descriptor
+    sf->map = mmap(NULL, sf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (sf->map == MAP_FAILED) {
+        fprintf(stderr, "Error: can't map '%s'\n", path);
+        sf->map = NULL;
+        return 0;
+    }
+
+    // the blocks are read once, front to back, so the kernel may read ahead as far as it likes
+    madvise(sf->map, sf->size, MADV_SEQUENTIAL);
+    madvise(sf->map, sf->size, MADV_WILLNEED);
+
+    const char *fault = scenefile_check(sf);
+    if (fault) {
+        fprintf(stderr, "Error: %s: %s\n", path, fault);
+        scenefile_close(sf);
+        return 0;
+    }
+    return 1;
+}
+
+scene_info scenefile_load(const scene_file *sf, world *wd, const uint program) {
+    scene_info info = {0};
+
+    // the arenas grow once, then every mesh is copied by GL straight out of the mapped pages
+    mesh_reserve(&wd->meshes, sf->vertices_len, sf->indices_len);
+    const uint base = wd->meshes.len;
+    for (uint i = 0; i < sf->meshes_len; i++) {
+        const scenefile_mesh *m = &sf->meshes[i];
+        const uint me = mesh_upload(&wd->meshes, m->name[0] ? m->name : NULL, m->vertices_len, m->indices_len,
+                                    sf->vertices + m->first_vertex, m->indices_len ? sf->indices + m->first_index : NULL,
+                                    m->mode, &m->box, m->sphere);
+
+        // the simplified versions were made when the file was written, so only their indices are uploaded
+        const uint lods = m->lods < wd->meshes.lods ? m->lods : wd->meshes.lods;
+        for (uint l = 0; l < lods; l++)
+            mesh_lod(&wd->meshes, me, sf->vertices + m->first_vertex, m->lod[l].indices_len,
+                     sf->indices + m->lod[l].first_index, m->lod[l].error);
+    }
+
+    const uint objects = sf->objects_len ? sf->objects_len : sf->meshes_len;
+    world_reserve(wd, wd->len + objects);
+    for (uint i = 0; i < objects; i++) {
+        mat4x4 model;
+        uint me = i;
+        if (sf->objects_len) {
+            mat4x4_dup(model, sf->objects[i].model);
+            me = sf->objects[i].mesh;
+        } else
+            mat4x4_identity(model);
+        create_instance(wd, program, base + me, model);
+
+        const scenefile_mesh *m = &sf->meshes[me];
+        info.triangles += (m->indices_len ? m->indices_len : m->vertices_len) / 3;
+
+        // the bounding sphere moved into place, and grown by the model's largest scale
+        const vec4 center = {m->sphere[0], m->sphere[1], m->sphere[2], 1.0f};
+        vec4 c;
+        mat4x4_mul_vec4(c, model, center);
+        float scale = 0.0f;
+        for (uint k = 0; k < 3; k++)
+            scale = fmaxf(scale, vec3_len(model[k]));
+        const float r = vec3_len(c) + m->sphere[3] * scale;
+        if (r > info.radius)
+            info.radius = r;
+    }
+    return info;
+}
+
+void scenefile_close(scene_file *sf) {
+    if (sf->map)
+        munmap(sf->map, sf->size);
+    memset(sf, 0, sizeof(*sf));
+}
+
+int scenefile_write(const char *path, const vertex *vertices, const uint vertices_len, const uint32_t *indices,
+                    const uint indices_len, const scenefile_mesh *meshes, const uint meshes_len,
+                    const scenefile_object *objects, const uint objects_len) {
+    static const char zeros[SCENEFILE_ALIGN];
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Error: can't write '%s'\n", path);
+        return 0;
+    }
+
+    scenefile_header h = {
+        SCENEFILE_MAGIC, SCENEFILE_VERSION, sizeof(vertex), sizeof(scenefile_mesh), sizeof(scenefile_object)
+    };
+    const void *data[SCENEFILE_BLOCKS] = {vertices, indices, meshes, objects};
+    const uint lens[SCENEFILE_BLOCKS] = {vertices_len, indices_len, meshes_len, objects_len};
+
+    // every block starts on a page of its own
+    uint64_t offset = sizeof(h);
+    for (uint b = 0; b < SCENEFILE_BLOCKS; b++) {
+        offset = (offset + SCENEFILE_ALIGN - 1) / SCENEFILE_ALIGN * SCENEFILE_ALIGN;
+        h.blocks[b] = (scenefile_range) {
+            offset, lens[b] * BLOCK_STRIDES[b]
+        };
+        offset += h.blocks[b].size;
+    }
+
+    fwrite(&h, sizeof(h), 1, f);
+    uint64_t written = sizeof(h);
+    for (uint b = 0; b < SCENEFILE_BLOCKS; b++) {
+        fwrite(zeros, 1, h.blocks[b].offset - written, f);
+        if (h.blocks[b].size)
+            fwrite(data[b], 1, h.blocks[b].size, f);
+        written = h.blocks[b].offset + h.blocks[b].size;
+    }
+
+    const int ok = !ferror(f);
+    if (fclose(f) || !ok) {
+        fprintf(stderr, "Error: can't write '%s'\n", path);
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,592 @@
+/// SIMD versions of the hot linmath functions, picked at runtime from the features of the CPU.
+/// The scalar linmath functions stay the reference, and the fallback on every other CPU.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "simd.h"
+#include "prof.h"
+#include <float.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define SIMD_X86
+    #include <immintrin.h>
+
+    // compiled for the given instruction sets, whatever the rest of the build targets
+    #define SIMD_TARGET(isa) __attribute__((target(isa)))
+
+    // lanes `x`, `y`, `z` and `w` of a vector
+    #define SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, (x) | (y) << 2 | (z) << 4 | (w) << 6)
+    // lanes `x` and `y` of `a`, then `z` and `w` of `b`
+    #define SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, (x) | (y) << 2 | (z) << 4 | (w) << 6)
+#endif
+
+
+const char *SIMD_LEVEL_NAMES[SIMD_LEVEL_COUNT] = {"scalar", "sse4.1", "avx2"};
+
+
+static void scalar_mat4x4_mul_batch(mat4x4 *out, mat4x4 const a, mat4x4 const *b, const uint *index, const uint n) {
+    for (uint i = 0; i < n; i++)
+        mat4x4_mul(out[i], a, b[index ? index[i] : i]);
+}
+
+static void scalar_mat4x4_rotate_Y_batch(mat4x4 *out, mat4x4 const *in, const float *angles, const uint n) {
+    for (uint i = 0; i < n; i++)
+        mat4x4_rotate_Y(out[i], in[i], angles[i]);
+}
+
+static void scalar_tri_normals(vec3 *out, const vec3 *positions, const uint *index, const uint n, const int unit) {
+    for (uint i = 0; i < n; i++) {
+        const uint c = 3 * i;
+        const float *a = positions[index ? index[c] : c];
+        const float *b = positions[index ? index[c + 1] : c + 1];
+        const float *d = positions[index ? index[c + 2] : c + 2];
+
+        vec3 u, v;
+        vec3_sub(u, b, a);
+        vec3_sub(v, d, a);
+        vec3_mul_cross(out[i], u, v);
+
+        if (unit) {
+            const float len = vec3_len(out[i]);
+            vec3_scale(out[i], out[i], len > 0.0f ? 1.0f / len : 0.0f);
+        }
+    }
+}
+
+static const simd_kernels SCALAR = {
+    SIMD_SCALAR, mat4x4_mul, mat4x4_mul_vec4, mat4x4_invert, quat_mul,
+    scalar_mat4x4_mul_batch, scalar_mat4x4_rotate_Y_batch, scalar_tri_normals
+};
+
+simd_kernels simd = {
+    SIMD_SCALAR, mat4x4_mul, mat4x4_mul_vec4, mat4x4_invert, quat_mul,
+    scalar_mat4x4_mul_batch, scalar_mat4x4_rotate_Y_batch, scalar_tri_normals
+};
+
+
+#ifdef SIMD_X86
+
+// The SSE4.1 products add up their terms in the same order as linmath, so they match it bit for bit.
+
+SIMD_TARGET("sse4.1")
+static void sse_mat4x4_mul(mat4x4 M, mat4x4 const a, mat4x4 const b) {
+    const __m128 a0 = _mm_loadu_ps(a[0]), a1 = _mm_loadu_ps(a[1]), a2 = _mm_loadu_ps(a[2]), a3 = _mm_loadu_ps(a[3]);
+
+    // column `c` of the product is the columns of `a` weighed by column `c` of `b`
+    __m128 r[4];
+    for (uint c = 0; c < 4; c++) {
+        r[c] = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(a0, _mm_set1_ps(b[c][0])));
+        r[c] = _mm_add_ps(r[c], _mm_mul_ps(a1, _mm_set1_ps(b[c][1])));
+        r[c] = _mm_add_ps(r[c], _mm_mul_ps(a2, _mm_set1_ps(b[c][2])));
+        r[c] = _mm_add_ps(r[c], _mm_mul_ps(a3, _mm_set1_ps(b[c][3])));
+    }
+
+    // `M` may be `a` or `b`, so nothing is stored before everything is read
+    for (uint c = 0; c < 4; c++)
+        _mm_storeu_ps(M[c], r[c]);
+}
+
+SIMD_TARGET("sse4.1")
+static void sse_mat4x4_mul_vec4(vec4 r, mat4x4 const M, vec4 const v) {
+    __m128 x = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(_mm_loadu_ps(M[0]), _mm_set1_ps(v[0])));
+    x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(M[1]), _mm_set1_ps(v[1])));
+    x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(M[2]), _mm_set1_ps(v[2])));
+    x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(M[3]), _mm_set1_ps(v[3])));
+    _mm_storeu_ps(r, x);
+}
+
+/// @brief Product of 2x2 matrices stored as `(m00, m01, m10, m11)`
+SIMD_TARGET("sse4.1")
+static inline __m128 mat2_mul(const __m128 a, const __m128 b) {
+    return _mm_add_ps(_mm_mul_ps(a, SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+/// @brief Adjugate of a 2x2 matrix times another
+SIMD_TARGET("sse4.1")
+static inline __m128 mat2_adj_mul(const __m128 a, const __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(SWIZZLE(a, 1, 1, 2, 2), SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+/// @brief A 2x2 matrix times the adjugate of another
+SIMD_TARGET("sse4.1")
+static inline __m128 mat2_mul_adj(const __m128 a, const __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(a, SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+/// Inverse from the 2x2 blocks `A B; C D` of the matrix, whose adjugates give the blocks of the inverse:
+/// `|D|A - B(D#C)`, `|B|C - D(A#B)#`, `|C|B - A(D#C)#` and `|A|D - C(A#B)`, over
+/// `|M| = |A||D| + |B||C| - tr((A#B)(D#C))`. As linmath, it assumes the matrix is invertible.
+SIMD_TARGET("sse4.1")
+static void sse_mat4x4_invert(mat4x4 T, mat4x4 const M) {
+    const __m128 m0 = _mm_loadu_ps(M[0]), m1 = _mm_loadu_ps(M[1]), m2 = _mm_loadu_ps(M[2]), m3 = _mm_loadu_ps(M[3]);
+
+    // the blocks (of the transpose, as linmath is column-major, which inverts into the transposed inverse)
+    const __m128 A = _mm_movelh_ps(m0, m1), B = _mm_movehl_ps(m1, m0);
+    const __m128 C = _mm_movelh_ps(m2, m3), D = _mm_movehl_ps(m3, m2);
+
+    // determinants of the blocks, as (|A|, |B|, |C|, |D|)
+    const __m128 det = _mm_sub_ps(_mm_mul_ps(SHUFFLE(m0, m2, 0, 2, 0, 2), SHUFFLE(m1, m3, 1, 3, 1, 3)),
+                                  _mm_mul_ps(SHUFFLE(m0, m2, 1, 3, 1, 3), SHUFFLE(m1, m3, 0, 2, 0, 2)));
+    const __m128 det_a = SWIZZLE(det, 0, 0, 0, 0), det_b = SWIZZLE(det, 1, 1, 1, 1);
+    const __m128 det_c = SWIZZLE(det, 2, 2, 2, 2), det_d = SWIZZLE(det, 3, 3, 3, 3);
+
+    const __m128 dc = mat2_adj_mul(D, C), ab = mat2_adj_mul(A, B);
+    __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, A), mat2_mul(B, dc));
+    __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, D), mat2_mul(C, ab));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, C), mat2_mul_adj(D, ab));
+    __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, B), mat2_mul_adj(A, dc));
+
+    // the trace of the product is a dot product
+    const __m128 tr = _mm_dp_ps(ab, SWIZZLE(dc, 0, 2, 1, 3), 0xFF);
+    const __m128 det_m = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), tr);
+
+    // the signs of the adjugates, over the determinant
+    const __m128 r = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det_m);
+    x = _mm_mul_ps(x, r), y = _mm_mul_ps(y, r), z = _mm_mul_ps(z, r), w = _mm_mul_ps(w, r);
+
+    // transposing the adjugates and putting the blocks back together are one shuffle
+    _mm_storeu_ps(T[0], SHUFFLE(x, y, 3, 1, 3, 1));
+    _mm_storeu_ps(T[1], SHUFFLE(x, y, 2, 0, 2, 0));
+    _mm_storeu_ps(T[2], SHUFFLE(z, w, 3, 1, 3, 1));
+    _mm_storeu_ps(T[3], SHUFFLE(z, w, 2, 0, 2, 0));
+}
+
+SIMD_TARGET("sse4.1")
+static void sse_quat_mul(quat r, quat const p, quat const q) {
+    const __m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(q);
+
+    // p x q + p q.w + q p.w, then p.w q.w - p.q
+    __m128 v = _mm_sub_ps(_mm_mul_ps(SWIZZLE(a, 1, 2, 0, 3), SWIZZLE(b, 2, 0, 1, 3)),
+                          _mm_mul_ps(SWIZZLE(a, 2, 0, 1, 3), SWIZZLE(b, 1, 2, 0, 3)));
+    v = _mm_add_ps(v, _mm_mul_ps(a, SWIZZLE(b, 3, 3, 3, 3)));
+    v = _mm_add_ps(v, _mm_mul_ps(b, SWIZZLE(a, 3, 3, 3, 3)));
+
+    const __m128 s = _mm_sub_ps(_mm_mul_ps(a, b), _mm_dp_ps(a, b, 0x78));
+    _mm_storeu_ps(r, _mm_blend_ps(v, s, 0x8));
+}
+
+SIMD_TARGET("sse4.1")
+static void sse_mat4x4_mul_batch(mat4x4 *out, mat4x4 const a, mat4x4 const *b, const uint *index, const uint n) {
+    // `a` stays in registers for the whole batch
+    const __m128 a0 = _mm_loadu_ps(a[0]), a1 = _mm_loadu_ps(a[1]), a2 = _mm_loadu_ps(a[2]), a3 = _mm_loadu_ps(a[3]);
+
+    for (uint i = 0; i < n; i++) {
+        const vec4 *m = b[index ? index[i] : i];
+        __m128 r[4];
+        for (uint c = 0; c < 4; c++) {
+            r[c] = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(a0, _mm_set1_ps(m[c][0])));
+            r[c] = _mm_add_ps(r[c], _mm_mul_ps(a1, _mm_set1_ps(m[c][1])));
+            r[c] = _mm_add_ps(r[c], _mm_mul_ps(a2, _mm_set1_ps(m[c][2])));
+            r[c] = _mm_add_ps(r[c], _mm_mul_ps(a3, _mm_set1_ps(m[c][3])));
+        }
+        for (uint c = 0; c < 4; c++)
+            _mm_storeu_ps(out[i][c], r[c]);
+    }
+}
+
+/// Sine and cosine of four angles at once (Cephes' single-precision polynomials, after reducing the
+/// angles to `[-pi/4, pi/4]` in three steps, so they stay within a few ulp of `sinf` and `cosf`
+/// for angles up to a few thousand radians).
+SIMD_TARGET("sse4.1")
+static void sincos4(const __m128 angles, __m128 *sin, __m128 *cos) {
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 x = _mm_andnot_ps(sign, angles);
+    __m128 sin_sign = _mm_and_ps(sign, angles);
+
+    // octant of each angle, rounded up to an even one
+    __m128i q = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+    q = _mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    const __m128 y = _mm_cvtepi32_ps(q);
+
+    // the octant's quadrant flips the sines and cosines, and picks the polynomial of each
+    sin_sign = _mm_xor_ps(sin_sign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(4)), 29)));
+    const __m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(
+                                _mm_andnot_si128(_mm_sub_epi32(q, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+    const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+    // x - y pi/4, with pi/4 split into three parts so the product is exact
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+    const __m128 z = _mm_mul_ps(x, x);
+
+    // cosine and sine polynomials on [-pi/4, pi/4]
+    __m128 c = _mm_set1_ps(2.443315711809948e-5f);
+    c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(-1.388731625493765e-3f));
+    c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(4.166664568298827e-2f));
+    c = _mm_mul_ps(_mm_mul_ps(c, z), z);
+    c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    __m128 s = _mm_set1_ps(-1.9515295891e-4f);
+    s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(8.3321608736e-3f));
+    s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(-1.6666654611e-1f));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), x), x);
+
+    *sin = _mm_xor_ps(_mm_blendv_ps(c, s, swap), sin_sign);
+    *cos = _mm_xor_ps(_mm_blendv_ps(s, c, swap), cos_sign);
+}
+
+SIMD_TARGET("sse4.1")
+static void sse_mat4x4_rotate_Y_batch(mat4x4 *out, mat4x4 const *in, const float *angles, const uint n) {
+    for (uint i = 0; i < n; i += 4) {
+        const uint len = n - i < 4 ? n - i : 4;
+
+        // the sines and cosines of four matrices at once
+        float a[4] = {0.0f, 0.0f, 0.0f, 0.0f}, s[4], c[4];
+        memcpy(a, &angles[i], len * sizeof(float));
+        __m128 vs, vc;
+        sincos4(_mm_loadu_ps(a), &vs, &vc);
+        _mm_storeu_ps(s, vs);
+        _mm_storeu_ps(c, vc);
+
+        // a rotation about Y only mixes the first and third columns
+        for (uint j = 0; j < len; j++) {
+            const __m128 m0 = _mm_loadu_ps(in[i + j][0]), m2 = _mm_loadu_ps(in[i + j][2]);
+            const __m128 sj = _mm_set1_ps(s[j]), cj = _mm_set1_ps(c[j]);
+            _mm_storeu_ps(out[i + j][1], _mm_loadu_ps(in[i + j][1]));
+            _mm_storeu_ps(out[i + j][3], _mm_loadu_ps(in[i + j][3]));
+            _mm_storeu_ps(out[i + j][0], _mm_sub_ps(_mm_mul_ps(m0, cj), _mm_mul_ps(m2, sj)));
+            _mm_storeu_ps(out[i + j][2], _mm_add_ps(_mm_mul_ps(m0, sj), _mm_mul_ps(m2, cj)));
+        }
+    }
+}
+
+/// @brief Load a `vec3` into the first three lanes, without reading past its end
+SIMD_TARGET("sse4.1")
+static inline __m128 load_vec3(const float *v) {
+    // the first two floats as one unaligned 64-bit load (a `double` load would assume 8-byte alignment)
+    return _mm_movelh_ps(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)v)), _mm_load_ss(v + 2));
+}
+
+/// @brief Store the first three lanes into a `vec3`
+SIMD_TARGET("sse4.1")
+static inline void store_vec3(float *v, const __m128 x) {
+    _mm_storel_pi((__m64 *)v, x);
+    _mm_store_ss(v + 2, _mm_movehl_ps(x, x));
+}
+
+/// Face normals of four triangles at a time, with each corner transposed into one register per axis
+/// (loaded whole when the triangles aren't indexed). The products are linmath's, so they match it
+/// bit for bit, but unit normals are scaled by an estimate of the inverse square root, refined once.
+SIMD_TARGET("sse4.1")
+static void sse_tri_normals(vec3 *out, const vec3 *positions, const uint *index, const uint n, const int unit) {
+    uint i = 0;
+    for (; i + 4 <= n; i += 4) {
+        // `p[k][l]` is corner `k` of the four triangles, along axis `l`
+        __m128 p[3][4];
+        for (uint k = 0; k < 3; k++) {
+            const uint c = 3 * i + k;
+            if (index)
+                for (uint j = 0; j < 4; j++)
+                    p[k][j] = load_vec3(positions[index[c + 3 * j]]);
+            else if (i + 4 < n)
+                // whole registers read the first float of the next vertex, which is only there before the last triangle
+                for (uint j = 0; j < 4; j++)
+                    p[k][j] = _mm_loadu_ps(positions[c + 3 * j]);
+            else
+                for (uint j = 0; j < 4; j++)
+                    p[k][j] = load_vec3(positions[c + 3 * j]);
+            _MM_TRANSPOSE4_PS(p[k][0], p[k][1], p[k][2], p[k][3]);
+        }
+
+        const __m128 ux = _mm_sub_ps(p[1][0], p[0][0]), uy = _mm_sub_ps(p[1][1], p[0][1]), uz = _mm_sub_ps(p[1][2], p[0][2]);
+        const __m128 vx = _mm_sub_ps(p[2][0], p[0][0]), vy = _mm_sub_ps(p[2][1], p[0][1]), vz = _mm_sub_ps(p[2][2], p[0][2]);
+        __m128 x = _mm_sub_ps(_mm_mul_ps(uy, vz), _mm_mul_ps(uz, vy));
+        __m128 y = _mm_sub_ps(_mm_mul_ps(uz, vx), _mm_mul_ps(ux, vz));
+        __m128 z = _mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(uy, vx));
+
+        if (unit) {
+            // the estimate of 1 / sqrt and one Newton step, zero for degenerate triangles
+            const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+            const __m128 e = _mm_rsqrt_ps(d);
+            __m128 k = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), e), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(d, e), e)));
+            k = _mm_and_ps(k, _mm_cmpge_ps(d, _mm_set1_ps(FLT_MIN)));
+            x = _mm_mul_ps(x, k), y = _mm_mul_ps(y, k), z = _mm_mul_ps(z, k);
+        }
+
+        // back to one normal per register
+        __m128 w = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        store_vec3(out[i], x);
+        store_vec3(out[i + 1], y);
+        store_vec3(out[i + 2], z);
+        store_vec3(out[i + 3], w);
+    }
+
+    // the last few triangles, one at a time
+    if (i < n)
+        scalar_tri_normals(out + i, positions, index ? index + 3 * i : NULL, n - i, unit);
+}
+
+// The AVX2 product works on two columns at a time and fuses its multiplies and adds, so it
+// rounds differently from linmath (well within the tolerance).
+
+SIMD_TARGET("avx2,fma")
+static void avx2_mat4x4_mul(mat4x4 M, mat4x4 const a, mat4x4 const b) {
+    // each column of `a` in both halves, and columns 0 and 1 (then 2 and 3) of `b`
+    const __m256 a0 = _mm256_broadcast_ps((const __m128 *)a[0]), a1 = _mm256_broadcast_ps((const __m128 *)a[1]);
+    const __m256 a2 = _mm256_broadcast_ps((const __m128 *)a[2]), a3 = _mm256_broadcast_ps((const __m128 *)a[3]);
+    const __m256 b01 = _mm256_loadu_ps(b[0]), b23 = _mm256_loadu_ps(b[2]);
+
+    __m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+    __m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+    r01 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, 0x55), r01);
+    r23 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, 0x55), r23);
+    r01 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, 0xAA), r01);
+    r23 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, 0xAA), r23);
+    r01 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b01, 0xFF), r01);
+    r23 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b23, 0xFF), r23);
+
+    _mm256_storeu_ps(M[0], r01);
+    _mm256_storeu_ps(M[2], r23);
+}
+
+static const simd_kernels SSE41 = {
+    SIMD_SSE41, sse_mat4x4_mul, sse_mat4x4_mul_vec4, sse_mat4x4_invert, sse_quat_mul,
+    sse_mat4x4_mul_batch, sse_mat4x4_rotate_Y_batch, sse_tri_normals
+};
+
+SIMD_TARGET("avx2,fma")
+static void avx2_mat4x4_mul_batch(mat4x4 *out, mat4x4 const a, mat4x4 const *b, const uint *index, const uint n) {
+    const __m256 a0 = _mm256_broadcast_ps((const __m128 *)a[0]), a1 = _mm256_broadcast_ps((const __m128 *)a[1]);
+    const __m256 a2 = _mm256_broadcast_ps((const __m128 *)a[2]), a3 = _mm256_broadcast_ps((const __m128 *)a[3]);
+
+    for (uint i = 0; i < n; i++) {
+        const vec4 *m = b[index ? index[i] : i];
+        const __m256 b01 = _mm256_loadu_ps(m[0]), b23 = _mm256_loadu_ps(m[2]);
+
+        __m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+        __m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+        r01 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, 0x55), r01);
+        r23 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, 0x55), r23);
+        r01 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, 0xAA), r01);
+        r23 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, 0xAA), r23);
+        r01 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b01, 0xFF), r01);
+        r23 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b23, 0xFF), r23);
+
+        _mm256_storeu_ps(out[i][0], r01);
+        _mm256_storeu_ps(out[i][2], r23);
+    }
+}
+
+// a single vector or quaternion leaves nothing for the wider registers (and a chain of fused
+// multiply-adds is slower than the independent multiplies), the inverse is mostly shuffles, and
+// the rotations are bound by their sines and cosines, and the normals by gathering their corners
+static const simd_kernels AVX2 = {
+    SIMD_AVX2, avx2_mat4x4_mul, sse_mat4x4_mul_vec4, sse_mat4x4_invert, sse_quat_mul,
+    avx2_mat4x4_mul_batch, sse_mat4x4_rotate_Y_batch, sse_tri_normals
+};
+
+#endif
+
+
+const simd_kernels *simd_kernels_of(const simd_level level) {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    switch (level) {
+        case SIMD_SSE41:
+            return __builtin_cpu_supports("sse4.1") ? &SSE41 : NULL;
+        case SIMD_AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? &AVX2 : NULL;
+        default:
+            break;
+    }
+#endif
+    return level == SIMD_SCALAR ? &SCALAR : NULL;
+}
+
+simd_level simd_init() {
+    for (int l = SIMD_LEVEL_COUNT - 1; l >= 0; l--) {
+        const simd_kernels *k = simd_kernels_of(l);
+        if (k) {
+            simd = *k;
+            break;
+        }
+    }
+    return simd.level;
+}
+
+
+/// @brief Kernels timed and checked by the benchmark
+typedef enum SimdKernel {
+    KERNEL_MUL,
+    KERNEL_MUL_VEC4,
+    KERNEL_INVERT,
+    KERNEL_QUAT_MUL,
+    KERNEL_MUL_BATCH,
+    KERNEL_ROTATE_Y_BATCH,
+    KERNEL_TRI_NORMALS,
+    KERNEL_COUNT
+} simd_kernel;
+
+static const char *KERNEL_NAMES[KERNEL_COUNT] = {
+    "mat4x4_mul", "mat4x4_mul_vec4", "mat4x4_invert", "quat_mul", "mat4x4_mul_batch", "mat4x4_rotate_Y_batch", "tri_normals"
+};
+
+
+/// @brief Run a kernel over every input (vectors and quaternions are the columns of `b`, and the
+/// batched product multiplies every `a` by the first `b`, the rotations take `angles`, and the
+/// normals are of the triangles packed into `a`)
+static void run_kernel(const simd_kernels *k, const simd_kernel kernel, const uint n, mat4x4 *a, mat4x4 *b,
+                       const float *angles, mat4x4 *out) {
+    switch (kernel) {
+        case KERNEL_MUL:
+            for (uint i = 0; i < n; i++)
+                k->mat4x4_mul(out[i], a[i], b[i]);
+            break;
+        case KERNEL_MUL_VEC4:
+            for (uint i = 0; i < n; i++)
+                k->mat4x4_mul_vec4(out[i][0], a[i], b[i][0]);
+            break;
+        case KERNEL_INVERT:
+            for (uint i = 0; i < n; i++)
+                k->mat4x4_invert(out[i], a[i]);
+            break;
+        case KERNEL_QUAT_MUL:
+            for (uint i = 0; i < n; i++)
+                k->quat_mul(out[i][0], b[i][1], b[i][2]);
+            break;
+        case KERNEL_MUL_BATCH:
+            k->mat4x4_mul_batch(out, b[0], a, NULL, n);
+            break;
+        case KERNEL_ROTATE_Y_BATCH:
+            k->mat4x4_rotate_Y_batch(out, a, angles, n);
+            break;
+        default:
+            k->tri_normals((vec3 *)out, (const vec3 *)a, NULL, n, 1);
+            break;
+    }
+}
+
+/// @brief Largest difference between two results, relative to the largest element of the reference
+static double max_error(const uint n, mat4x4 *out, mat4x4 *ref) {
+    double err = 0.0;
+    for (uint i = 0; i < n; i++) {
+        float scale = 0.0f, diff = 0.0f;
+        for (uint c = 0; c < 4; c++)
+            for (uint l = 0; l < 4; l++) {
+                scale = fmaxf(scale, fabsf(ref[i][c][l]));
+                diff = fmaxf(diff, fabsf(out[i][c][l] - ref[i][c][l]));
+            }
+        const double e = scale > 0.0f ? diff / scale : diff;
+        err = e > err ? e : err;
+    }
+    return err;
+}
+
+/// @brief Random float in [lo, hi) (xorshift, so every run checks the same inputs)
+static float random_float(uint64_t *state, const float lo, const float hi) {
+    *state ^= *state << 13, *state ^= *state >> 7, *state ^= *state << 17;
+    return lo + (hi - lo) * (*state >> 40) / (float)(1u << 24);
+}
+
+/// @brief Batched products split between threads
+typedef struct BatchJob {
+    vec4 *view;
+    mat4x4 *models, *out;
+} batch_job;
+
+static void batch_range(void *ctx, const uint first, const uint count) {
+    const batch_job *job = ctx;
+    simd.mat4x4_mul_batch(job->out + first, job->view, job->models + first, NULL, count);
+}
+
+uint simd_bench(job_pool *jobs, FILE *out) {
+    const uint n = SIMD_BENCH_INPUTS;
+    mat4x4 *a = malloc(n * sizeof(mat4x4)), *b = malloc(n * sizeof(mat4x4));
+    mat4x4 *res = malloc(n * sizeof(mat4x4)), *ref = malloc(n * sizeof(mat4x4));
+    float *angles = malloc(n * sizeof(float));
+    if (!a || !b || !res || !ref || !angles) {
+        error("Failed to allocate the kernel benchmark.");
+        exit(EXIT_FAILURE);
+    }
+
+    // matrices like the ones drawn (rotation, scale and translation), vectors, and unit quaternions
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (uint i = 0; i < n; i++) {
+        mat4x4 id;
+        mat4x4_identity(id);
+        mat4x4_rotate(a[i], id, random_float(&state, -1, 1), random_float(&state, -1, 1), random_float(&state, 0.1f, 1),
+                      random_float(&state, 0, M_TAU));
+        mat4x4_scale_aniso(a[i], a[i], random_float(&state, 0.5f, 2), random_float(&state, 0.5f, 2), random_float(&state, 0.5f, 2));
+        for (uint l = 0; l < 3; l++)
+            a[i][3][l] = random_float(&state, -100, 100);
+
+        for (uint c = 0; c < 4; c++)
+            for (uint l = 0; l < 4; l++)
+                b[i][c][l] = random_float(&state, -10, 10);
+        quat_norm(b[i][1], b[i][1]);
+        quat_norm(b[i][2], b[i][2]);
+
+        // a few turns either way
+        angles[i] = random_float(&state, -2 * M_TAU, 2 * M_TAU);
+    }
+
+    uint failures = 0;
+    fprintf(out, "{\"level\": \"%s\", \"inputs\": %u, \"kernels\": {", SIMD_LEVEL_NAMES[simd_init()], n);
+    for (uint kn = 0; kn < KERNEL_COUNT; kn++) {
+        fprintf(out, "%s\"%s\": {", kn ? ", " : "", KERNEL_NAMES[kn]);
+        const double tolerance = kn == KERNEL_INVERT ? SIMD_TOLERANCE_INVERT : SIMD_TOLERANCE;
+
+        // vector kernels only write the first column, so the rest must match too
+        memset(res, 0, n * sizeof(mat4x4));
+        memset(ref, 0, n * sizeof(mat4x4));
+
+        for (uint l = 0; l < SIMD_LEVEL_COUNT; l++) {
+            const simd_kernels *k = simd_kernels_of(l);
+            if (!k)
+                continue;
+
+            // the first round also warms the caches up, and fills in the reference
+            run_kernel(k, kn, n, a, b, angles, l == SIMD_SCALAR ? ref : res);
+            const uint64_t t = prof_now();
+            for (uint r = 0; r < SIMD_BENCH_ROUNDS; r++)
+                run_kernel(k, kn, n, a, b, angles, res);
+            const double ns = (double)(prof_now() - t) / SIMD_BENCH_ROUNDS / n;
+
+            fprintf(out, "%s\"%s_ns\": %.2f", l ? ", " : "", SIMD_LEVEL_NAMES[l], ns);
+            if (l != SIMD_SCALAR) {
+                const double err = max_error(n, res, ref);
+                failures += err > tolerance;
+                fprintf(out, ", \"%s_err\": %.3g", SIMD_LEVEL_NAMES[l], err);
+            }
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "}, ");
+
+    // the batched product on every thread, over as many matrices as a large scene has
+    const uint big = SIMD_BENCH_INPUTS * SIMD_BENCH_ROUNDS;
+    batch_job job = {b[0], malloc(big * sizeof(mat4x4)), malloc(big * sizeof(mat4x4))};
+    if (!job.models || !job.out) {
+        error("Failed to allocate the kernel benchmark.");
+        exit(EXIT_FAILURE);
+    }
+    for (uint i = 0; i < big; i++)
+        mat4x4_dup(job.models[i], a[i % n]);
+
+    // the first run also faults the output in
+    batch_range(&job, 0, big);
+    uint64_t ns[2];
+    for (uint mt = 0; mt < 2; mt++) {
+        const uint64_t t = prof_now();
+        if (mt)
+            jobs_run(jobs, batch_range, &job, big, SIMD_BATCH_GRAIN);
+        else
+            batch_range(&job, 0, big);
+        ns[mt] = prof_now() - t;
+    }
+    fprintf(out, "\"mat4x4_mul_batch_threads\": {\"matrices\": %u, \"threads\": %u, \"single_ns\": %.2f, \"threaded_ns\": %.2f}, ",
+            big, jobs->threads_len + 1, (double)ns[0] / big, (double)ns[1] / big);
+    fprintf(out, "\"failures\": %u}\n", failures);
+
+    free(job.models);
+    free(job.out);
+    free(angles);
+    free(a);
+    free(b);
+    free(res);
+    free(ref);
+    return failures;
+}
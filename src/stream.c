@@ -0,0 +1,104 @@
+/// Persistently mapped streaming buffers, split into per-frame regions guarded by fences.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "prof.h"
+#include "stream.h"
+#include <string.h>
+
+
+// storage and mapping flags (coherent, so writes need no explicit flush)
+#define STREAM_FLAGS (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+
+/// @brief Allocate and map the storage for regions of `region` bytes
+static void stream_alloc(stream_buffer *s, const size_t region) {
+    // every region starts at a multiple of the binding alignment
+    s->region = (region + s->align - 1) / s->align * s->align;
+
+    glGenBuffers(1, &s->buffer);
+    glBindBuffer(s->target, s->buffer);
+    glBufferStorage(s->target, STREAM_REGIONS * s->region, NULL, STREAM_FLAGS);
+    s->ptr = glMapBufferRange(s->target, 0, STREAM_REGIONS * s->region, STREAM_FLAGS);
+    glBindBuffer(s->target, 0);
+
+    if (!s->ptr) {
+        error("Failed to map a streaming buffer.");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/// @brief Wait until the GPU is done with a region, counting the time it took
+static void stream_wait(stream_buffer *s, const uint slot) {
+    if (!s->fences[slot])
+        return;
+
+    // only time the waits that actually block
+    if (glClientWaitSync(s->fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+        const uint64_t t = prof_now();
+        while (glClientWaitSync(s->fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+        s->wait_ns += prof_now() - t;
+        s->waits++;
+    }
+
+    glDeleteSync(s->fences[slot]);
+    s->fences[slot] = NULL;
+}
+
+/// @brief Release the storage (the GPU must be done with every region)
+static void stream_release(stream_buffer *s) {
+    glBindBuffer(s->target, s->buffer);
+    glUnmapBuffer(s->target);
+    glBindBuffer(s->target, 0);
+    glDeleteBuffers(1, &s->buffer);
+}
+
+void stream_init(stream_buffer *s, const GLenum target, const size_t size) {
+    memset(s, 0, sizeof(*s));
+    s->target = target;
+
+    glGetIntegerv(target == GL_UNIFORM_BUFFER ? GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT : GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &s->align);
+    if (s->align < 1)
+        s->align = 1;
+
+    stream_alloc(s, size ? size : 1);
+}
+
+void *stream_map(stream_buffer *s, const size_t size) {
+    // immutable storage can't grow in place, so drain every region and allocate a bigger buffer
+    if (size > s->region) {
+        for (uint i = 0; i < STREAM_REGIONS; i++)
+            stream_wait(s, i);
+
+        stream_release(s);
+        stream_alloc(s, size + size / 2);
+        s->resizes++;
+    }
+
+    const uint slot = s->frame % STREAM_REGIONS;
+    stream_wait(s, slot);
+    return s->ptr + slot * s->region;
+}
+
+void stream_bind(const stream_buffer *s, const uint index, const size_t size) {
+    // empty ranges can't be bound
+    if (size)
+        glBindBufferRange(s->target, index, s->buffer, (s->frame % STREAM_REGIONS) * s->region, size);
+}
+
+void stream_fence(stream_buffer *s) {
+    const uint slot = s->frame % STREAM_REGIONS;
+    if (s->fences[slot])
+        glDeleteSync(s->fences[slot]);
+    s->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s->frame++;
+}
+
+void stream_free(stream_buffer *s) {
+    for (uint i = 0; i < STREAM_REGIONS; i++)
+        if (s->fences[i])
+            glDeleteSync(s->fences[i]);
+
+    stream_release(s);
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,132 @@
+/// Vertex formats of the vertex arena: 32-bit floats, or positions in half floats or 16-bit normalized
+/// integers (relative to the bounds of their mesh) with normals packed in two components (octahedral).
+/// The attribute fetch turns every format back into floats, and the vertex shader undoes the packing.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "vformat.h"
+#include <string.h>
+
+
+const char *VFORMAT_NAMES[VFORMAT_COUNT] = {"f32", "f16-oct16", "s16-oct16", "s16-oct8"};
+
+// positions take 6 bytes in every packed format, so 16-bit normals start on the next 4-byte boundary
+const vertex_layout VFORMAT_LAYOUTS[VFORMAT_COUNT] = {
+    {24, GL_FLOAT, GL_FALSE, 12, GL_FLOAT, 3},
+    {12, GL_HALF_FLOAT, GL_FALSE, 8, GL_SHORT, 2},
+    {12, GL_SHORT, GL_TRUE, 8, GL_SHORT, 2},
+    {8, GL_SHORT, GL_TRUE, 6, GL_BYTE, 2}
+};
+
+
+/// @brief Nearest integer to a value in [-1, 1] scaled to `[-max, max]` (as GL unpacks normalized integers)
+static int snorm(const float v, const float max) {
+    return (int)lrintf((v < -1.0f ? -1.0f : v > 1.0f ? 1.0f : v) * max);
+}
+
+uint16_t vformat_half(const float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    const uint16_t sign = (x >> 16) & 0x8000;
+    const uint32_t abs = x & 0x7FFFFFFF;
+
+    // infinities and NaNs stay so, and anything from 65520 up rounds to infinity
+    if (abs >= 0x7F800000)
+        return sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 : 0);
+    if (abs >= 0x477FF000)
+        return sign | 0x7C00;
+
+    // below the smallest normal half (2^-14), the significand is shifted into a subnormal
+    if (abs < 0x38800000) {
+        const uint e = abs >> 23;
+        if (e < 102)
+            return sign;
+        const uint shift = 126 - e;
+        const uint32_t significand = (abs & 0x7FFFFF) | 0x800000;
+        const uint32_t rest = significand & ((1u << shift) - 1), tie = 1u << (shift - 1);
+        uint32_t h = significand >> shift;
+        if (rest > tie || (rest == tie && (h & 1)))
+            h++;
+        return sign | h;
+    }
+
+    // the exponent is rebiased, and the significand rounded from 23 bits to 10 (a carry bumps the exponent)
+    uint32_t h = (abs - 0x38000000) >> 13;
+    const uint32_t rest = abs & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (h & 1)))
+        h++;
+    return sign | h;
+}
+
+void vformat_oct(float out[2], vec3 const n) {
+    const float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+    float x = l1 > 0.0f ? n[0] / l1 : 0.0f, y = l1 > 0.0f ? n[1] / l1 : 0.0f;
+    if (n[2] < 0.0f) {
+        const float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+    }
+    out[0] = x, out[1] = y;
+}
+
+void vformat_dequant(const vertex_format format, vec4 dequant, vec3 const lo, vec3 const hi) {
+    dequant[0] = dequant[1] = dequant[2] = 0.0f, dequant[3] = 1.0f;
+    if (format == VFORMAT_F32)
+        return;
+
+    float scale = 0.0f;
+    for (uint l = 0; l < 3; l++) {
+        dequant[l] = (lo[l] + hi[l]) * 0.5f;
+        scale = fmaxf(scale, (hi[l] - lo[l]) * 0.5f);
+    }
+    dequant[3] = scale > 0.0f ? scale : 1.0f;
+}
+
+void vformat_encode(const vertex_format format, void *out, const uint count, const float *positions,
+                    const float *normals, const size_t stride, vec4 const dequant) {
+    const vertex_layout *l = &VFORMAT_LAYOUTS[format];
+    const float inv = 1.0f / dequant[3];
+
+    for (uint v = 0; v < count; v++) {
+        const float *p = (const float *)((const char *)positions + v * stride);
+        const float *n = (const float *)((const char *)normals + v * stride);
+        char *dst = (char *)out + (size_t)v * l->size;
+
+        if (format == VFORMAT_F32) {
+            memcpy(dst, p, 3 * sizeof(float));
+            memcpy(dst + l->norm_offset, n, 3 * sizeof(float));
+            continue;
+        }
+
+        // positions in [-1, 1] across the mesh's largest side (the padding after them is zeroed)
+        uint16_t pos[4] = {0, 0, 0, 0};
+        for (uint k = 0; k < 3; k++) {
+            const float q = (p[k] - dequant[k]) * inv;
+            pos[k] = format == VFORMAT_F16_OCT16 ? vformat_half(q) : (uint16_t)snorm(q, 32767.0f);
+        }
+        memcpy(dst, pos, l->norm_offset);
+
+        float oct[2];
+        vformat_oct(oct, n);
+        if (l->norm_type == GL_BYTE) {
+            const int8_t packed[2] = {snorm(oct[0], 127.0f), snorm(oct[1], 127.0f)};
+            memcpy(dst + l->norm_offset, packed, sizeof(packed));
+        } else {
+            const int16_t packed[2] = {snorm(oct[0], 32767.0f), snorm(oct[1], 32767.0f)};
+            memcpy(dst + l->norm_offset, packed, sizeof(packed));
+        }
+    }
+}
+
+void vformat_attribs(const vertex_format format) {
+    const vertex_layout *l = &VFORMAT_LAYOUTS[format];
+
+    glVertexAttribFormat(0, 3, l->pos_type, l->pos_normalized, 0);
+    glVertexAttribBinding(0, 0);
+    glEnableVertexAttribArray(0);
+
+    // packed normals are normalized integers (two components, the shader unfolds the octahedron)
+    glVertexAttribFormat(1, l->norm_size, l->norm_type, l->norm_type != GL_FLOAT, l->norm_offset);
+    glVertexAttribBinding(1, 0);
+    glEnableVertexAttribArray(1);
+}
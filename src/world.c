@@ -0,0 +1,234 @@
+/// Growable object storage, keeping the fields read by the draw loop in parallel (structure-of-arrays) form.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "world.h"
+#include <string.h>
+
+
+/// @brief Resize an array, exiting on failure
+static void *grow(void *p, const size_t n, const size_t size) {
+    void *q = realloc(p, n * size);
+    if (!q && n) {
+        error("Failed to grow the world.");
+        exit(EXIT_FAILURE);
+    }
+    return q;
+}
+
+/// @brief Bounding box of a box transformed by a matrix (Arvo's method: the center moves, and the
+/// half-extents go through the absolute values of the matrix)
+static void aabb_transform(aabb *out, const aabb *in, mat4x4 const m) {
+    vec3 c, e;
+    for (uint l = 0; l < 3; l++) {
+        c[l] = (in->lo[l] + in->hi[l]) * 0.5f;
+        e[l] = (in->hi[l] - in->lo[l]) * 0.5f;
+    }
+
+    for (uint r = 0; r < 3; r++) {
+        float cr = m[3][r], er = 0.0f;
+        for (uint l = 0; l < 3; l++) {
+            cr += m[l][r] * c[l];
+            er += fabsf(m[l][r]) * e[l];
+        }
+        out->lo[r] = cr - er;
+        out->hi[r] = cr + er;
+    }
+}
+
+void world_init(world *wd, const uint cap) {
+    memset(wd, 0, sizeof(*wd));
+    wd->free_slot = WORLD_NO_SLOT;
+    world_reserve(wd, cap);
+}
+
+void world_reserve(world *wd, const uint cap) {
+    if (cap <= wd->cap)
+        return;
+
+    if (cap > HANDLE_INDEX_MASK) {
+        error("Too many objects in the world.");
+        exit(EXIT_FAILURE);
+    }
+
+    wd->base_vertex = grow(wd->base_vertex, cap, sizeof(*wd->base_vertex));
+    wd->first_index = grow(wd->first_index, cap, sizeof(*wd->first_index));
+    wd->program = grow(wd->program, cap, sizeof(*wd->program));
+    wd->vertices_len = grow(wd->vertices_len, cap, sizeof(*wd->vertices_len));
+    wd->indices_len = grow(wd->indices_len, cap, sizeof(*wd->indices_len));
+    wd->mode = grow(wd->mode, cap, sizeof(*wd->mode));
+    wd->has_ebo = grow(wd->has_ebo, cap, sizeof(*wd->has_ebo));
+    wd->index_type = grow(wd->index_type, cap, sizeof(*wd->index_type));
+    wd->mesh = grow(wd->mesh, cap, sizeof(*wd->mesh));
+    wd->model = grow(wd->model, cap, sizeof(*wd->model));
+    wd->bounds = grow(wd->bounds, cap, sizeof(*wd->bounds));
+    wd->owner = grow(wd->owner, cap, sizeof(*wd->owner));
+    wd->dirty = grow(wd->dirty, cap, sizeof(*wd->dirty));
+    wd->moved = grow(wd->moved, cap, sizeof(*wd->moved));
+    wd->cap = cap;
+
+    // there are never more live slots than objects (retired slots grow the table in world_add)
+    if (cap > wd->slots_cap) {
+        wd->slots = grow(wd->slots, cap, sizeof(*wd->slots));
+        wd->gens = grow(wd->gens, cap, sizeof(*wd->gens));
+        wd->slots_cap = cap;
+    }
+}
+
+handle world_add(world *wd, const obj o) {
+    if (wd->len == HANDLE_INDEX_MASK) {
+        error("Too many objects in the world.");
+        exit(EXIT_FAILURE);
+    }
+
+    // grow geometrically, so adding is amortized O(1)
+    if (wd->len == wd->cap)
+        world_reserve(wd, !wd->cap ? 16 : wd->cap > HANDLE_INDEX_MASK / 2 ? HANDLE_INDEX_MASK : wd->cap * 2);
+
+    // reuse a free slot, or append a new one
+    uint s;
+    if (wd->free_slot != WORLD_NO_SLOT) {
+        s = wd->free_slot;
+        wd->free_slot = wd->slots[s];
+    } else {
+        // retired slots are never reused, so the table can outgrow the objects
+        if (wd->slots_len == HANDLE_INDEX_MASK) {
+            error("Too many objects in the world.");
+            exit(EXIT_FAILURE);
+        }
+        if (wd->slots_len == wd->slots_cap) {
+            const uint cap = wd->slots_cap > HANDLE_INDEX_MASK / 2 ? HANDLE_INDEX_MASK : wd->slots_cap * 2;
+            wd->slots = grow(wd->slots, cap, sizeof(*wd->slots));
+            wd->gens = grow(wd->gens, cap, sizeof(*wd->gens));
+            wd->slots_cap = cap;
+        }
+        s = wd->slots_len++;
+        wd->gens[s] = 1;
+    }
+
+    const uint i = wd->len++;
+    wd->base_vertex[i] = o.base_vertex;
+    wd->first_index[i] = o.first_index;
+    wd->program[i] = o.program;
+    wd->vertices_len[i] = o.vertices_len;
+    wd->indices_len[i] = o.indices_len;
+    wd->mode[i] = o.mode;
+    wd->has_ebo[i] = o.has_ebo;
+    wd->index_type[i] = o.index_type;
+    wd->mesh[i] = o.mesh;
+    mat4x4_dup(wd->model[i], o.model);
+    aabb_transform(&wd->bounds[i], &wd->meshes.meshes[o.mesh].box, o.model);
+    wd->owner[i] = s;
+    wd->dirty[i] = 0;
+    wd->slots[s] = i;
+    wd->version++;
+
+    // structures over the bounds are rebuilt instead
+    world_clear_moved(wd);
+
+    return (uint)wd->gens[s] << HANDLE_INDEX_BITS | s;
+}
+
+int world_valid(const world *wd, const handle h) {
+    const uint s = HANDLE_INDEX(h);
+    return h != HANDLE_NULL && s < wd->slots_len && wd->gens[s] == HANDLE_GEN(h) && wd->slots[s] < wd->len && wd->owner[wd->slots[s]] == s;
+}
+
+uint world_index(const world *wd, const handle h) {
+    return wd->slots[HANDLE_INDEX(h)];
+}
+
+handle world_handle(const world *wd, const uint i) {
+    const uint s = wd->owner[i];
+    return (uint)wd->gens[s] << HANDLE_INDEX_BITS | s;
+}
+
+void world_set_model(world *wd, const handle h, mat4x4 const model) {
+    if (!world_valid(wd, h))
+        return;
+
+    const uint i = world_index(wd, h);
+    mat4x4_dup(wd->model[i], model);
+    aabb_transform(&wd->bounds[i], &wd->meshes.meshes[wd->mesh[i]].box, model);
+    if (!wd->dirty[i]) {
+        wd->dirty[i] = 1;
+        wd->moved[wd->moved_len++] = i;
+    }
+}
+
+void world_clear_moved(world *wd) {
+    for (uint k = 0; k < wd->moved_len; k++)
+        wd->dirty[wd->moved[k]] = 0;
+    wd->moved_len = 0;
+}
+
+obj world_get(const world *wd, const handle h) {
+    const uint i = world_index(wd, h);
+    obj o = {
+        wd->base_vertex[i], wd->first_index[i], wd->program[i], wd->vertices_len[i], wd->indices_len[i], wd->mode[i], wd->has_ebo[i], wd->index_type[i], wd->mesh[i]
+    };
+    mat4x4_dup(o.model, wd->model[i]);
+    return o;
+}
+
+void world_remove(world *wd, const handle h) {
+    if (!world_valid(wd, h))
+        return;
+
+    // the moved objects' indices are about to change, and structures over the bounds are rebuilt instead
+    world_clear_moved(wd);
+
+    const uint s = HANDLE_INDEX(h);
+    const uint i = wd->slots[s];
+    const uint last = --wd->len;
+
+    // move the last object into the hole
+    if (i != last) {
+        wd->base_vertex[i] = wd->base_vertex[last];
+        wd->first_index[i] = wd->first_index[last];
+        wd->program[i] = wd->program[last];
+        wd->vertices_len[i] = wd->vertices_len[last];
+        wd->indices_len[i] = wd->indices_len[last];
+        wd->mode[i] = wd->mode[last];
+        wd->has_ebo[i] = wd->has_ebo[last];
+        wd->index_type[i] = wd->index_type[last];
+        wd->mesh[i] = wd->mesh[last];
+        mat4x4_dup(wd->model[i], wd->model[last]);
+        wd->bounds[i] = wd->bounds[last];
+        wd->owner[i] = wd->owner[last];
+        wd->slots[wd->owner[i]] = i;
+    }
+
+    // invalidate outstanding handles; a slot whose generations are used up is retired instead of
+    // wrapping around, which would make its oldest handles valid again
+    if (wd->gens[s] == HANDLE_MAX_GEN) {
+        wd->slots[s] = WORLD_NO_SLOT;
+    } else {
+        wd->gens[s]++;
+        wd->slots[s] = wd->free_slot;
+        wd->free_slot = s;
+    }
+    wd->version++;
+}
+
+void world_free(world *wd) {
+    free(wd->base_vertex);
+    free(wd->first_index);
+    free(wd->program);
+    free(wd->vertices_len);
+    free(wd->indices_len);
+    free(wd->mode);
+    free(wd->has_ebo);
+    free(wd->index_type);
+    free(wd->mesh);
+    free(wd->model);
+    free(wd->bounds);
+    free(wd->owner);
+    free(wd->dirty);
+    free(wd->moved);
+    free(wd->slots);
+    free(wd->gens);
+    mesh_registry_free(&wd->meshes);
+    memset(wd, 0, sizeof(*wd));
+    wd->free_slot = WORLD_NO_SLOT;
+}
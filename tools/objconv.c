@@ -0,0 +1,213 @@
+/// Converter from Wavefront OBJ and PLY files to scene files: every object of the file becomes a mesh, with
+/// its normals, bounds, reordered indices and simplified versions computed once here rather than every time the
+/// scene is loaded.
+/// @file
+/// @author Evan Schwartzentruber
+
+#include "import.h"
+#include "jobs.h"
+#include "scenefile.h"
+#include "simd.h"
+#include <getopt.h>
+#include <string.h>
+
+
+/// @brief Growing vertices, indices and meshes of the scene file
+/// @param jobs worker threads the normals are computed on
+/// @param normals how the normals are generated
+/// @param optimize how the indices are reordered
+/// @param opt what reordering the indices gained
+/// @param lods most simplified versions made of every mesh
+/// @param vertices vertices of every mesh
+/// @param vertices_len number of vertices
+/// @param vertices_cap room for vertices
+/// @param indices indices of every mesh
+/// @param indices_len number of indices
+/// @param indices_cap room for indices
+/// @param meshes meshes
+/// @param meshes_len number of meshes
+/// @param meshes_cap room for meshes
+typedef struct ObjconvScene {
+    job_pool *jobs;
+    normal_mode normals;
+    meshopt_mode optimize;
+    meshopt_stats opt;
+    uint lods;
+    vertex *vertices;
+    uint vertices_len, vertices_cap;
+    uint32_t *indices;
+    uint indices_len, indices_cap;
+    scenefile_mesh *meshes;
+    uint meshes_len, meshes_cap;
+} objconv_scene;
+
+
+/// @brief Print usage information
+static void usage(FILE *out, const char *name) {
+    fprintf(out,
+            "Usage: %s [options] IN.obj|IN.ply OUT\n"
+            "\n"
+            "Options:\n"
+            "  -n, --normals MODE  flat, area or angle (default angle)\n"
+            "  -O, --optimize MODE none, cache or overdraw (default overdraw)\n"
+            "  -L, --lods N        simplified versions of meshes of %u triangles or more (0 to %u, default %u)\n"
+            "  -T, --threads N     threads parsing the file and computing the normals (default one per core)\n"
+            "  -h, --help          show this message\n",
+            name, LOD_MIN_TRIANGLES, LOD_MAX, LOD_DEFAULT);
+}
+
+static void *objconv_grow(void *p, uint *cap, const uint need, const size_t size) {
+    if (need <= *cap)
+        return p;
+
+    uint c = *cap ? *cap : 1024;
+    while (c < need)
+        c *= 2;
+    p = realloc(p, (size_t)c * size);
+    if (!p) {
+        error("Failed to grow the scene.");
+        exit(EXIT_FAILURE);
+    }
+    *cap = c;
+    return p;
+}
+
+/// @brief Turn an imported mesh into a mesh of the scene
+static void objconv_mesh(void *ctx, const char *name, const uint n, const uint m, const float *vertices,
+                         const uint *indices) {
+    objconv_scene *sc = ctx;
+    scenefile_mesh mesh = {0};
+    mesh.mode = GL_TRIANGLES;
+    snprintf(mesh.name, MESH_NAME_LEN, "%s", name);
+    mesh_bounds(&mesh.box, mesh.sphere, n, vertices);
+
+    uint count = n / 3, len = m;
+    vertex *data = mesh_vertices(sc->jobs, &count, &len, vertices, indices, GL_TRIANGLES, sc->normals);
+    mesh.first_vertex = sc->vertices_len;
+    mesh.vertices_len = count;
+    mesh.first_index = sc->indices_len;
+    mesh.indices_len = len;
+
+    sc->vertices = objconv_grow(sc->vertices, &sc->vertices_cap, sc->vertices_len + count, sizeof(vertex));
+    memcpy(sc->vertices + sc->vertices_len, data, (size_t)count * sizeof(vertex));
+    sc->vertices_len += count;
+    sc->indices = objconv_grow(sc->indices, &sc->indices_cap, sc->indices_len + len, sizeof(uint32_t));
+    memcpy(sc->indices + sc->indices_len, indices, (size_t)len * sizeof(uint32_t));
+    meshopt_optimize(sc->optimize, count, sc->vertices + mesh.first_vertex, sizeof(vertex), len,
+                     sc->indices + sc->indices_len, &sc->opt);
+    sc->indices_len += len;
+
+    // the simplified versions follow the mesh's indices, their triangles reordered too
+    lod_level levels[LOD_MAX];
+    uint *lods;
+    mesh.lods = lod_build(sc->jobs, count, sc->vertices + mesh.first_vertex, sizeof(vertex), len,
+                          sc->indices + mesh.first_index, sc->lods, levels, &lods);
+    for (uint l = 0; l < mesh.lods; l++) {
+        const uint k = levels[l].indices_len;
+        sc->indices = objconv_grow(sc->indices, &sc->indices_cap, sc->indices_len + k, sizeof(uint32_t));
+        uint32_t *lod = sc->indices + sc->indices_len;
+        memcpy(lod, lods + levels[l].first_index, (size_t)k * sizeof(uint32_t));
+        meshopt_triangles(sc->optimize, count, sc->vertices + mesh.first_vertex, sizeof(vertex), k, lod);
+        mesh.lod[l] = (scenefile_lod) {
+            sc->indices_len, k, levels[l].error
+        };
+        sc->indices_len += k;
+    }
+    free(lods);
+
+    // the file keeps 32-bit indices, narrowed as they're uploaded
+    if (len && count <= MESH_SHORT_VERTICES)
+        sc->opt.short_meshes++;
+    sc->meshes = objconv_grow(sc->meshes, &sc->meshes_cap, sc->meshes_len + 1, sizeof(scenefile_mesh));
+    sc->meshes[sc->meshes_len++] = mesh;
+    free(data);
+}
+
+int main(int argc, char **argv) {
+    normal_mode normals = NORMALS_ANGLE;
+    meshopt_mode optimize = MESHOPT_OVERDRAW;
+    uint threads = 0, lods = LOD_DEFAULT;
+
+    const struct option long_opts[] = {
+        {"normals", required_argument, NULL, 'n'},
+        {"optimize", required_argument, NULL, 'O'},
+        {"lods", required_argument, NULL, 'L'},
+        {"threads", required_argument, NULL, 'T'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:O:L:T:h", long_opts, NULL)) != -1) {
+        switch (c) {
+            case 'n':
+                for (normals = 0; normals < NORMALS_MODE_COUNT && strcmp(optarg, NORMAL_MODE_NAMES[normals]); normals++);
+                if (normals == NORMALS_MODE_COUNT) {
+                    fprintf(stderr, "Error: invalid value for --normals: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'O':
+                for (optimize = 0; optimize < MESHOPT_MODE_COUNT && strcmp(optarg, MESHOPT_MODE_NAMES[optimize]); optimize++);
+                if (optimize == MESHOPT_MODE_COUNT) {
+                    fprintf(stderr, "Error: invalid value for --optimize: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'L': {
+                char *end;
+                const long l = strtol(optarg, &end, 10);
+                if (end == optarg || *end || l < 0 || l > LOD_MAX) {
+                    fprintf(stderr, "Error: --lods must be between 0 and %u\n", LOD_MAX);
+                    return EXIT_FAILURE;
+                }
+                lods = l;
+                break;
+            }
+            case 'T': {
+                char *end;
+                const long t = strtol(optarg, &end, 10);
+                if (end == optarg || *end || t < 0) {
+                    fprintf(stderr, "Error: invalid value for --threads: '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                threads = t;
+                break;
+            }
+            case 'h':
+                usage(stdout, argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(stderr, argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind != 2) {
+        usage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    simd_init();
+    job_pool jobs;
+    jobs_init(&jobs, threads);
+
+    // meshes are given their normals as the rest of the file is parsed
+    objconv_scene sc = {&jobs, normals, optimize, .lods = lods};
+    import_stats st;
+    int ok = import_file(argv[optind], threads, objconv_mesh, &sc, &st);
+    if (ok) {
+        import_report(&st, argv[optind], stdout);
+        meshopt_json(optimize, &sc.opt, stdout);
+        printf("\n");
+    }
+
+    // no objects: every mesh is drawn once, where it was modelled
+    ok = ok && scenefile_write(argv[optind + 1], sc.vertices, sc.vertices_len, sc.indices, sc.indices_len,
+                               sc.meshes, sc.meshes_len, NULL, 0);
+
+    jobs_free(&jobs);
+    free(sc.vertices);
+    free(sc.indices);
+    free(sc.meshes);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}